@@ -0,0 +1,146 @@
+#pragma once
+
+#include "hierarchical_optimization/qp_backend.hpp"
+
+#include <Eigen/Core>
+
+
+
+namespace hopt {
+
+/* ========================================================================== */
+/*                              ACTIVESETQP CLASS                             */
+/* ========================================================================== */
+
+/// @class @brief Dense dual active-set QP solver (Goldfarb-Idnani) that works in preallocated memory.
+/// @details Solves the problem
+///     min_x 1/2 x^T G x + g0^T x
+///     s.t.  CI x + ci0 >= 0
+/// where the first m_eq rows of CI are equality constraints.
+/// All the working matrices are blocks of buffers sized by reserve(). If a problem larger than the reserved size is solved, the buffers are enlarged once and reused from then on.
+class ActiveSetQP : public QPBackend {
+public:
+    ActiveSetQP() = default;
+
+    /// @brief Construct the solver and preallocate its working memory.
+    /// @param[in] n_max maximum number of optimization variables
+    /// @param[in] m_max maximum number of constraints
+    ActiveSetQP(int n_max, int m_max) { reserve(n_max, m_max); }
+
+    /// @brief Preallocate the working memory for problems with up to n_max variables and m_max constraints.
+    void reserve(int n_max, int m_max) override;
+
+    /// @brief Get the number of active-set iterations of the last solve.
+    [[nodiscard]] int get_iterations() const override {return iterations_;}
+
+    /// @brief Get the number of constraints of the working set of the last solve that were added to the active set before the first iteration.
+    [[nodiscard]] int get_n_warm_started_constraints() const override {return n_warm_started_constraints_;}
+
+    /// @brief Get the indices of the active constraints at the solution of the last solve.
+    [[nodiscard]] Eigen::Ref<const Eigen::VectorXi> get_active_set() const override {return active_set_.head(n_active_);}
+
+    /// @brief Get the Lagrange multipliers of the active constraints at the solution of the last solve.
+    [[nodiscard]] Eigen::Ref<const Eigen::VectorXd> get_multipliers() const {return u_.head(n_active_);}
+
+    /// @brief The Cholesky factor passed to solve_factorized() is used directly, without factorizing the Hessian.
+    [[nodiscard]] bool accepts_factorized() const override {return true;}
+
+    /// @brief Both sides of a range constraint are checked with a single product with its row of CI.
+    [[nodiscard]] bool accepts_ranges() const override {return true;}
+
+    void set_max_iterations(int max_iterations) {this->max_iterations_ = max_iterations;}
+
+protected:
+    /// @brief Solve the QP problem with the Goldfarb-Idnani dual method. G is overwritten with its Cholesky factor.
+    QPStatus solve_impl(
+        Eigen::Ref<Eigen::MatrixXd> G,
+        const Eigen::Ref<const Eigen::VectorXd>& g0,
+        const Eigen::Ref<const Eigen::MatrixXd>& CI,
+        const Eigen::Ref<const Eigen::VectorXd>& ci0,
+        Eigen::Ref<Eigen::VectorXd> x,
+        int m_eq,
+        const Eigen::Ref<const Eigen::VectorXi>& working_set
+    ) override;
+
+    /// @brief Solve the QP problem with the Goldfarb-Idnani dual method, starting from the Cholesky factor of the leading block of the Hessian. Only the factorized block is inverted, the identity block is not.
+    QPStatus solve_factorized_impl(
+        Eigen::Ref<Eigen::MatrixXd> L,
+        int n_factorized,
+        const Eigen::Ref<const Eigen::VectorXd>& g0,
+        const Eigen::Ref<const Eigen::MatrixXd>& CI,
+        const Eigen::Ref<const Eigen::VectorXd>& ci0,
+        Eigen::Ref<Eigen::VectorXd> x,
+        int m_eq,
+        const Eigen::Ref<const Eigen::VectorXi>& working_set
+    ) override;
+
+    /// @brief Solve the QP problem with the Goldfarb-Idnani dual method, starting from the Cholesky factor of the leading block of the Hessian, where some of the constraints are ranges.
+    QPStatus solve_factorized_impl(
+        Eigen::Ref<Eigen::MatrixXd> L,
+        int n_factorized,
+        const Eigen::Ref<const Eigen::VectorXd>& g0,
+        const Eigen::Ref<const Eigen::MatrixXd>& CI,
+        const Eigen::Ref<const Eigen::VectorXd>& ci0,
+        const Eigen::Ref<const Eigen::VectorXd>& ci_upper,
+        Eigen::Ref<Eigen::VectorXd> x,
+        int m_eq,
+        const Eigen::Ref<const Eigen::VectorXi>& working_set
+    ) override;
+
+private:
+    /// @brief Add the constraint whose (J^T n_p) is stored in d_ to the active set, updating J_ and R_ with Givens rotations.
+    /// @return false if the constraint is linearly dependent on the active ones.
+    bool add_constraint(int n, int& iq);
+
+    /// @brief Add back to the active set the constraints of active_set_old_ dropped since the beginning of the current step, with their multipliers in u_old_.
+    /// @return false if one of them is linearly dependent on the active ones.
+    bool restore_active_set(int n, int& iq, int iq_old, const Eigen::Ref<const Eigen::MatrixXd>& CI);
+
+    /// @brief Remove the constraint l from the active set, restoring the triangular form of R_ with Givens rotations.
+    void delete_constraint(int n, int& iq, int l);
+
+    /// @brief Add the constraints of the working set to the active set, and move x to the minimum of the problem with the active constraints treated as equalities.
+    /// @details The constraints with negative multipliers are removed one at a time, until all the multipliers of the inequality constraints are nonnegative.
+    void add_working_set(
+        int n, int& iq, int m_eq,
+        const Eigen::Ref<const Eigen::VectorXd>& g0,
+        const Eigen::Ref<const Eigen::MatrixXd>& CI,
+        const Eigen::Ref<const Eigen::VectorXd>& ci0,
+        const Eigen::Ref<const Eigen::VectorXd>& ci_upper,
+        Eigen::Ref<Eigen::VectorXd> x,
+        const Eigen::Ref<const Eigen::VectorXi>& working_set
+    );
+
+    /* ================================================================== */
+
+    int n_max_ = 0;     ///< @brief Number of variables the buffers are sized for
+    int m_max_ = 0;     ///< @brief Number of constraints the buffers are sized for
+
+    int max_iterations_ = 1000;
+
+    int iterations_ = 0;
+    int n_active_ = 0;
+    int n_warm_started_constraints_ = 0;
+
+    double R_norm_ = 1;
+
+    Eigen::MatrixXd J_;             ///< @brief J = L^-T Q, with G = L L^T and Q the orthogonal factor of the active constraints
+    Eigen::MatrixXd R_;             ///< @brief Upper triangular factor of the active constraints
+
+    Eigen::VectorXd d_;             ///< @brief d = J^T n_p
+    Eigen::VectorXd z_;             ///< @brief Step direction in the primal space
+    Eigen::VectorXd r_;             ///< @brief Step direction in the dual space
+    Eigen::VectorXd u_;             ///< @brief Lagrange multipliers of the active constraints
+    Eigen::VectorXd s_;             ///< @brief Products CI x
+
+    Eigen::VectorXi active_set_;    ///< @brief Indices of the active constraints
+    Eigen::VectorXi is_active_;     ///< @brief Flag for each constraint (and upper side of a range), 1 if it is in the active set
+    Eigen::VectorXi is_excluded_;   ///< @brief Flag for each constraint (and upper side of a range), 1 if it could not be added since it is linearly dependent on the active ones
+    Eigen::VectorXd ci_scale_;      ///< @brief 1-norm of each row of CI, that scales the feasibility tolerance
+
+    Eigen::VectorXd x_old_;         ///< @brief x at the beginning of the current step
+    Eigen::VectorXd u_old_;         ///< @brief Multipliers at the beginning of the current step
+    Eigen::VectorXi active_set_old_;    ///< @brief Active set at the beginning of the current step
+};
+
+} // namespace hopt
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "hierarchical_optimization/hierarchical_problem.hpp"
+#include "hierarchical_optimization/hierarchical_qp.hpp"
+
+#include <Eigen/Core>
+
+#include <memory>
+#include <vector>
+
+
+
+namespace hopt {
+
+/* ========================================================================== */
+/*                         BATCHHIERARCHICALQP CLASS                          */
+/* ========================================================================== */
+
+/// @class @brief Solver of a batch of independent hierarchical problems, distributed over a set of threads.
+/// @details Each thread owns a HierarchicalQP, which is reused for all the problems it solves. Every problem is solved from scratch (without warm start and time budget), so that its solution does not depend on the problems solved before it by the same thread: the solutions are the ones of a single HierarchicalQP, regardless of the number of threads.
+/// The threads pick the next problem of the batch when they are done with the previous one, so that problems of different size are balanced among them.
+class BatchHierarchicalQP {
+public:
+    /// @brief Construct a new BatchHierarchicalQP object.
+    /// @param[in] n_threads number of threads used to solve the batch. 0 uses one thread per hardware core.
+    BatchHierarchicalQP(int n_threads = 0);
+
+    /// @brief Solve all the problems of the batch.
+    /// @details It returns when all the problems are solved. If solving a problem throws, the first exception is rethrown after all the threads have stopped.
+    /// @param[in]  problems the hierarchical problems
+    /// @param[out] solutions the solution of each problem (resized to the number of problems)
+    void solve(const std::vector<HierarchicalProblem>& problems, std::vector<Eigen::VectorXd>& solutions);
+
+    /// @brief Get the status of each problem of the last batch: the first status different from success among the QPs of its priorities, or success.
+    [[nodiscard]] const std::vector<QPStatus>& get_statuses() const {return statuses_;}
+
+    /// @brief Get the counters of the solves of all the threads, accumulated over all the batches.
+    [[nodiscard]] SolverStats get_solver_stats() const;
+
+    [[nodiscard]] int get_n_threads() const {return n_threads_;}
+
+    /// @brief Set the regularization used by the QPs of all the problems. It takes effect from the next batch.
+    void set_regularization(double reg) {this->regularization_ = reg;}
+
+    /// @brief Set the QP backend used by all the problems. It takes effect from the next batch.
+    void set_qp_backend(QPBackendType type) {this->qp_backend_type_ = type;}
+
+    /// @brief Set the null space representation used by all the problems. It takes effect from the next batch.
+    void set_null_space_mode(NullSpaceMode mode) {this->null_space_mode_ = mode;}
+
+private:
+    /// @brief Solve a single problem with the HierarchicalQP of a thread.
+    QPStatus solve_problem(HierarchicalQP& hqp, const HierarchicalProblem& problem, Eigen::VectorXd& solution) const;
+
+    int n_threads_;
+
+    double regularization_ = 1e-6;
+    QPBackendType qp_backend_type_ = QPBackendType::active_set;
+    NullSpaceMode null_space_mode_ = NullSpaceMode::projector;
+
+    /// @brief HierarchicalQP of each thread. */
+    std::vector<std::unique_ptr<HierarchicalQP>> workers_;
+
+    /// @brief Priority of the last task and QP backend the HierarchicalQPs of the threads have been built with. */
+    int workers_n_tasks_ = -1;
+    QPBackendType workers_qp_backend_type_ = QPBackendType::active_set;
+
+    std::vector<QPStatus> statuses_;
+
+    /// @brief Counters of the HierarchicalQPs replaced when the depth of the problems or the QP backend changed. */
+    SolverStats retired_stats_;
+};
+
+} // namespace hopt
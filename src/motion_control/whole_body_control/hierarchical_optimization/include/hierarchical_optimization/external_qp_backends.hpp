@@ -0,0 +1,94 @@
+#pragma once
+
+#include "hierarchical_optimization/qp_backend.hpp"
+
+#include <Eigen/Core>
+
+#include "eiquadprog/eiquadprog-fast.hpp"
+
+
+
+namespace hopt {
+
+/* ========================================================================== */
+/*                           QUADPROGBACKEND CLASS                            */
+/* ========================================================================== */
+
+/// @class @brief QP backend that uses the quadprog library.
+/// @details quadprog takes the problem by value and allocates its working memory at every solve. It does not report the number of iterations nor the active set.
+class QuadprogBackend : public QPBackend {
+public:
+    void reserve(int n_max, int m_max) override;
+
+    /// @brief Not reported by quadprog, always -1.
+    [[nodiscard]] int get_iterations() const override {return -1;}
+
+    /// @brief Not reported by quadprog, always empty.
+    [[nodiscard]] Eigen::Ref<const Eigen::VectorXi> get_active_set() const override {return active_set_.head(0);}
+
+protected:
+    QPStatus solve_impl(
+        Eigen::Ref<Eigen::MatrixXd> G,
+        const Eigen::Ref<const Eigen::VectorXd>& g0,
+        const Eigen::Ref<const Eigen::MatrixXd>& CI,
+        const Eigen::Ref<const Eigen::VectorXd>& ci0,
+        Eigen::Ref<Eigen::VectorXd> x,
+        int m_eq,
+        const Eigen::Ref<const Eigen::VectorXi>& working_set
+    ) override;
+
+private:
+    Eigen::VectorXd x_;
+    Eigen::VectorXi active_set_;
+};
+
+
+
+/* ========================================================================== */
+/*                          EIQUADPROGBACKEND CLASS                           */
+/* ========================================================================== */
+
+/// @class @brief QP backend that uses EiquadprogFast of the eiquadprog library.
+/// @details EiquadprogFast preallocates its working memory, but it must be reset (and reallocates it) every time the dimensions of the problem change, i.e. at almost every priority of the hierarchical QP.
+class EiquadprogBackend : public QPBackend {
+public:
+    void reserve(int n_max, int m_max) override;
+
+    [[nodiscard]] int get_iterations() const override {return iterations_;}
+
+    [[nodiscard]] Eigen::Ref<const Eigen::VectorXi> get_active_set() const override {return active_set_.head(n_active_);}
+
+protected:
+    QPStatus solve_impl(
+        Eigen::Ref<Eigen::MatrixXd> G,
+        const Eigen::Ref<const Eigen::VectorXd>& g0,
+        const Eigen::Ref<const Eigen::MatrixXd>& CI,
+        const Eigen::Ref<const Eigen::VectorXd>& ci0,
+        Eigen::Ref<Eigen::VectorXd> x,
+        int m_eq,
+        const Eigen::Ref<const Eigen::VectorXi>& working_set
+    ) override;
+
+private:
+    eiquadprog::solvers::EiquadprogFast qp_;
+
+    int n_ = -1;
+    int m_eq_ = -1;
+    int m_in_ = -1;
+
+    int iterations_ = 0;
+    int n_active_ = 0;
+
+    // EiquadprogFast takes the problem as dense matrices and vectors.
+    Eigen::MatrixXd G_;
+    Eigen::VectorXd g0_;
+    Eigen::MatrixXd CE_;
+    Eigen::VectorXd ce0_;
+    Eigen::MatrixXd CI_;
+    Eigen::VectorXd ci0_;
+    Eigen::VectorXd x_;
+
+    Eigen::VectorXi active_set_;
+};
+
+} // namespace hopt
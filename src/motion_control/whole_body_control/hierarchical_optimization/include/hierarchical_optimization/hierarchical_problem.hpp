@@ -0,0 +1,30 @@
+#pragma once
+
+#include <Eigen/Core>
+
+#include <vector>
+
+
+
+namespace hopt {
+
+/* ========================================================================== */
+/*                          HIERARCHICALTASK STRUCT                           */
+/* ========================================================================== */
+
+/// @brief A prioritized task of a hierarchical problem, with the same meaning of the arguments of HierarchicalQP::solve_qp().
+/// @details we and wi are either both empty (unit weights) or sized as b and d.
+struct HierarchicalTask {
+    Eigen::MatrixXd A;
+    Eigen::VectorXd b;
+    Eigen::MatrixXd C;
+    Eigen::VectorXd d;
+    Eigen::VectorXd we;
+    Eigen::VectorXd wi;
+    int m_eq = 0;           ///< @brief Number of inequality constraints to be treated as equalities (the first rows of C)
+};
+
+/// @brief A whole hierarchical problem: its tasks, sorted from priority 0 to the lowest priority.
+using HierarchicalProblem = std::vector<HierarchicalTask>;
+
+} // namespace hopt
@@ -1,52 +1,346 @@
 #pragma once
 
+#include "hierarchical_optimization/active_set_qp.hpp"
+#include "hierarchical_optimization/hierarchical_solver.hpp"
+#include "hierarchical_optimization/problem_capture.hpp"
+#include "hierarchical_optimization/qp_backend.hpp"
+#include "hierarchical_optimization/solver_diagnostics.hpp"
+
 #include <Eigen/Core>
 
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
 
 
 namespace hopt {
 
-/// @class @brief
-class HierarchicalQP {
+/// @brief How the null space of the higher priority tasks is represented.
+/// @details projector: Z is the n x n projector I - pinv(M) M, and every QP is solved in the full variable space.
+/// basis: Z is an n x r orthonormal basis of the null space, and the QP of each priority only has the r variables of the remaining null space. The stack of the inequality constraints is kept projected in this basis.
+enum class NullSpaceMode {projector, basis};
+
+
+
+namespace internal {
+
+/// @brief Sum of two compile-time dimensions, Eigen::Dynamic if one of them is Eigen::Dynamic.
+constexpr int dim_sum(int a, int b)
+{
+    return (a == Eigen::Dynamic || b == Eigen::Dynamic) ? Eigen::Dynamic : a + b;
+}
+
+/// @brief Maximum of two compile-time dimensions, Eigen::Dynamic if one of them is Eigen::Dynamic.
+constexpr int dim_max(int a, int b)
+{
+    return (a == Eigen::Dynamic || b == Eigen::Dynamic) ? Eigen::Dynamic : (a > b ? a : b);
+}
+
+/// @brief True if a matrix of doubles with these compile-time maximum dimensions can be stored inside the object (Eigen limits the size of such matrices to EIGEN_STACK_ALLOCATION_LIMIT bytes).
+constexpr bool fits_in_object(int rows_max, int cols_max)
+{
+    return rows_max != Eigen::Dynamic && cols_max != Eigen::Dynamic
+        && static_cast<long>(rows_max) * cols_max * static_cast<long>(sizeof(double)) <= EIGEN_STACK_ALLOCATION_LIMIT;
+}
+
+} // namespace internal
+
+
+
+/* ========================================================================== */
+/*                          BASICHIERARCHICALQP CLASS                         */
+/* ========================================================================== */
+
+/// @class @brief Hierarchical QP solver, whose matrices have at most the given compile-time dimensions.
+/// @details With Eigen::Dynamic dimensions (HierarchicalQP), the buffers are allocated on the heap by reserve().
+/// With fixed maximum dimensions (FixedHierarchicalQP), the buffers are stored inside the object, and reserve() throws std::length_error if the requested dimensions exceed the maximum ones.
+/// Only the QP backend, and the matrices larger than EIGEN_STACK_ALLOCATION_LIMIT, are still allocated on the heap (once, by reserve()).
+/// The object is large: it should be a class member, not a local variable of a thread with a small stack.
+/// @tparam SolDimMax maximum dimension of the optimization vector
+/// @tparam EqRowsMax maximum number of equality constraints of a single priority
+/// @tparam IneqRowsMax maximum number of inequality constraints of all the priorities together
+template<int SolDimMax, int EqRowsMax, int IneqRowsMax>
+class BasicHierarchicalQP : public HierarchicalSolver {
+    // Matrices too large to be stored inside the object are allocated on the heap, once, by reserve().
+    template<int RowsMax, int ColsMax, typename Scalar = double>
+    using MatrixMax = Eigen::Matrix<
+        Scalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor,
+        internal::fits_in_object(RowsMax, ColsMax) ? RowsMax : Eigen::Dynamic,
+        internal::fits_in_object(RowsMax, ColsMax) ? ColsMax : Eigen::Dynamic
+    >;
+
+    template<int SizeMax>
+    using VectorMax = Eigen::Matrix<double, Eigen::Dynamic, 1, Eigen::ColMajor, SizeMax, 1>;
+
+    template<int SizeMax>
+    using IndexVectorMax = Eigen::Matrix<int, Eigen::Dynamic, 1, Eigen::ColMajor, SizeMax, 1>;
+
+    /// @brief Maximum number of variables (optimization vector and slack variables) of the QP of a priority.
+    static constexpr int QPVarsMax = internal::dim_sum(SolDimMax, IneqRowsMax);
+
+    /// @brief Maximum number of constraints of the QP of a priority.
+    static constexpr int QPConstraintsMax = internal::dim_sum(IneqRowsMax, IneqRowsMax);
+
 public:
     /// @brief Construct a new Hierarchical QP object.
     /// @param[in] nTasks the total number of tasks with different priorities of the Hierarchical QP
-    HierarchicalQP(int n_tasks)
-    : n_tasks_(n_tasks)
+    BasicHierarchicalQP(int n_tasks)
+    : n_tasks_(n_tasks),
+      task_ranks_(n_tasks + 1, -1),
+      level_solve_times_(n_tasks + 1, 0),
+      qp_solver_(std::make_unique<ActiveSetQP>()),
+      warm_start_memory_(n_tasks + 1)
     {}
 
+    /// @brief Preallocate the memory, so that the problems within these dimensions are solved without heap allocations.
+    /// @throws std::length_error if a dimension exceeds its compile-time maximum.
+    /// @param[in] sol_dim maximum dimension of the optimization vector
+    /// @param[in] eq_rows maximum number of equality constraints of a single task
+    /// @param[in] ineq_rows maximum number of inequality constraints of all the tasks together
+    void reserve(int sol_dim, int eq_rows, int ineq_rows) override;
+
+    void set_n_tasks(int n_tasks) override;
+
     /// @brief Solve a single prioritized task of the hierarchical QP problem.
     void solve_qp(
         int priority,
-        const Eigen::MatrixXd& A,
-        const Eigen::VectorXd& b,
-        const Eigen::MatrixXd& C,
-        const Eigen::VectorXd& d,
-        const Eigen::VectorXd& we,
-        const Eigen::VectorXd& wi,
-        int m_eq = 0
+        const Eigen::Ref<const Eigen::MatrixXd>& A,
+        const Eigen::Ref<const Eigen::VectorXd>& b,
+        const Eigen::Ref<const Eigen::MatrixXd>& C,
+        const Eigen::Ref<const Eigen::VectorXd>& d,
+        const Eigen::Ref<const Eigen::VectorXd>& we,
+        const Eigen::Ref<const Eigen::VectorXd>& wi
+    ) override {
+        solve_qp(priority, A, b, C, d, we, wi, 0);
+    }
+
+    /// @brief Solve a single prioritized task of the hierarchical QP problem.
+    void solve_qp(
+        int priority,
+        const Eigen::Ref<const Eigen::MatrixXd>& A,
+        const Eigen::Ref<const Eigen::VectorXd>& b,
+        const Eigen::Ref<const Eigen::MatrixXd>& C,
+        const Eigen::Ref<const Eigen::VectorXd>& d,
+        const Eigen::Ref<const Eigen::VectorXd>& we,
+        const Eigen::Ref<const Eigen::VectorXd>& wi,
+        int m_eq
     );
 
     /// @brief Solve a single prioritized task of the hierarchical QP problem.
     void solve_qp(
         int priority,
-        const Eigen::MatrixXd& A,
-        const Eigen::VectorXd& b,
-        const Eigen::MatrixXd& C,
-        const Eigen::VectorXd& d,
+        const Eigen::Ref<const Eigen::MatrixXd>& A,
+        const Eigen::Ref<const Eigen::VectorXd>& b,
+        const Eigen::Ref<const Eigen::MatrixXd>& C,
+        const Eigen::Ref<const Eigen::VectorXd>& d,
         int m_eq = 0
     );
 
     /// @brief Get the QP problem solution
-    Eigen::VectorXd get_sol() const {return sol_;}
+    [[nodiscard]] Eigen::Ref<const Eigen::VectorXd> get_sol() const override {return sol_.head(sol_dim_);}
 
-    void set_regularization(double reg) {this->regularization_ = reg;}
+    /// @brief Get the dimension of the null space left by the tasks solved so far (the number of columns of Z used).
+    [[nodiscard]] int get_null_space_dimension() const {return null_dim_;}
+
+    /// @brief Get the number of directions of the optimization vector that are not fixed by the tasks solved so far (in both the null space modes).
+    [[nodiscard]] int get_free_dimension() const {return free_dim_;}
+
+    /// @brief Return true if the tasks solved so far fix the whole optimization vector, and solve_qp() skips the QPs of the lower priority tasks.
+    [[nodiscard]] bool is_fully_constrained() const {return free_dim_ == 0;}
+
+    /// @brief Get the rank of A Z of the task of the given priority, i.e. the number of directions of the null space fixed by the task.
+    /// @return -1 if the task has not been solved yet in the current problem, or if it is the last one (its null space is not computed).
+    [[nodiscard]] int get_task_rank(int priority) const
+    {
+        return priority < static_cast<int>(task_ranks_.size()) ? task_ranks_[priority] : -1;
+    }
+
+    /// @brief Enable the warm start of the QP of each priority with its active set of the previous cycle.
+    void set_warm_start(bool warm_start) {this->warm_start_ = warm_start;}
+
+    /// @brief Set the key of the problem structure (e.g. the contact configuration). The QPs are warm started only if it did not change.
+    void set_warm_start_key(std::uint64_t key) {this->warm_start_key_ = key;}
+
+    /// @brief Get the QP backend, e.g. to read the status, the iterations, and the solve time of the last solved QP.
+    [[nodiscard]] const QPBackend& get_qp_backend() const {return *qp_solver_;}
+
+    /// @brief Set the solver of the QP of each priority. It must not be called while a hierarchical problem is being solved.
+    void set_qp_backend(QPBackendType type);
+
+    /// @brief Set the representation of the null space of the higher priority tasks, from the next problem on.
+    void set_null_space_mode(NullSpaceMode mode) {this->null_space_mode_ = mode;}
+
+    /// @brief Set the time available to solve a whole hierarchical problem [s]. The tasks that would exceed it are not solved. A non-positive budget disables the limit.
+    void set_time_budget(double time_budget) {this->time_budget_ = time_budget;}
+
+    /// @brief Return true if the task of the given priority can be solved within the time budget of the current problem.
+    [[nodiscard]] bool fits_time_budget(int priority) const;
+
+    /// @brief Skip the tasks from the given priority to the last one, to be called instead of solve_qp() when fits_time_budget() is false.
+    void skip_remaining(int priority);
+
+    /// @brief Get the number of priorities solved in the current problem (including the ones skipped since the optimization vector was already fully constrained).
+    [[nodiscard]] int get_solved_levels() const {return solved_levels_;}
+
+    /// @brief Return true if the time budget stopped the current problem before its last task.
+    [[nodiscard]] bool is_time_budget_exhausted() const {return time_budget_exhausted_;}
+
+    /// @brief Enable the closed-form solution of the tasks without inequality constraints of their own (enabled by default).
+    void set_fast_path(bool fast_path) {this->fast_path_ = fast_path;}
+
+    /// @brief Enable the removal of the inactive and duplicated inequality constraints before calling the QP backend (see SolverStats::pruned_constraints).
+    void set_constraint_pruning(bool constraint_pruning) {this->constraint_pruning_ = constraint_pruning;}
+
+    /// @brief Solve the equality part of the tasks from the given priority on in mixed precision.
+    /// @param[in] first_priority first priority solved in mixed precision. A negative one (the default) disables it. The task with priority 0 is always solved in double precision.
+    void set_mixed_precision(int first_priority) {this->mixed_precision_priority_ = first_priority;}
+
+    /// @brief Set the buffer of the LevelDiagnostics records, in which the failures are then reported instead of printed. nullptr disables the records.
+    void set_diagnostics_buffer(std::shared_ptr<DiagnosticsBuffer> buffer) {this->diagnostics_buffer_ = std::move(buffer);}
+
+    /// @brief Set the recorder of the problems that fail, overrun, or are requested. nullptr (the default) disables the capture. It must not be called while a hierarchical problem is being solved.
+    void set_problem_capture(std::shared_ptr<ProblemCapture> capture)
+    {
+        this->problem_capture_ = std::move(capture);
+        this->capture_open_ = false;
+    }
 
 private:
-    /// @brief Compute the null space projector of a matrix M.
-    /// @param[in] M
-    /// @return Eigen::MatrixXd Square matrix of dimension (A_cols, A_cols)
-    static Eigen::MatrixXd null_space_projector(const Eigen::MatrixXd& M);
+    /// @brief Solve a single prioritized task (already weighted), checking the time budget.
+    void solve_level(
+        int priority,
+        const Eigen::Ref<const Eigen::MatrixXd>& A,
+        const Eigen::Ref<const Eigen::VectorXd>& b,
+        const Eigen::Ref<const Eigen::MatrixXd>& C,
+        const Eigen::Ref<const Eigen::VectorXd>& d,
+        int m_eq
+    );
+
+    /// @brief Record a task in the problem capture, starting a new problem with priority 0.
+    void capture_level(
+        int priority,
+        const Eigen::Ref<const Eigen::MatrixXd>& A,
+        const Eigen::Ref<const Eigen::VectorXd>& b,
+        const Eigen::Ref<const Eigen::MatrixXd>& C,
+        const Eigen::Ref<const Eigen::VectorXd>& d,
+        const Eigen::Ref<const Eigen::VectorXd>& we,
+        const Eigen::Ref<const Eigen::VectorXd>& wi,
+        int m_eq
+    );
+
+    /// @brief Count and record a task not solved for the time budget.
+    void record_budget_skip(int priority);
+
+    /// @brief Update the outcome of the captured problem after the solve of a task, and end it after the lowest priority one.
+    void update_capture(int priority);
+
+    /// @brief End the captured problem, which is written to file if it must be captured.
+    void finish_capture();
+
+    /// @brief Solve a single prioritized task, without checking the time budget.
+    void solve_task(
+        int priority,
+        const Eigen::Ref<const Eigen::MatrixXd>& A,
+        const Eigen::Ref<const Eigen::VectorXd>& b,
+        const Eigen::Ref<const Eigen::MatrixXd>& C,
+        const Eigen::Ref<const Eigen::VectorXd>& d,
+        int m_eq
+    );
+
+    /// @brief Preallocated memory of the matrices used by solve_qp.
+    struct Workspace {
+        void resize(int sol_dim, int eq_rows, int ineq_rows);
+
+        MatrixMax<EqRowsMax, SolDimMax> A_w;        ///< @brief A weighted by we
+        VectorMax<EqRowsMax> b_w;        ///< @brief b weighted by we
+        MatrixMax<IneqRowsMax, SolDimMax> C_w;        ///< @brief C weighted by wi
+        VectorMax<IneqRowsMax> d_w;        ///< @brief d weighted by wi
+
+        MatrixMax<EqRowsMax, SolDimMax> AZ;         ///< @brief A projected in the null space of the higher priority tasks
+        VectorMax<EqRowsMax> res;        ///< @brief Residual A x_opt - b
+
+        MatrixMax<QPVarsMax, QPVarsMax> G;
+        VectorMax<QPVarsMax> g0;
+        MatrixMax<QPConstraintsMax, QPVarsMax> CI;
+        VectorMax<QPConstraintsMax> ci0;
+        VectorMax<QPVarsMax> xi_opt;
+
+        MatrixMax<SolDimMax, EqRowsMax> W;          ///< @brief Householder QR factors of (A Z)^T
+        VectorMax<EqRowsMax> h_coeffs;   ///< @brief Householder coefficients of the QR decomposition
+        VectorMax<EqRowsMax> col_norms;  ///< @brief Squared norms of the columns of W not yet decomposed
+        MatrixMax<SolDimMax, EqRowsMax> Q1;         ///< @brief Orthonormal basis of the row space of A Z
+        MatrixMax<SolDimMax, EqRowsMax> ZQ1;        ///< @brief Z_ Q1
+        VectorMax<internal::dim_max(SolDimMax, internal::dim_max(EqRowsMax, IneqRowsMax))> h_work;     ///< @brief Workspace for applying the Householder reflections
+
+        VectorMax<SolDimMax> grad;       ///< @brief A^T (A x_opt - b), in mixed precision
+
+        MatrixMax<SolDimMax, SolDimMax> L;          ///< @brief Cholesky factor of G, for the unconstrained step
+        VectorMax<QPConstraintsMax> s;   ///< @brief CI xi + ci0 at the unconstrained step
+
+        VectorMax<SolDimMax> z_u;        ///< @brief Unconstrained minimum of the QP, for the pruning of the constraints
+        VectorMax<SolDimMax> y;          ///< @brief L^-1 a, for a row a of CI
+        IndexVectorMax<QPVarsMax> working_set;          ///< @brief Active set of the previous cycle, with the indices of the pruned QP
+        IndexVectorMax<internal::dim_sum(QPConstraintsMax, QPConstraintsMax)> kept;        ///< @brief Index before the pruning of each constraint of the pruned QP, followed by the one of the upper side of each range
+        IndexVectorMax<QPConstraintsMax> pruned_index;  ///< @brief Index in the pruned QP of each constraint (-1 if dropped)
+        VectorMax<QPConstraintsMax> ci_upper;           ///< @brief Upper offsets of the constraints of the pruned QP, infinite if they are not ranges
+        VectorMax<QPConstraintsMax> row_scale;          ///< @brief Largest magnitude of the entries of each row of CI, for the comparison of the directions
+        VectorMax<QPConstraintsMax> row_sign;           ///< @brief Sign that makes the first nonzero entry of each row of CI positive
+        IndexVectorMax<internal::dim_sum(QPConstraintsMax, QPConstraintsMax)> row_table;   ///< @brief Hash table of the kept rows of CI, by direction
+
+        // Single precision copies of the operands of the products computed in mixed precision.
+        MatrixMax<EqRowsMax, SolDimMax, float> A_f;
+        MatrixMax<SolDimMax, SolDimMax, float> Z_f;
+        MatrixMax<EqRowsMax, SolDimMax, float> AZ_f;
+        MatrixMax<SolDimMax, SolDimMax, float> G_f;
+    };
+
+    /// @brief Compute the Cholesky factor L of the block of G of the optimization vector (the first nz variables), stored in the workspace.
+    /// @param[in] identity_block true if the block is regularization_ I, whose factor is computed directly
+    /// @return false if the block is not positive definite.
+    bool factorize_hessian(int nz, bool identity_block);
+
+    /// @brief Drop from CI and ci0 (in the workspace) the inequality constraints that are inactive at the solution of the QP, and the duplicated ones, and merge the opposite ones into ranges. The kept constraints are compacted at the top, in the same order.
+    /// @details Requires the factorization computed by factorize_hessian().
+    /// @param[out] n_ranges number of kept constraints that are ranges, with the upper offsets in ci_upper (in the workspace)
+    /// @return the number of constraints kept
+    int prune_constraints(int nz, int C_rows, int n_constraints, int m_eq, int& n_ranges);
+
+    /// @brief Solve the QP of a task without inequality constraints of its own, ignoring the ones of the higher priority tasks, with the matrices stored in the workspace.
+    /// @details Requires the factorization computed by factorize_hessian().
+    /// @return true if the solution, stored in xi_opt, satisfies the inequality constraints of the higher priority tasks (and is therefore the solution of the QP).
+    bool solve_unconstrained(int n_vars, int n_constraints);
+
+    /// @brief Compute the Householder QR decomposition with column pivoting of M^T, with M = A Z_ stored in the workspace AZ.
+    /// @param[in] rows number of rows of M
+    /// @return the rank of M
+    int decompose_row_space(int rows);
+
+    /// @brief Update the null space projector Z_, so that it also projects in the null space of M = A Z_.
+    /// @details Z_ <- Z_ (I - pinv(M) M) = Z_ - (Z_ Q1) Q1^T, where the columns of Q1 are an orthonormal basis of the row space of M.
+    /// @param[in] rows number of rows of M, stored in the workspace AZ
+    /// @return the rank of M
+    int update_null_space_projector(int rows);
+
+    /// @brief Update the null space basis Z_ (and the projected stack of the inequality constraints), so that it is also a basis of the null space of M = A Z_.
+    /// @details With M^T P = Q R, Z_ <- Z_ Q2, where the columns of Q2 are the last r - rank columns of Q.
+    /// @param[in] rows number of rows of M, stored in the workspace AZ
+    /// @return the rank of M
+    int update_null_space_basis(int rows);
+
+    /// @brief Active set found at a priority, used to warm start the same priority in the next cycle.
+    struct WarmStartEntry {
+        bool valid = false;
+        std::uint64_t key = 0;
+        int n_variables = 0;
+        int n_constraints = 0;
+        int n_active = 0;
+        Eigen::Matrix<int, Eigen::Dynamic, 1, Eigen::ColMajor, QPVarsMax, 1> active_set;
+    };
 
     /// @brief Reset the class attributes before starting a new optimization problem.
     /// @param[in] solDim dimension of the optimization vector
@@ -57,21 +351,104 @@ private:
     /// @brief Total number of tasks with different priorities */
     int n_tasks_;
 
-    /// @brief Regularization factor introduced in order to ensure that G is Positive Definite. */
-    double regularization_ = 1e-6;
+    /// @brief Dimensions the buffers are sized for. */
+    int sol_dim_max_ = 0;
+    int eq_rows_max_ = 0;
+    int ineq_rows_max_ = 0;
+
+    /// @brief Dimension of the optimization vector of the current problem. */
+    int sol_dim_ = 0;
+
+    NullSpaceMode null_space_mode_ = NullSpaceMode::projector;
+
+    /// @brief Null space representation used by the current problem. */
+    NullSpaceMode active_null_space_mode_ = NullSpaceMode::projector;
+
+    /// @brief Number of columns of Z_ used: the dimension of the null space with NullSpaceMode::basis, the dimension of the optimization vector with NullSpaceMode::projector. */
+    int null_dim_ = 0;
+
+    /// @brief Dimension of the optimization vector minus the ranks of the tasks solved so far. */
+    int free_dim_ = 0;
+
+    /// @brief Rank of A Z of each priority of the current problem. */
+    std::vector<int> task_ranks_;
+
+    bool fast_path_ = true;
+
+    bool constraint_pruning_ = false;
+
+    /// @brief First priority solved in mixed precision. Negative if disabled. */
+    int mixed_precision_priority_ = -1;
+
+    /// @brief Time available to solve a whole problem [s]. Not limited if non-positive. */
+    double time_budget_ = 0;
+
+    /// @brief Time of the call of solve_qp() with priority 0 of the current problem. */
+    std::chrono::steady_clock::time_point problem_start_;
+
+    /// @brief Duration of the solve of each priority in the last problem in which it was solved [s], used to predict the next one. */
+    std::vector<double> level_solve_times_;
+
+    int solved_levels_ = 0;
+    bool time_budget_exhausted_ = false;
+
+    std::shared_ptr<DiagnosticsBuffer> diagnostics_buffer_;
+
+    std::shared_ptr<ProblemCapture> problem_capture_;
+
+    /// @brief True while the tasks of a problem are being recorded in problem_capture_. */
+    bool capture_open_ = false;
+    /// @brief True if the QP of a task of the captured problem did not succeed. */
+    bool problem_failed_ = false;
+    /// @brief Time spent on the captured problem so far [s]. */
+    double problem_wall_time_ = 0;
+
+    /// @brief Number of problems solved so far. */
+    long cycle_ = 0;
+
+    /// @brief Diagnostics of the last task, filled by solve_task(). */
+    LevelDiagnostics level_diagnostics_;
 
     /// @brief Optimization vector. */
-    Eigen::VectorXd sol_;
+    VectorMax<SolDimMax> sol_;
 
-    /// @brief Null Space basis of the stack of equality constraints. */
-    Eigen::MatrixXd Z_;
+    /// @brief Null Space projector (or basis) of the stack of equality constraints. */
+    MatrixMax<SolDimMax, SolDimMax> Z_;
 
-    /// @brief Stack of the inequality constraints matrices Cp. */
-    Eigen::MatrixXd C_stack_;
-    /// @brief Stack of the inequality constraints vectord dp. */
-    Eigen::VectorXd d_stack_;
+    /// @brief Stack of the inequality constraints matrices Cp. With NullSpaceMode::basis, it stores C_stack Z_. */
+    MatrixMax<IneqRowsMax, SolDimMax> C_stack_;
+    /// @brief Stack of the inequality constraints vectord dp. With NullSpaceMode::basis, it stores d_stack - C_stack x_opt. */
+    VectorMax<IneqRowsMax> d_stack_;
     /// @brief Stack of the optimal slack variables wOpt (wi * (C x - d) <= w). */
-    Eigen::VectorXd w_opt_stack_;
+    VectorMax<IneqRowsMax> w_opt_stack_;
+
+    /// @brief Number of rows currently used in C_stack_, d_stack_, and w_opt_stack_. */
+    int C_stack_rows_ = 0;
+    int w_opt_stack_rows_ = 0;
+
+    Workspace ws_;
+
+    std::unique_ptr<QPBackend> qp_solver_;
+
+    bool warm_start_ = false;
+    std::uint64_t warm_start_key_ = 0;
+
+    /// @brief Active set of the previous cycle, for each priority. */
+    std::vector<WarmStartEntry> warm_start_memory_;
 };
 
-} // namespace hopt
\ No newline at end of file
+
+
+/// @brief Hierarchical QP solver with heap allocated buffers, for problems of any dimension.
+using HierarchicalQP = BasicHierarchicalQP<Eigen::Dynamic, Eigen::Dynamic, Eigen::Dynamic>;
+
+/// @brief Hierarchical QP solver with buffers of fixed maximum dimensions, stored inside the object.
+template<int SolDimMax, int EqRowsMax, int IneqRowsMax>
+using FixedHierarchicalQP = BasicHierarchicalQP<SolDimMax, EqRowsMax, IneqRowsMax>;
+
+// The dynamic version is compiled once in the library.
+extern template class BasicHierarchicalQP<Eigen::Dynamic, Eigen::Dynamic, Eigen::Dynamic>;
+
+} // namespace hopt
+
+#include "hierarchical_optimization/hierarchical_qp_impl.hpp"
\ No newline at end of file
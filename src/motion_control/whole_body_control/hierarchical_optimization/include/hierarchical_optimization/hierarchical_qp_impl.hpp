@@ -0,0 +1,1304 @@
+#pragma once
+
+// Definitions of the BasicHierarchicalQP class template, included by hierarchical_qp.hpp.
+
+#include "hierarchical_optimization/hierarchical_qp.hpp"
+
+#include <Eigen/Cholesky>
+#include <Eigen/Householder>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+
+
+
+namespace hopt {
+
+/* ========================================================================== */
+/*                                   SOLVEQP                                  */
+/* ========================================================================== */
+
+/*
+    A general task T can be defined as
+
+        [ we * (A x - b)  = v
+    T = [
+        [ wi * (C x - d) <= w
+
+    where v and w are slack variables.
+
+    Is is formulated as a QP problem
+
+    min_x 1/2 (A x - b)^2 + 1/2 w^2,
+    s.t.: C x - d <= w.
+
+    It can be rewritten in the general QP form:
+
+    min_x 1/2 xi^T G xi + g0^T xi
+    s.t: CI xi + ci0 >= 0
+
+    where:
+
+    G   =   A^T A
+    g0  = - A^T b
+
+    CI  = [ -C, 0 ]
+          [  0, I ]
+    ci0 = [ d ]
+          [ 0 ]
+
+    xi  = [ x ]
+          [ w ]
+
+    ============================================================================
+
+    Given a set of tasks T1, ..., Tn, for the task Tp the QP problem becomes:
+
+    G   = [ Zq^T Ap^T Ap Zq, 0 ]
+          [               0, I ]
+    g0  = [ Zq^T Ap^T (Ap x_opt - bp) ]
+          [                         0 ]
+
+    CI  = [   0,       I      ]
+          [ - C_stack, [0; I] ]
+    ci0 = [ 0                                    ]
+          [ d - C_stack x_opt + [w_opt_stack; 0] ]
+*/
+
+template<int SolDimMax, int EqRowsMax, int IneqRowsMax>
+void BasicHierarchicalQP<SolDimMax, EqRowsMax, IneqRowsMax>::solve_qp(
+    int priority,
+    const Eigen::Ref<const Eigen::MatrixXd>& A,
+    const Eigen::Ref<const Eigen::VectorXd>& b,
+    const Eigen::Ref<const Eigen::MatrixXd>& C,
+    const Eigen::Ref<const Eigen::VectorXd>& d,
+    const Eigen::Ref<const Eigen::VectorXd>& we,
+    const Eigen::Ref<const Eigen::VectorXd>& wi,
+    int m_eq
+) {
+    /* ========================= Weighted A, b, C, d ======================== */
+
+    // Construct the matrices A, b, C, d weighted by we and wi.
+    // Each element of we and wi multiplies a whole row of A and C respectively (and an element of b and d). This is more easily implemented using Eigen arrays.
+
+    const int A_rows = static_cast<int>(A.rows());
+    const int C_rows = static_cast<int>(C.rows());
+    const int cols = static_cast<int>(A.cols());
+
+    // Enlarge the buffers here if necessary, so that A_w and C_w are not reallocated by the call below.
+    reserve(cols, A_rows, (priority == 0 ? 0 : C_stack_rows_) + C_rows);
+
+    auto A_w = ws_.A_w.topLeftCorner(A_rows, cols);
+    auto b_w = ws_.b_w.head(A_rows);
+    auto C_w = ws_.C_w.topLeftCorner(C_rows, cols);
+    auto d_w = ws_.d_w.head(C_rows);
+
+    if (A_rows > 0) {
+        A_w = A.array().colwise() * we.array();
+        b_w = b.array() * we.array();
+    }
+    if (C_rows > 0) {
+        C_w = C.array().colwise() * wi.array();
+        d_w = d.array() * wi.array();
+    }
+
+
+    /* ============================ Solve The QP ============================ */
+
+    // The task is captured as it has been passed, with its weights.
+    if (problem_capture_) {
+        capture_level(priority, A, b, C, d, we, wi, m_eq);
+    }
+
+    solve_level(
+        priority,
+        A_w, b_w,
+        C_w, d_w,
+        m_eq
+    );
+
+    if (capture_open_) {
+        update_capture(priority);
+    }
+}
+
+
+
+template<int SolDimMax, int EqRowsMax, int IneqRowsMax>
+void BasicHierarchicalQP<SolDimMax, EqRowsMax, IneqRowsMax>::solve_qp(
+    int priority,
+    const Eigen::Ref<const Eigen::MatrixXd>& A,
+    const Eigen::Ref<const Eigen::VectorXd>& b,
+    const Eigen::Ref<const Eigen::MatrixXd>& C,
+    const Eigen::Ref<const Eigen::VectorXd>& d,
+    int m_eq
+) {
+    if (problem_capture_) {
+        capture_level(priority, A, b, C, d, Eigen::VectorXd(), Eigen::VectorXd(), m_eq);
+    }
+
+    solve_level(priority, A, b, C, d, m_eq);
+
+    if (capture_open_) {
+        update_capture(priority);
+    }
+}
+
+
+
+/* ========================================================================== */
+/*                                 SOLVE_LEVEL                                */
+/* ========================================================================== */
+
+template<int SolDimMax, int EqRowsMax, int IneqRowsMax>
+void BasicHierarchicalQP<SolDimMax, EqRowsMax, IneqRowsMax>::solve_level(
+    int priority,
+    const Eigen::Ref<const Eigen::MatrixXd>& A,
+    const Eigen::Ref<const Eigen::VectorXd>& b,
+    const Eigen::Ref<const Eigen::MatrixXd>& C,
+    const Eigen::Ref<const Eigen::VectorXd>& d,
+    int m_eq
+) {
+    const auto start = std::chrono::steady_clock::now();
+
+    if (priority == 0) {
+        problem_start_ = start;
+        solved_levels_ = 0;
+        time_budget_exhausted_ = false;
+        cycle_++;
+    } else if (time_budget_exhausted_ || !fits_time_budget(priority)) {
+        // The solution of the higher priority tasks is kept.
+        record_budget_skip(priority);
+
+        return;
+    }
+
+    solve_task(priority, A, b, C, d, m_eq);
+
+    solved_levels_ = priority + 1;
+
+    const double wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (priority < static_cast<int>(level_solve_times_.size())) {
+        level_solve_times_[priority] = wall_time;
+    }
+
+    if (diagnostics_buffer_) {
+        level_diagnostics_.cycle = cycle_;
+        level_diagnostics_.priority = priority;
+        level_diagnostics_.free_dimension = free_dim_;
+        level_diagnostics_.regularization = regularization_;
+        level_diagnostics_.wall_time = wall_time;
+        diagnostics_buffer_->push(level_diagnostics_);
+    }
+}
+
+
+
+/* ========================================================================== */
+/*                                 SOLVE_TASK                                 */
+/* ========================================================================== */
+
+template<int SolDimMax, int EqRowsMax, int IneqRowsMax>
+void BasicHierarchicalQP<SolDimMax, EqRowsMax, IneqRowsMax>::solve_task(
+    int priority,
+    const Eigen::Ref<const Eigen::MatrixXd>& A,
+    const Eigen::Ref<const Eigen::VectorXd>& b,
+    const Eigen::Ref<const Eigen::MatrixXd>& C,
+    const Eigen::Ref<const Eigen::VectorXd>& d,
+    int m_eq
+) {
+    /* =================== Setup The Optimization Problem =================== */
+
+    const int A_rows = static_cast<int>(A.rows());    // Number of the equality constraints of this optimization step
+    const int A_cols = static_cast<int>(A.cols());    // Dimension of the optimization vector (not counting the slack variables)
+    const int C_rows = static_cast<int>(C.rows());    // Number of the inequality constraints of this optimization step
+
+    if (priority == 0) {
+        reset_qp(A_cols);
+    }
+
+    // Enlarge the buffers if this task does not fit in them (only during the warm-up).
+    reserve(A_cols, A_rows, C_stack_rows_ + C_rows);
+
+    const int nz = null_dim_;   // Number of variables of this optimization step (not counting the slack variables)
+
+    auto sol = sol_.head(A_cols);
+    auto Z = Z_.topLeftCorner(A_cols, nz);
+
+    // In mixed precision, the products of A with Z are computed in single precision (see set_mixed_precision()).
+    const bool mixed = priority != 0 && mixed_precision_priority_ >= 0 && priority >= mixed_precision_priority_;
+
+    auto Z_f = ws_.Z_f.topLeftCorner(A_cols, nz);
+    if (mixed) {
+        Z_f = Z.template cast<float>();
+    }
+
+
+    /* ===================== Update C_stack_ And d_stack_ ===================== */
+
+    //           [ C1 ]               [ d1 ]
+    // C_stack = [ C2 ]     d_stack = [ d2 ]
+    //           [ .. ]               [ .. ]
+    //           [ Cp ]               [ dp ]
+
+    // With NullSpaceMode::basis, the rows are stored already projected in the null space basis, (Cp Z, dp - Cp x_opt), and are kept updated as Z and x_opt change.
+
+    if (C_rows > 0) {
+        if (active_null_space_mode_ == NullSpaceMode::projector || priority == 0) {
+            C_stack_.block(C_stack_rows_, 0, C_rows, A_cols) = C;
+            d_stack_.segment(C_stack_rows_, C_rows) = d;
+        } else {
+            // Also in mixed precision: these rows constrain all the lower priority tasks.
+            C_stack_.block(C_stack_rows_, 0, C_rows, nz).noalias() = C * Z;
+            d_stack_.segment(C_stack_rows_, C_rows) = d;
+            d_stack_.segment(C_stack_rows_, C_rows).noalias() -= C * sol;
+        }
+
+        C_stack_rows_ += C_rows;
+    }
+
+    const int C_stack_rows = C_stack_rows_;
+
+    auto d_stack = d_stack_.head(C_stack_rows);
+
+
+    /* ====================== Fully Constrained Problem ===================== */
+
+    // When the higher priority tasks fix the whole optimization vector, the QP has only the slack variables, and its solution is w = max(0, C x - d).
+
+    if (priority != 0 && free_dim_ == 0) {
+        if (priority < static_cast<int>(task_ranks_.size())) {
+            task_ranks_[priority] = 0;
+        }
+
+        level_diagnostics_.result = LevelResult::fully_constrained;
+        level_diagnostics_.status = QPStatus::success;
+        level_diagnostics_.iterations = 0;
+        level_diagnostics_.n_active = 0;
+        level_diagnostics_.slack_norm = 0;
+        level_diagnostics_.rank = 0;
+
+        if (C_rows > 0) {
+            auto w = w_opt_stack_.segment(w_opt_stack_rows_, C_rows);
+            w = - d;
+            w.noalias() += C * sol;
+            w = w.cwiseMax(0);
+
+            level_diagnostics_.slack_norm = w.norm();
+
+            // The slack variables of the last task are not needed by any other task.
+            if (priority < n_tasks_) {
+                w_opt_stack_rows_ += C_rows;
+            }
+        }
+
+        solver_stats_.skipped++;
+
+        return;
+    }
+
+    // A Z is needed both for G and g0, and for the null space projector of the next task.
+    auto AZ = ws_.AZ.topLeftCorner(A_rows, nz);
+    auto AZ_f = ws_.AZ_f.topLeftCorner(A_rows, nz);
+    if (priority == 0) {
+        AZ = A;
+    } else if (A_rows > 0 && mixed) {
+        auto A_f = ws_.A_f.topLeftCorner(A_rows, A_cols);
+        A_f = A.template cast<float>();
+        AZ_f.noalias() = A_f * Z_f;
+        AZ = AZ_f.template cast<double>();
+    } else if (A_rows > 0) {
+        AZ.noalias() = A * Z;
+    }
+
+
+    /* ========================== Compute G And g0 ========================== */
+
+    /*
+        G  = [ Zq^T Ap^T Ap Zq, 0
+                             0, I ]
+        g0 = [ Zq^T Ap^T (Ap x_opt - bp)
+                                       0 ]
+    */
+
+    auto G = ws_.G.topLeftCorner(nz + C_rows, nz + C_rows);
+    auto g0 = ws_.g0.head(nz + C_rows);
+
+    G.setIdentity();
+    g0.setZero();
+
+    if (priority != 0 && A_rows > 0 && mixed) {
+        auto G_f = ws_.G_f.topLeftCorner(nz, nz);
+        G_f.noalias() = AZ_f.transpose() * AZ_f;
+        G.topLeftCorner(nz, nz) = G_f.template cast<double>();
+
+        // The rounding errors of G_f are of the order of the float epsilon times its trace. With NullSpaceMode::projector, G is singular, and they would make it indefinite: they are covered by an additional regularization.
+        G.topLeftCorner(nz, nz).diagonal().array() += std::numeric_limits<float>::epsilon() * static_cast<double>(G_f.diagonal().maxCoeff());
+
+        auto res = ws_.res.head(A_rows);
+        res = - b;
+        res.noalias() += A * sol;
+
+        // The gradient is computed in double precision with matrix-vector products only.
+        auto grad = ws_.grad.head(A_cols);
+        grad.noalias() = A.transpose() * res;
+        g0.head(nz).noalias() = Z.transpose() * grad;
+    }
+    else if (priority != 0 && A_rows > 0) {
+        G.topLeftCorner(nz, nz).noalias() = AZ.transpose() * AZ;
+
+        auto res = ws_.res.head(A_rows);
+        res = - b;
+        res.noalias() += A * sol;
+
+        g0.head(nz).noalias() = AZ.transpose() * res;
+    }
+    else if (priority != 0) {
+        G.topLeftCorner(nz, nz).setZero();
+    } else {
+        G.topLeftCorner(nz, nz).noalias() = A.transpose() * A;
+
+        g0.head(nz).noalias() = - A.transpose() * b;
+    }
+
+    // Add the regularization term. This is required in order to ensure that the matrix is positive definite, and is also desirable.
+    G.topLeftCorner(nz, nz).diagonal().array() += regularization_;
+
+    // Without equality constraints, the block of G of the optimization vector is regularization_ I, and its factor is known.
+    const bool identity_block = priority != 0 && A_rows == 0;
+
+
+    /* ========================= Compute CI And Ci0 ========================= */
+
+    /*
+        CI  = [   0,       I
+                - C_stack, [0; I] ]
+        ci0 = [ 0
+                d - C_stack x_opt + [w_opt_stack; 0] ]
+    */
+
+    auto CI = ws_.CI.topLeftCorner(C_rows + C_stack_rows, nz + C_rows);
+    CI.setZero();
+    CI.topRightCorner(C_rows, C_rows).setIdentity();
+    CI.bottomRightCorner(C_rows, C_rows).setIdentity();
+
+    auto ci0 = ws_.ci0.head(C_rows + C_stack_rows);
+    ci0.head(C_rows).setZero();
+    ci0.tail(C_stack_rows) = d_stack;
+
+    if (active_null_space_mode_ == NullSpaceMode::projector) {
+        // Also in mixed precision: the rounding errors of C_stack Z would violate the constraints of the higher priority tasks, and make them inconsistent.
+        auto C_stack = C_stack_.topLeftCorner(C_stack_rows, A_cols);
+
+        CI.bottomLeftCorner(C_stack_rows, nz).noalias() = - C_stack * Z;
+        ci0.tail(C_stack_rows).noalias() -= C_stack * sol;
+    } else {
+        CI.bottomLeftCorner(C_stack_rows, nz) = - C_stack_.topLeftCorner(C_stack_rows, nz);
+    }
+
+    if (priority != 0) {
+        ci0.segment(C_rows, C_stack_rows - C_rows) += w_opt_stack_.head(w_opt_stack_rows_);
+    }
+
+
+    /* ============================ Solve The QP ============================ */
+
+    auto xi_opt = ws_.xi_opt.head(nz + C_rows);
+
+    /* The QP problem is in the following form:
+     * min 0.5 * xi^T G xi + g0^T xi
+     * s.t.
+     * CI xi + ci0 >= 0
+    */
+
+    // The active set of the previous cycle is used only if the problem has the same structure (same key and same dimensions).
+    const int n_vars = nz + C_rows;
+    const int n_constraints = C_rows + C_stack_rows;
+
+    WarmStartEntry* entry = priority < static_cast<int>(warm_start_memory_.size()) ? &warm_start_memory_[priority] : nullptr;
+
+    const bool warm = warm_start_ && entry != nullptr && entry->valid
+        && entry->key == warm_start_key_
+        && entry->n_variables == n_vars
+        && entry->n_constraints == n_constraints;
+
+    // A task without inequality constraints of its own is first solved in closed form, ignoring the inequality constraints of the higher priority tasks. If this solution satisfies them, it is also the solution of the QP, and the QP backend is not called.
+    bool unconstrained = false;
+    bool factorized = false;
+
+    if (fast_path_ && C_rows == 0 && m_eq == 0) {
+        factorized = factorize_hessian(nz, identity_block);
+        unconstrained = factorized && solve_unconstrained(n_vars, n_constraints);
+
+        solver_stats_.fast_path_attempts++;
+        if (unconstrained) {
+            solver_stats_.fast_path_hits++;
+        }
+    }
+
+    if (unconstrained) {
+        level_diagnostics_.result = LevelResult::solved;
+        level_diagnostics_.status = QPStatus::success;
+        level_diagnostics_.iterations = 0;
+        level_diagnostics_.n_active = 0;
+        level_diagnostics_.slack_norm = 0;
+
+        if (warm_start_ && entry != nullptr) {
+            entry->valid = true;
+            entry->key = warm_start_key_;
+            entry->n_variables = n_vars;
+            entry->n_constraints = n_constraints;
+            entry->n_active = 0;
+        }
+    } else {
+        // Drop the inequality constraints that are provably inactive at the solution, and the duplicated ones (see set_constraint_pruning()).
+        int n_kept = n_constraints;
+        int n_ranges = 0;
+
+        if (constraint_pruning_ && C_stack_rows > 0 && (factorized || factorize_hessian(nz, identity_block))) {
+            n_kept = prune_constraints(nz, C_rows, n_constraints, m_eq, n_ranges);
+            solver_stats_.pruned_constraints += n_constraints - n_kept;
+        }
+
+        const bool pruned = n_kept < n_constraints;
+
+        // The active sets are stored with the indices of the constraints before the pruning.
+        int n_working = warm ? entry->n_active : 0;
+
+        if (warm && pruned) {
+            n_working = 0;
+
+            for (int k = 0; k < entry->n_active; k++) {
+                const int index = ws_.pruned_index(entry->active_set(k));
+                if (index >= 0) {
+                    ws_.working_set(n_working++) = index;
+                }
+            }
+        }
+
+        const auto& working_set = (warm && !pruned) ? entry->active_set : ws_.working_set;
+
+        // The Hessian is block diagonal, with the identity as the block of the slack variables: if the backend accepts it, only the nz x nz block is factorized (or the factor computed for the fast path and the pruning is reused), instead of the whole matrix.
+        const bool pass_factor = qp_solver_->accepts_factorized() && (factorized || factorize_hessian(nz, identity_block));
+
+        if (pass_factor) {
+            G.topLeftCorner(nz, nz).template triangularView<Eigen::Lower>() = ws_.L.topLeftCorner(nz, nz);
+        }
+
+        // There are no equality contraints, since the tasks equality constraints are inglobated into the cost function.
+        QPStatus result;
+
+        if (n_ranges > 0) {
+            // The opposite constraints merged by the pruning are passed as ranges, only to the backends that accept them with a factorized Hessian.
+            result = qp_solver_->solve_factorized(G, nz, g0, CI.topRows(n_kept), ci0.head(n_kept), ws_.ci_upper.head(n_kept), xi_opt, m_eq, working_set.head(n_working));
+        } else if (pass_factor) {
+            result = warm
+                ? qp_solver_->solve_factorized(G, nz, g0, CI.topRows(n_kept), ci0.head(n_kept), xi_opt, m_eq, working_set.head(n_working))
+                : qp_solver_->solve_factorized(G, nz, g0, CI.topRows(n_kept), ci0.head(n_kept), xi_opt, m_eq);
+        } else {
+            result = warm
+                ? qp_solver_->solve(G, g0, CI.topRows(n_kept), ci0.head(n_kept), xi_opt, m_eq, working_set.head(n_working))
+                : qp_solver_->solve(G, g0, CI.topRows(n_kept), ci0.head(n_kept), xi_opt, m_eq);
+        }
+
+        // With a diagnostics buffer, the failures are only reported in the records, since this may run in a real-time thread.
+        if (!diagnostics_buffer_) {
+            if (result == QPStatus::inconsistent_constraints) {
+                std::cerr << "At priority " << priority << ", constraints are inconsistent, no solution." << '\n' << std::endl;
+            } else if (result == QPStatus::not_positive_definite) {
+                std::cerr << "At priority " << priority << ", matrix G is not positive definite." << '\n' << std::endl;
+            } else if (result == QPStatus::max_iterations) {
+                std::cerr << "At priority " << priority << ", the maximum number of iterations has been reached." << '\n' << std::endl;
+            }
+        }
+
+        level_diagnostics_.result = LevelResult::solved;
+        level_diagnostics_.status = result;
+        level_diagnostics_.iterations = qp_solver_->get_iterations();
+        level_diagnostics_.n_active = qp_solver_->get_n_active();
+        level_diagnostics_.slack_norm = xi_opt.tail(C_rows).norm();
+
+        solver_stats_.solves++;
+        solver_stats_.solve_time += qp_solver_->get_solve_time();
+        solver_stats_.iterations += std::max(qp_solver_->get_iterations(), 0);
+        if (result != QPStatus::success) {
+            solver_stats_.failures++;
+        }
+        if (warm) {
+            solver_stats_.warm_starts++;
+            solver_stats_.warm_started_constraints += qp_solver_->get_n_warm_started_constraints();
+        } else {
+            solver_stats_.cold_starts++;
+        }
+
+        // Store the active set for the next cycle. After a failure, the next cycle starts cold.
+        if (warm_start_ && entry != nullptr) {
+            entry->valid = (result == QPStatus::success);
+            entry->key = warm_start_key_;
+            entry->n_variables = n_vars;
+            entry->n_constraints = n_constraints;
+            entry->n_active = qp_solver_->get_n_active();
+            entry->active_set.head(entry->n_active) = qp_solver_->get_active_set();
+
+            if (pruned) {
+                for (int k = 0; k < entry->n_active; k++) {
+                    entry->active_set(k) = ws_.kept(entry->active_set(k));
+                }
+            }
+        }
+    }
+
+    // Project the new solution in the null space of the higher priority contraints.
+    sol.noalias() += Z * xi_opt.head(nz);
+
+    if (active_null_space_mode_ == NullSpaceMode::basis) {
+        d_stack.noalias() -= C_stack_.topLeftCorner(C_stack_rows, nz) * xi_opt.head(nz);
+    }
+
+
+    /* =========================== Post Processing ========================== */
+
+    // Compute the new null_space_projector for the next time step (if necessary).
+    // If it is the last task, it is not necessary to compute the null space projector.
+    int rank = (A_rows == 0) ? 0 : -1;
+
+    if (priority == 0 || (priority < n_tasks_ && A_rows > 0)) {
+        if (active_null_space_mode_ == NullSpaceMode::projector) {
+            rank = update_null_space_projector(A_rows);
+        } else {
+            rank = update_null_space_basis(A_rows);
+        }
+
+        free_dim_ -= rank;
+    }
+
+    if (priority < static_cast<int>(task_ranks_.size())) {
+        task_ranks_[priority] = rank;
+    }
+
+    level_diagnostics_.rank = rank;
+
+    // Update the stack of the w_opt slack variables (only if it is not the last task, and if there are inequality constraints in the current task).
+    if (priority < n_tasks_ && C_rows > 0) {
+        auto w = w_opt_stack_.segment(w_opt_stack_rows_, C_rows);
+
+        if (mixed) {
+            // Refine the slack variables in double precision: they must cover the violations of the constraints at the updated solution, computed without the rounding errors of the single precision products.
+            w = - d;
+            w.noalias() += C * sol;
+            w = w.cwiseMax(xi_opt.tail(C_rows));
+        } else {
+            w = xi_opt.tail(C_rows);
+        }
+
+        w_opt_stack_rows_ += C_rows;
+    }
+}
+
+
+
+/* ========================================================================== */
+/*                              FACTORIZE_HESSIAN                             */
+/* ========================================================================== */
+
+template<int SolDimMax, int EqRowsMax, int IneqRowsMax>
+bool BasicHierarchicalQP<SolDimMax, EqRowsMax, IneqRowsMax>::factorize_hessian(int nz, bool identity_block)
+{
+    // G is factorized in a copy, since the QP backend overwrites it.
+    auto L = ws_.L.topLeftCorner(nz, nz);
+
+    if (identity_block) {
+        L.setIdentity();
+        L.diagonal().array() *= std::sqrt(regularization_);
+
+        return regularization_ > 0;
+    }
+
+    L = ws_.G.topLeftCorner(nz, nz);
+
+    Eigen::Ref<Eigen::MatrixXd> L_ref(L);
+    Eigen::LLT<Eigen::Ref<Eigen::MatrixXd>> llt(L_ref);
+
+    return llt.info() == Eigen::Success;
+}
+
+
+
+/* ========================================================================== */
+/*                              PRUNE_CONSTRAINTS                             */
+/* ========================================================================== */
+
+/*
+    The QP of a task min f(xi) = 1/2 xi^T G xi + g0^T xi, s.t. CI xi + ci0 >= 0, has the feasible point xi_0 = [0; w_0], with w_0 = max(0, C x_opt - d) the violations of the constraints of the task: the solution of the higher priority tasks does not move, and the slack variables cover the violations.
+    Hence the solution lies in the ellipsoid f(xi) <= f(xi_0), i.e.
+
+        (xi - xi_u)^T G (xi - xi_u) <= rho^2,       rho^2 = 2 (f(xi_0) - f(xi_u)) = ||w_0||^2 + g_z^T G_zz^-1 g_z
+
+    centered at the unconstrained minimum xi_u = [- G_zz^-1 g_z; 0]. In the ellipsoid, the minimum of the constraint a^T xi + c >= 0 is
+
+        a^T xi_u + c - rho ||L^-1 a||,      with G = L L^T.
+
+    If it is positive, the constraint is inactive at the solution, and removing it does not change the solution.
+
+    The remaining constraints are compared with the kept ones through a hash of the direction of their rows, a^T / |a|_inf rounded to 2^-20 with the sign of the first nonzero entry, so that each of them is compared only with the few kept ones with the same hash, instead of with all of them. Two rows are parallel if their directions are equal up to the rounding errors, and the kept one is rescaled to the smaller norm of the two. A row parallel to a kept one, with the same sign, only tightens its offset. With the opposite sign, the two constraints are merged into the range - ci0_k <= a_k^T xi <= ci_upper_k, if the QP backend accepts ranges, and they are both kept otherwise.
+*/
+
+template<int SolDimMax, int EqRowsMax, int IneqRowsMax>
+int BasicHierarchicalQP<SolDimMax, EqRowsMax, IneqRowsMax>::prune_constraints(int nz, int C_rows, int n_constraints, int m_eq, int& n_ranges)
+{
+    // The margin required to drop a constraint, relative to the magnitude of its terms (and the tolerance used by ActiveSetQP on the violated constraints).
+    constexpr double rel_tol = 1e-8;
+    constexpr double tol = 1e-10;
+
+    constexpr double inf = std::numeric_limits<double>::infinity();
+
+    const int n_vars = nz + C_rows;
+
+    // Maximum difference between the directions of two parallel rows, which are then equal up to the rounding errors: a larger one, amplified by an ill-conditioned active set, would change the solution beyond the tolerance of ActiveSetQP. Resolution of the hash of the directions.
+    constexpr double parallel_tol = 16 * std::numeric_limits<double>::epsilon();
+    constexpr double hash_resolution = 1 << 20;
+
+    auto CI = ws_.CI.topLeftCorner(n_constraints, n_vars);
+    auto ci0 = ws_.ci0.head(n_constraints);
+    const auto L = ws_.L.topLeftCorner(nz, nz).template triangularView<Eigen::Lower>();
+
+    auto z_u = ws_.z_u.head(nz);
+    z_u = - ws_.g0.head(nz);
+    L.solveInPlace(z_u);
+    double rho2 = z_u.squaredNorm();
+    L.transpose().solveInPlace(z_u);
+
+    // The constraints of the task are the last C_rows rows, with ci0 = d - C x_opt.
+    rho2 += ci0.tail(C_rows).cwiseMin(0).squaredNorm();
+
+    const double rho = std::sqrt(rho2) * (1 + rel_tol);
+
+    // kept holds the index before the pruning of each kept constraint, followed (from n_constraints on, until they are moved after the kept ones) by the one of the upper side of each range.
+    auto kept = ws_.kept.head(2 * n_constraints);
+    auto pruned_index = ws_.pruned_index.head(n_constraints);
+    auto ci_upper = ws_.ci_upper.head(n_constraints);
+    auto row_scale = ws_.row_scale.head(n_constraints);
+    auto row_sign = ws_.row_sign.head(n_constraints);
+    auto y = ws_.y.head(nz);
+
+    // Open addressing hash table of the kept rows, at most half full.
+    const int table_size = 2 * n_constraints;
+    auto table = ws_.row_table.head(table_size);
+    table.setConstant(-1);
+
+    const bool ranges = qp_solver_->accepts_ranges() && qp_solver_->accepts_factorized();
+
+    const int first = std::max(C_rows, m_eq);
+
+    int n_kept = 0;
+    n_ranges = 0;
+
+    for (int i = 0; i < n_constraints; i++) {
+        // The constraints w >= 0 and the equality constraints are always kept.
+        bool drop = false;
+        int slot = -1;
+
+        if (i >= first) {
+            y = CI.row(i).head(nz).transpose();
+            const double a_w = CI.row(i).tail(C_rows).squaredNorm();
+            const double value = ci0(i) + CI.row(i).head(nz).dot(z_u);
+
+            L.solveInPlace(y);
+            const double radius = rho * std::sqrt(y.squaredNorm() + a_w);
+
+            drop = value - radius > tol + rel_tol * (std::abs(ci0(i)) + radius);
+
+            if (drop) {
+                pruned_index(i) = -1;
+            }
+
+            row_scale(i) = CI.row(i).template lpNorm<Eigen::Infinity>();
+        }
+
+        if (!drop && i >= first && row_scale(i) > 0) {
+            // Hash of the direction of the row, with the sign that makes its first nonzero entry positive.
+            std::uint64_t hash = 1469598103934665603ULL;
+            double sign = 0;
+
+            const double entry_scale = hash_resolution / row_scale(i);
+
+            for (int j = 0; j < n_vars; j++) {
+                long long entry = std::llround(CI(i, j) * entry_scale);
+
+                if (sign == 0 && entry != 0) {
+                    sign = entry > 0 ? 1 : -1;
+                }
+                if (sign < 0) {
+                    entry = - entry;
+                }
+
+                hash = (hash ^ static_cast<std::uint64_t>(entry)) * 1099511628211ULL;
+            }
+
+            row_sign(i) = sign;
+
+            // Look for a kept row parallel to this one. The probing stops at the first empty slot, where this row is inserted if it is kept.
+            for (slot = static_cast<int>(hash % static_cast<std::uint64_t>(table_size)); table(slot) >= 0; slot = (slot + 1) % table_size) {
+                const int k = table(slot);
+                const bool opposite = row_sign(k) != sign;
+
+                if ((opposite && !ranges) || (CI.row(i) / row_scale(i) - (sign * row_sign(k)) * CI.row(k) / row_scale(k)).template lpNorm<Eigen::Infinity>() > parallel_tol) {
+                    continue;
+                }
+
+                // The kept row takes the smallest scale of the merged ones, so that the tolerance of ActiveSetQP on its violations (whose absolute part does not scale with the row) is not tighter than on any of them.
+                if (row_scale(i) < row_scale(k)) {
+                    const double ratio = row_scale(i) / row_scale(k);
+
+                    CI.row(k) *= ratio;
+                    ci0(k) *= ratio;
+                    ci_upper(k) *= ratio;
+                    row_scale(k) = row_scale(i);
+                }
+
+                // The offset of the row i, rescaled to the row k.
+                const double c = ci0(i) * row_scale(k) / row_scale(i);
+
+                if (!opposite) {
+                    // A duplicate of the constraint k: the tightest offset is kept.
+                    ci0(k) = std::min(ci0(k), c);
+                    pruned_index(i) = k;
+                } else {
+                    // The opposite of the constraint k: it is the upper side of its range.
+                    if (ci_upper(k) == inf) {
+                        kept(n_constraints + k) = i;
+                        n_ranges++;
+                    }
+                    ci_upper(k) = std::min(ci_upper(k), c);
+                    pruned_index(i) = - 2 - k;
+                }
+
+                drop = true;
+                break;
+            }
+        }
+
+        if (!drop) {
+            // The kept constraints are compacted at the top of CI and ci0 (in place, since n_kept <= i).
+            if (n_kept < i) {
+                CI.row(n_kept) = CI.row(i);
+                ci0(n_kept) = ci0(i);
+
+                if (i >= first) {
+                    row_scale(n_kept) = row_scale(i);
+                    row_sign(n_kept) = row_sign(i);
+                }
+            }
+            ci_upper(n_kept) = inf;
+
+            if (slot >= 0) {
+                table(slot) = n_kept;
+            }
+
+            kept(n_kept) = i;
+            pruned_index(i) = n_kept;
+            n_kept++;
+        }
+    }
+
+    if (n_ranges > 0) {
+        // The upper side of the range k has index n_kept + k in the pruned QP.
+        for (int k = 0; k < n_kept; k++) {
+            kept(n_kept + k) = kept(n_constraints + k);
+        }
+
+        for (int i = 0; i < n_constraints; i++) {
+            if (pruned_index(i) <= -2) {
+                pruned_index(i) = n_kept - 2 - pruned_index(i);
+            }
+        }
+    }
+
+    return n_kept;
+}
+
+
+
+/* ========================================================================== */
+/*                             SOLVE_UNCONSTRAINED                            */
+/* ========================================================================== */
+
+template<int SolDimMax, int EqRowsMax, int IneqRowsMax>
+bool BasicHierarchicalQP<SolDimMax, EqRowsMax, IneqRowsMax>::solve_unconstrained(int n_vars, int n_constraints)
+{
+    // The same tolerance used by ActiveSetQP to decide if a constraint is violated.
+    constexpr double tol = 1e-10;
+
+    auto xi_opt = ws_.xi_opt.head(n_vars);
+    const auto L = ws_.L.topLeftCorner(n_vars, n_vars).template triangularView<Eigen::Lower>();
+
+    xi_opt = - ws_.g0.head(n_vars);
+    L.solveInPlace(xi_opt);
+    L.transpose().solveInPlace(xi_opt);
+
+    if (n_constraints == 0) {
+        return true;
+    }
+
+    auto s = ws_.s.head(n_constraints);
+    s = ws_.ci0.head(n_constraints);
+    s.noalias() += ws_.CI.topLeftCorner(n_constraints, n_vars) * xi_opt;
+
+    return s.minCoeff() >= - tol;
+}
+
+
+
+/* ========================================================================== */
+/*                              FITS_TIME_BUDGET                              */
+/* ========================================================================== */
+
+template<int SolDimMax, int EqRowsMax, int IneqRowsMax>
+bool BasicHierarchicalQP<SolDimMax, EqRowsMax, IneqRowsMax>::fits_time_budget(int priority) const
+{
+    if (time_budget_ <= 0 || priority == 0) {
+        return true;
+    }
+    if (time_budget_exhausted_) {
+        return false;
+    }
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - problem_start_).count();
+    const double expected = priority < static_cast<int>(level_solve_times_.size()) ? level_solve_times_[priority] : 0;
+
+    return elapsed + expected <= time_budget_;
+}
+
+
+
+/* ========================================================================== */
+/*                               SKIP_REMAINING                               */
+/* ========================================================================== */
+
+template<int SolDimMax, int EqRowsMax, int IneqRowsMax>
+void BasicHierarchicalQP<SolDimMax, EqRowsMax, IneqRowsMax>::skip_remaining(int priority)
+{
+    // The task with priority 0 is always solved.
+    for (int p = std::max(priority, 1); p <= n_tasks_; p++) {
+        record_budget_skip(p);
+    }
+
+    // The captured problem ends here, since its remaining tasks will not be passed.
+    if (capture_open_) {
+        problem_wall_time_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - problem_start_).count();
+        finish_capture();
+    }
+}
+
+
+
+/* ========================================================================== */
+/*                             RECORD_BUDGET_SKIP                             */
+/* ========================================================================== */
+
+template<int SolDimMax, int EqRowsMax, int IneqRowsMax>
+void BasicHierarchicalQP<SolDimMax, EqRowsMax, IneqRowsMax>::record_budget_skip(int priority)
+{
+    time_budget_exhausted_ = true;
+    solver_stats_.budget_skips++;
+
+    if (diagnostics_buffer_) {
+        LevelDiagnostics record;
+        record.cycle = cycle_;
+        record.priority = priority;
+        record.result = LevelResult::time_budget;
+        record.free_dimension = free_dim_;
+        record.regularization = regularization_;
+        diagnostics_buffer_->push(record);
+    }
+}
+
+
+
+/* ========================================================================== */
+/*                                CAPTURE_LEVEL                               */
+/* ========================================================================== */
+
+template<int SolDimMax, int EqRowsMax, int IneqRowsMax>
+void BasicHierarchicalQP<SolDimMax, EqRowsMax, IneqRowsMax>::capture_level(
+    int priority,
+    const Eigen::Ref<const Eigen::MatrixXd>& A,
+    const Eigen::Ref<const Eigen::VectorXd>& b,
+    const Eigen::Ref<const Eigen::MatrixXd>& C,
+    const Eigen::Ref<const Eigen::VectorXd>& d,
+    const Eigen::Ref<const Eigen::VectorXd>& we,
+    const Eigen::Ref<const Eigen::VectorXd>& wi,
+    int m_eq
+) {
+    if (priority == 0) {
+        // The previous problem ends here if its lowest priority tasks have not been passed (e.g. they did not fit in the time budget).
+        if (capture_open_) {
+            finish_capture();
+        }
+
+        // cycle_ is incremented by the solve of this task.
+        problem_capture_->begin_problem(cycle_ + 1, regularization_);
+        capture_open_ = true;
+        problem_failed_ = false;
+    }
+
+    if (capture_open_) {
+        problem_capture_->record_level(priority, A, b, C, d, we, wi, m_eq);
+    }
+}
+
+
+
+/* ========================================================================== */
+/*                               UPDATE_CAPTURE                               */
+/* ========================================================================== */
+
+template<int SolDimMax, int EqRowsMax, int IneqRowsMax>
+void BasicHierarchicalQP<SolDimMax, EqRowsMax, IneqRowsMax>::update_capture(int priority)
+{
+    // level_diagnostics_ refers to this task only if it has been solved (and not skipped by the time budget).
+    if (solved_levels_ == priority + 1 && level_diagnostics_.status != QPStatus::success) {
+        problem_failed_ = true;
+    }
+
+    problem_wall_time_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - problem_start_).count();
+
+    if (priority >= n_tasks_) {
+        finish_capture();
+    }
+}
+
+
+
+/* ========================================================================== */
+/*                               FINISH_CAPTURE                               */
+/* ========================================================================== */
+
+template<int SolDimMax, int EqRowsMax, int IneqRowsMax>
+void BasicHierarchicalQP<SolDimMax, EqRowsMax, IneqRowsMax>::finish_capture()
+{
+    problem_capture_->end_problem(get_sol(), problem_failed_, time_budget_exhausted_, problem_wall_time_);
+    capture_open_ = false;
+}
+
+
+
+/* ========================================================================== */
+/*                             DECOMPOSE_ROW_SPACE                            */
+/* ========================================================================== */
+
+template<int SolDimMax, int EqRowsMax, int IneqRowsMax>
+int BasicHierarchicalQP<SolDimMax, EqRowsMax, IneqRowsMax>::decompose_row_space(int rows)
+{
+    const int cols = null_dim_;
+
+    const auto M = ws_.AZ.topLeftCorner(rows, cols);
+    auto W = ws_.W.topLeftCorner(cols, rows);
+    auto h_coeffs = ws_.h_coeffs.head(rows);
+    auto col_norms = ws_.col_norms.head(rows);
+
+    // M^T P = Q R. The first rank columns of Q are an orthonormal basis of the row space of M, the other ones of its null space.
+
+    W = M.transpose();
+
+    for (int j = 0; j < rows; j++) {
+        col_norms(j) = W.col(j).squaredNorm();
+    }
+
+    // Same rank threshold used by Eigen::ColPivHouseholderQR (and Eigen::CompleteOrthogonalDecomposition).
+    const int diag_size = std::min(rows, cols);
+    const double threshold = std::numeric_limits<double>::epsilon() * diag_size;
+
+    double max_pivot = 0;
+    int rank = 0;
+
+    for (int k = 0; k < diag_size; k++) {
+        // Choose as pivot the remaining column with the largest norm.
+        Eigen::Index j_max = 0;
+        const double pivot = std::sqrt(col_norms.tail(rows - k).maxCoeff(&j_max));
+        j_max += k;
+
+        if (k == 0) {
+            max_pivot = pivot;
+        }
+        if (pivot <= threshold * max_pivot || pivot == 0) {
+            break;
+        }
+
+        if (j_max != k) {
+            W.col(k).swap(W.col(j_max));
+            std::swap(col_norms(k), col_norms(j_max));
+        }
+
+        double beta = 0;
+        W.col(k).tail(cols - k).makeHouseholderInPlace(h_coeffs(k), beta);
+        W(k, k) = beta;
+
+        W.bottomRightCorner(cols - k, rows - k - 1).applyHouseholderOnTheLeft(
+            W.col(k).tail(cols - k - 1), h_coeffs(k), ws_.h_work.data());
+
+        for (int j = k + 1; j < rows; j++) {
+            col_norms(j) = W.col(j).tail(cols - k - 1).squaredNorm();
+        }
+
+        rank++;
+    }
+
+    return rank;
+}
+
+
+
+/* ========================================================================== */
+/*                         UPDATE_NULL_SPACE_PROJECTOR                        */
+/* ========================================================================== */
+
+template<int SolDimMax, int EqRowsMax, int IneqRowsMax>
+int BasicHierarchicalQP<SolDimMax, EqRowsMax, IneqRowsMax>::update_null_space_projector(int rows)
+{
+    const int cols = sol_dim_;
+
+    if (rows == 0) {
+        return 0;
+    }
+
+    const int rank = decompose_row_space(rows);
+
+    if (rank == 0) {
+        return 0;
+    }
+
+    auto W = ws_.W.topLeftCorner(cols, rows);
+    auto h_coeffs = ws_.h_coeffs.head(rows);
+
+    /* ===================== Q1 = H_0 ... H_(rank-1) [I; 0] ==================== */
+
+    auto Q1 = ws_.Q1.topLeftCorner(cols, rank);
+    Q1.setIdentity();
+
+    for (int k = rank - 1; k >= 0; k--) {
+        Q1.bottomRows(cols - k).applyHouseholderOnTheLeft(
+            W.col(k).tail(cols - k - 1), h_coeffs(k), ws_.h_work.data());
+    }
+
+    /* =================== Z_ <- Z_ (I - Q1 Q1^T) ================== */
+
+    auto Z = Z_.topLeftCorner(cols, cols);
+    auto ZQ1 = ws_.ZQ1.topLeftCorner(cols, rank);
+
+    ZQ1.noalias() = Z * Q1;
+    Z.noalias() -= ZQ1 * Q1.transpose();
+
+    return rank;
+}
+
+
+
+/* ========================================================================== */
+/*                           UPDATE_NULL_SPACE_BASIS                          */
+/* ========================================================================== */
+
+template<int SolDimMax, int EqRowsMax, int IneqRowsMax>
+int BasicHierarchicalQP<SolDimMax, EqRowsMax, IneqRowsMax>::update_null_space_basis(int rows)
+{
+    const int n = sol_dim_;
+    const int r = null_dim_;
+
+    if (rows == 0 || r == 0) {
+        return 0;
+    }
+
+    const int rank = decompose_row_space(rows);
+
+    if (rank == 0) {
+        return 0;
+    }
+
+    auto W = ws_.W.topLeftCorner(r, rows);
+    auto h_coeffs = ws_.h_coeffs.head(rows);
+
+    auto Z = Z_.topLeftCorner(n, r);
+    auto C_stack = C_stack_.topLeftCorner(C_stack_rows_, r);
+
+    /* ==================== [Z Q, C_stack Q], Q = H_0 ... H_(rank-1) ==================== */
+
+    for (int k = 0; k < rank; k++) {
+        Z.rightCols(r - k).applyHouseholderOnTheRight(
+            W.col(k).tail(r - k - 1), h_coeffs(k), ws_.h_work.data());
+
+        if (C_stack_rows_ > 0) {
+            C_stack.rightCols(r - k).applyHouseholderOnTheRight(
+                W.col(k).tail(r - k - 1), h_coeffs(k), ws_.h_work.data());
+        }
+    }
+
+    /* ========= Keep the last r - rank columns, the basis of the null space ======== */
+
+    // Column by column, since the source and destination blocks overlap.
+    for (int j = 0; j < r - rank; j++) {
+        Z_.col(j).head(n) = Z_.col(j + rank).head(n);
+        C_stack_.col(j).head(C_stack_rows_) = C_stack_.col(j + rank).head(C_stack_rows_);
+    }
+
+    null_dim_ = r - rank;
+
+    return rank;
+}
+
+
+
+/* ========================================================================== */
+/*                               SET_QP_BACKEND                               */
+/* ========================================================================== */
+
+template<int SolDimMax, int EqRowsMax, int IneqRowsMax>
+void BasicHierarchicalQP<SolDimMax, EqRowsMax, IneqRowsMax>::set_qp_backend(QPBackendType type)
+{
+    qp_solver_ = make_qp_backend(type);
+    qp_solver_->reserve(sol_dim_max_ + ineq_rows_max_, 2 * ineq_rows_max_);
+
+    // The active sets found by another backend are still valid guesses, but the iteration counters would not be comparable.
+    solver_stats_ = SolverStats();
+}
+
+
+
+/* ========================================================================== */
+/*                                 SET_N_TASKS                                */
+/* ========================================================================== */
+
+template<int SolDimMax, int EqRowsMax, int IneqRowsMax>
+void BasicHierarchicalQP<SolDimMax, EqRowsMax, IneqRowsMax>::set_n_tasks(int n_tasks)
+{
+    n_tasks_ = n_tasks;
+
+    task_ranks_.assign(n_tasks + 1, -1);
+    level_solve_times_.assign(n_tasks + 1, 0);
+
+    // The active sets refer to the tasks of the previous hierarchy.
+    warm_start_memory_.resize(n_tasks + 1);
+    for (auto& entry : warm_start_memory_) {
+        entry.valid = false;
+        entry.active_set.resize(sol_dim_max_ + ineq_rows_max_);
+    }
+}
+
+
+
+/* ========================================================================== */
+/*                                   RESERVE                                  */
+/* ========================================================================== */
+
+template<int SolDimMax, int EqRowsMax, int IneqRowsMax>
+void BasicHierarchicalQP<SolDimMax, EqRowsMax, IneqRowsMax>::reserve(int sol_dim, int eq_rows, int ineq_rows)
+{
+    if (sol_dim <= sol_dim_max_ && eq_rows <= eq_rows_max_ && ineq_rows <= ineq_rows_max_) {
+        return;
+    }
+
+    if ((SolDimMax != Eigen::Dynamic && sol_dim > SolDimMax)
+        || (EqRowsMax != Eigen::Dynamic && eq_rows > EqRowsMax)
+        || (IneqRowsMax != Eigen::Dynamic && ineq_rows > IneqRowsMax)
+    ) {
+        throw std::length_error(
+            "HierarchicalQP: the problem dimensions (" + std::to_string(sol_dim) + ", " + std::to_string(eq_rows) + ", " + std::to_string(ineq_rows)
+            + ") exceed the maximum ones (" + std::to_string(SolDimMax) + ", " + std::to_string(EqRowsMax) + ", " + std::to_string(IneqRowsMax) + ")."
+        );
+    }
+
+    sol_dim_max_ = std::max(sol_dim, sol_dim_max_);
+    eq_rows_max_ = std::max(eq_rows, eq_rows_max_);
+    ineq_rows_max_ = std::max(ineq_rows, ineq_rows_max_);
+
+    // The attributes that store the state of the hierarchical problem may be enlarged while a problem is being solved, hence they must retain their values.
+    sol_.conservativeResize(sol_dim_max_);
+    Z_.conservativeResize(sol_dim_max_, sol_dim_max_);
+    C_stack_.conservativeResize(ineq_rows_max_, sol_dim_max_);
+    d_stack_.conservativeResize(ineq_rows_max_);
+    w_opt_stack_.conservativeResize(ineq_rows_max_);
+
+    ws_.resize(sol_dim_max_, eq_rows_max_, ineq_rows_max_);
+
+    // The active set of a QP has at most as many elements as its variables.
+    for (auto& entry : warm_start_memory_) {
+        entry.valid = false;
+        entry.active_set.resize(sol_dim_max_ + ineq_rows_max_);
+    }
+
+    qp_solver_->reserve(sol_dim_max_ + ineq_rows_max_, 2 * ineq_rows_max_);
+}
+
+
+template<int SolDimMax, int EqRowsMax, int IneqRowsMax>
+void BasicHierarchicalQP<SolDimMax, EqRowsMax, IneqRowsMax>::Workspace::resize(int sol_dim, int eq_rows, int ineq_rows)
+{
+    A_w.resize(eq_rows, sol_dim);
+    b_w.resize(eq_rows);
+    C_w.resize(ineq_rows, sol_dim);
+    d_w.resize(ineq_rows);
+
+    AZ.resize(eq_rows, sol_dim);
+    res.resize(eq_rows);
+
+    G.resize(sol_dim + ineq_rows, sol_dim + ineq_rows);
+    g0.resize(sol_dim + ineq_rows);
+    CI.resize(2 * ineq_rows, sol_dim + ineq_rows);
+    ci0.resize(2 * ineq_rows);
+    xi_opt.resize(sol_dim + ineq_rows);
+
+    W.resize(sol_dim, eq_rows);
+    h_coeffs.resize(eq_rows);
+    col_norms.resize(eq_rows);
+    Q1.resize(sol_dim, eq_rows);
+    ZQ1.resize(sol_dim, eq_rows);
+    h_work.resize(std::max({sol_dim, eq_rows, ineq_rows}));
+
+    grad.resize(sol_dim);
+
+    L.resize(sol_dim, sol_dim);
+    s.resize(2 * ineq_rows);
+    z_u.resize(sol_dim);
+    y.resize(sol_dim);
+    working_set.resize(sol_dim + ineq_rows);
+    kept.resize(4 * ineq_rows);
+    pruned_index.resize(2 * ineq_rows);
+    ci_upper.resize(2 * ineq_rows);
+    row_scale.resize(2 * ineq_rows);
+    row_sign.resize(2 * ineq_rows);
+    row_table.resize(4 * ineq_rows);
+
+    A_f.resize(eq_rows, sol_dim);
+    Z_f.resize(sol_dim, sol_dim);
+    AZ_f.resize(eq_rows, sol_dim);
+    G_f.resize(sol_dim, sol_dim);
+}
+
+
+
+/* ========================================================================== */
+/*                                   RESETQP                                  */
+/* ========================================================================== */
+
+template<int SolDimMax, int EqRowsMax, int IneqRowsMax>
+void BasicHierarchicalQP<SolDimMax, EqRowsMax, IneqRowsMax>::reset_qp(int sol_dim)
+{
+    reserve(sol_dim, eq_rows_max_, ineq_rows_max_);
+
+    sol_dim_ = sol_dim;
+    active_null_space_mode_ = null_space_mode_;
+    null_dim_ = sol_dim;
+    free_dim_ = sol_dim;
+
+    std::fill(task_ranks_.begin(), task_ranks_.end(), -1);
+
+    sol_.head(sol_dim).setZero();
+    Z_.topLeftCorner(sol_dim, sol_dim).setIdentity();
+    C_stack_rows_ = 0;
+    w_opt_stack_rows_ = 0;
+}
+
+} // namespace hopt
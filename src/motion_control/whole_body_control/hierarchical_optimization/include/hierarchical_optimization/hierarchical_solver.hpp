@@ -0,0 +1,78 @@
+#pragma once
+
+#include <Eigen/Core>
+
+
+
+namespace hopt {
+
+/// @brief Counters of the solves, accumulated over all the priorities.
+struct SolverStats {
+    long solves = 0;            ///< @brief Number of QPs solved
+    double solve_time = 0;      ///< @brief Total time spent in the QP backend [s]
+    long warm_starts = 0;       ///< @brief Number of QPs warm started with the active set of the previous cycle
+    long cold_starts = 0;       ///< @brief Number of QPs solved from the unconstrained minimum
+    long iterations = 0;        ///< @brief Total number of iterations of the QP backend
+    long warm_started_constraints = 0;  ///< @brief Number of constraints added to the active set from the previous one before the first iteration (not the number of iterations saved)
+    long skipped = 0;           ///< @brief Number of QPs not solved, since the higher priority tasks already fixed the whole optimization vector
+    long budget_skips = 0;      ///< @brief Number of tasks not solved, since the time budget of their problem was exhausted
+    long fast_path_attempts = 0;    ///< @brief Number of tasks without inequality constraints of their own, first solved in closed form
+    long fast_path_hits = 0;        ///< @brief Number of them whose closed-form solution satisfied the inequality constraints of the higher priority tasks (not counted in solves)
+    long pruned_constraints = 0;    ///< @brief Number of inequality constraints not passed to the QP backend, since they were inactive, duplicated, or merged into a range
+    long failures = 0;          ///< @brief Number of QPs whose backend did not return success
+};
+
+
+
+/* ========================================================================== */
+/*                          HIERARCHICALSOLVER CLASS                          */
+/* ========================================================================== */
+
+/// @class @brief Interface of the solvers of the hierarchical problem.
+/// @details The task of priority p is
+///     we * (A x - b)  = v
+///     wi * (C x - d) <= w
+/// where v and w are slack variables, whose norms are minimized without increasing the ones of the higher priority tasks.
+/// The tasks are passed one at a time with solve_qp(), from priority 0 to the lowest priority. The solution is available after the task with the lowest priority has been passed.
+class HierarchicalSolver {
+public:
+    virtual ~HierarchicalSolver() = default;
+
+    /// @brief Preallocate the memory used to solve the hierarchical problem.
+    /// @param[in] sol_dim maximum dimension of the optimization vector
+    /// @param[in] eq_rows maximum number of equality constraints of a single task
+    /// @param[in] ineq_rows maximum number of inequality constraints of all the tasks together
+    virtual void reserve(int sol_dim, int eq_rows, int ineq_rows) = 0;
+
+    /// @brief Change the priority of the last task of the hierarchy. The settings and the preallocated dimensions are kept, while the warm start data is discarded.
+    /// @param[in] n_tasks the priority of the last task (the number of tasks is n_tasks + 1)
+    virtual void set_n_tasks(int n_tasks) = 0;
+
+    /// @brief Pass and solve a single prioritized task of the hierarchical problem.
+    virtual void solve_qp(
+        int priority,
+        const Eigen::Ref<const Eigen::MatrixXd>& A,
+        const Eigen::Ref<const Eigen::VectorXd>& b,
+        const Eigen::Ref<const Eigen::MatrixXd>& C,
+        const Eigen::Ref<const Eigen::VectorXd>& d,
+        const Eigen::Ref<const Eigen::VectorXd>& we,
+        const Eigen::Ref<const Eigen::VectorXd>& wi
+    ) = 0;
+
+    /// @brief Get the solution of the hierarchical problem.
+    [[nodiscard]] virtual Eigen::Ref<const Eigen::VectorXd> get_sol() const = 0;
+
+    void set_regularization(double reg) {this->regularization_ = reg;}
+
+    [[nodiscard]] const SolverStats& get_solver_stats() const {return solver_stats_;}
+
+    void reset_solver_stats() {solver_stats_ = SolverStats();}
+
+protected:
+    /// @brief Regularization factor introduced in order to ensure that each problem has a unique solution. */
+    double regularization_ = 1e-6;
+
+    SolverStats solver_stats_;
+};
+
+} // namespace hopt
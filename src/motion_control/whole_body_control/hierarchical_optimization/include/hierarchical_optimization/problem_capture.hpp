@@ -0,0 +1,184 @@
+#pragma once
+
+#include "hierarchical_optimization/hierarchical_problem.hpp"
+
+#include <Eigen/Core>
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+
+namespace hopt {
+
+/* ========================================================================== */
+/*                             CAPTURETRIGGER ENUM                            */
+/* ========================================================================== */
+
+/// @brief Why a hierarchical problem has been captured.
+/// @details failure: the QP of one of its priorities did not succeed.
+/// overrun: it took longer than the overrun threshold, or its time budget was exhausted.
+/// request: ProblemCapture::request() was called while it was being solved.
+enum class CaptureTrigger {failure, overrun, request};
+
+
+
+/* ========================================================================== */
+/*                           CAPTUREDPROBLEM STRUCT                           */
+/* ========================================================================== */
+
+/// @brief A hierarchical problem read from a capture file.
+struct CapturedProblem {
+    long cycle = 0;                 ///< @brief Number of the problem in the HierarchicalQP that solved it
+    CaptureTrigger trigger = CaptureTrigger::request;
+    double regularization = 0;      ///< @brief Regularization of the HierarchicalQP that solved it
+    double wall_time = 0;           ///< @brief Time spent to solve it [s]
+    Eigen::VectorXd sol;            ///< @brief Solution found when it was captured
+    HierarchicalProblem tasks;      ///< @brief Tasks passed to solve_qp(), from priority 0
+};
+
+/// @brief Read a problem written by ProblemCapture.
+/// @throws std::runtime_error if the file cannot be read or is not a capture file.
+CapturedProblem read_captured_problem(const std::string& path);
+
+/// @brief Write a problem in the format of ProblemCapture.
+/// @throws std::runtime_error if the file cannot be written.
+void write_captured_problem(const std::string& path, const CapturedProblem& problem);
+
+
+
+/* ========================================================================== */
+/*                            PROBLEMCAPTURE CLASS                            */
+/* ========================================================================== */
+
+/// @class @brief Recorder of the hierarchical problems solved by a HierarchicalQP, which writes the interesting ones to binary files for the offline replay.
+/// @details The HierarchicalQP copies the tasks of every problem in a preallocated slot. When the problem ends with a failure, an overrun, or after a request, the slot is handed to a writer thread, which writes it to <directory>/hqp_capture_<cycle>_<trigger>.bin, and returns it.
+/// The real-time thread never blocks and never allocates: if no slot is free, or if the problem does not fit in a slot, the problem is dropped and counted.
+/// The files are read with read_captured_problem(), e.g. by the hqp_replay tool.
+class ProblemCapture {
+public:
+    /// @brief Construct the recorder and start its writer thread.
+    /// @param[in] directory directory in which the files are written (it must exist)
+    /// @param[in] max_values maximum number of matrix and vector elements of a problem
+    /// @param[in] n_slots number of problems that can wait to be written, plus the one being recorded
+    ProblemCapture(std::string directory, std::size_t max_values = 1 << 17, int n_slots = 4);
+
+    /// @brief Write the problems still waiting, and stop the writer thread.
+    ~ProblemCapture();
+
+    ProblemCapture(const ProblemCapture&) = delete;
+    ProblemCapture& operator=(const ProblemCapture&) = delete;
+
+    /// @brief Capture the problems that take longer than this time [s]. A non-positive threshold (the default) only captures the problems whose time budget was exhausted.
+    void set_overrun_threshold(double threshold) {this->overrun_threshold_ = threshold;}
+
+    /// @brief Capture the problems in which a QP failed (enabled by default).
+    void set_capture_failures(bool capture_failures) {this->capture_failures_ = capture_failures;}
+
+    /// @brief Capture the next complete problem. It can be called by any thread.
+    void request() {request_.store(true, std::memory_order_relaxed);}
+
+    /// @brief Get the number of files written so far.
+    [[nodiscard]] long get_written() const {return written_.load(std::memory_order_relaxed);}
+
+    /// @brief Get the number of problems that should have been captured, but were dropped.
+    [[nodiscard]] long get_dropped() const {return dropped_.load(std::memory_order_relaxed);}
+
+    /* ======================== Real-time interface ========================= */
+
+    /// @brief Start recording a new problem. Called by the HierarchicalQP.
+    void begin_problem(long cycle, double regularization);
+
+    /// @brief Record a task of the current problem. Called by the HierarchicalQP. we and wi are empty for unit weights.
+    void record_level(
+        int priority,
+        const Eigen::Ref<const Eigen::MatrixXd>& A,
+        const Eigen::Ref<const Eigen::VectorXd>& b,
+        const Eigen::Ref<const Eigen::MatrixXd>& C,
+        const Eigen::Ref<const Eigen::VectorXd>& d,
+        const Eigen::Ref<const Eigen::VectorXd>& we,
+        const Eigen::Ref<const Eigen::VectorXd>& wi,
+        int m_eq
+    );
+
+    /// @brief End the current problem, and hand it to the writer thread if it must be captured. Called by the HierarchicalQP.
+    /// @param[in] sol solution of the problem
+    /// @param[in] failed true if the QP of one of its priorities did not succeed
+    /// @param[in] budget_exhausted true if its time budget was exhausted
+    /// @param[in] wall_time time spent to solve it [s]
+    void end_problem(const Eigen::Ref<const Eigen::VectorXd>& sol, bool failed, bool budget_exhausted, double wall_time);
+
+private:
+    /// @brief Dimensions of a recorded task. Its elements are stored in the values of the slot, in the order of the file.
+    struct LevelHeader {
+        int priority = 0;
+        int m_eq = 0;
+        int A_rows = 0;
+        int C_rows = 0;
+        int cols = 0;
+        int weighted = 0;
+        std::size_t offset = 0;
+        std::size_t size = 0;
+    };
+
+    /// @brief A recorded problem.
+    struct Slot {
+        long cycle = 0;
+        CaptureTrigger trigger = CaptureTrigger::request;
+        double regularization = 0;
+        double wall_time = 0;
+        bool overflow = false;          ///< @brief True if the problem did not fit in the slot
+        std::vector<LevelHeader> levels;
+        std::vector<double> values;
+        std::vector<double> sol;
+    };
+
+    /// @brief Lock-free queue of slot indices, with a single producer and a single consumer.
+    class SlotQueue {
+    public:
+        explicit SlotQueue(int capacity) : indices_(capacity) {}
+
+        bool push(int index);
+        bool pop(int& index);
+
+    private:
+        std::vector<int> indices_;
+        alignas(64) std::atomic<std::size_t> head_ {0};
+        alignas(64) std::atomic<std::size_t> tail_ {0};
+    };
+
+    /// @brief Append the elements of a matrix to the values of the current slot (column major).
+    void append_values(const double* data, std::size_t size);
+
+    /// @brief Write all the slots handed to the writer thread, and return them.
+    void write_pending();
+
+    /// @brief Write a slot to its file.
+    void write_slot(const Slot& slot) const;
+
+    std::string directory_;
+
+    double overrun_threshold_ = 0;
+    bool capture_failures_ = true;
+
+    std::vector<Slot> slots_;
+
+    /// @brief Slot in which the real-time thread is recording. */
+    int current_ = 0;
+    bool recording_ = false;
+
+    SlotQueue full_;    ///< @brief Slots to be written, from the real-time thread to the writer thread
+    SlotQueue free_;    ///< @brief Written slots, from the writer thread to the real-time thread
+
+    std::atomic<bool> request_ {false};
+    std::atomic<long> written_ {0};
+    std::atomic<long> dropped_ {0};
+
+    std::thread writer_thread_;
+    std::atomic<bool> running_ {true};
+};
+
+} // namespace hopt
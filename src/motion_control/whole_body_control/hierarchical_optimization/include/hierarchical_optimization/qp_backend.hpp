@@ -0,0 +1,224 @@
+#pragma once
+
+#include <Eigen/Core>
+
+#include <memory>
+
+
+
+namespace hopt {
+
+/* ========================================================================== */
+/*                               QPSTATUS ENUM                                */
+/* ========================================================================== */
+
+/// @brief Exit status of a QP solve.
+enum class QPStatus {success, inconsistent_constraints, not_positive_definite, max_iterations};
+
+
+
+/* ========================================================================== */
+/*                             QPBACKENDTYPE ENUM                             */
+/* ========================================================================== */
+
+/// @brief Solvers that can be used to solve the QP of each priority of the hierarchical QP.
+/// @details active_set: in-tree Goldfarb-Idnani dual active-set solver (ActiveSetQP), allocation free.
+/// quadprog: the quadprog library. It copies the problem and allocates its memory at every solve.
+/// eiquadprog: EiquadprogFast of the eiquadprog library. It allocates its memory only when the problem dimensions change.
+enum class QPBackendType {active_set, quadprog, eiquadprog};
+
+
+
+/* ========================================================================== */
+/*                              QPBACKEND CLASS                               */
+/* ========================================================================== */
+
+/// @class @brief Interface of the solvers of the QPs of the hierarchical QP.
+/// @details Solves the problem
+///     min_x 1/2 x^T G x + g0^T x
+///     s.t.  CI x + ci0 >= 0
+/// where the first m_eq rows of CI are equality constraints.
+/// All the backends report the status, the number of iterations, and the time of the last solve.
+class QPBackend {
+public:
+    virtual ~QPBackend() = default;
+
+    /// @brief Preallocate the working memory for problems with up to n_max variables and m_max constraints.
+    virtual void reserve(int n_max, int m_max) = 0;
+
+    /// @brief Solve the QP problem.
+    /// @param[in,out] G Hessian matrix. It may be overwritten by the backend.
+    /// @param[in]     g0
+    /// @param[in]     CI
+    /// @param[in]     ci0
+    /// @param[out]    x optimal solution
+    /// @param[in]     m_eq number of equality constraints (the first m_eq rows of CI)
+    QPStatus solve(
+        Eigen::Ref<Eigen::MatrixXd> G,
+        const Eigen::Ref<const Eigen::VectorXd>& g0,
+        const Eigen::Ref<const Eigen::MatrixXd>& CI,
+        const Eigen::Ref<const Eigen::VectorXd>& ci0,
+        Eigen::Ref<Eigen::VectorXd> x,
+        int m_eq = 0
+    ) {
+        return solve(G, g0, CI, ci0, x, m_eq, Eigen::VectorXi());
+    }
+
+    /// @brief Solve the QP problem, warm starting from a guess of the active set. Backends that do not support the warm start ignore working_set.
+    /// @param[in,out] G Hessian matrix. It may be overwritten by the backend.
+    /// @param[in]     g0
+    /// @param[in]     CI
+    /// @param[in]     ci0
+    /// @param[out]    x optimal solution
+    /// @param[in]     m_eq number of equality constraints (the first m_eq rows of CI)
+    /// @param[in]     working_set indices of the inequality constraints that are guessed to be active at the solution
+    QPStatus solve(
+        Eigen::Ref<Eigen::MatrixXd> G,
+        const Eigen::Ref<const Eigen::VectorXd>& g0,
+        const Eigen::Ref<const Eigen::MatrixXd>& CI,
+        const Eigen::Ref<const Eigen::VectorXd>& ci0,
+        Eigen::Ref<Eigen::VectorXd> x,
+        int m_eq,
+        const Eigen::Ref<const Eigen::VectorXi>& working_set
+    );
+
+    /// @brief Solve the QP problem, with a Hessian given by the Cholesky factor of its leading block.
+    /// @details The Hessian is G = [L L^T, 0; 0, I], with L lower triangular and n_factorized x n_factorized. Its trailing block is the identity, as the one of the slack variables of the hierarchical QP.
+    /// @param[in,out] L the lower triangular part of the leading n_factorized x n_factorized block holds the Cholesky factor. The other entries are ignored. It is n x n, and it may be overwritten by the backend.
+    /// @param[in]     n_factorized dimension of the factorized block
+    /// @param[in]     g0
+    /// @param[in]     CI
+    /// @param[in]     ci0
+    /// @param[out]    x optimal solution
+    /// @param[in]     m_eq number of equality constraints (the first m_eq rows of CI)
+    QPStatus solve_factorized(
+        Eigen::Ref<Eigen::MatrixXd> L,
+        int n_factorized,
+        const Eigen::Ref<const Eigen::VectorXd>& g0,
+        const Eigen::Ref<const Eigen::MatrixXd>& CI,
+        const Eigen::Ref<const Eigen::VectorXd>& ci0,
+        Eigen::Ref<Eigen::VectorXd> x,
+        int m_eq = 0
+    ) {
+        return solve_factorized(L, n_factorized, g0, CI, ci0, x, m_eq, Eigen::VectorXi());
+    }
+
+    /// @brief Solve the QP problem, with a Hessian given by the Cholesky factor of its leading block, warm starting from a guess of the active set.
+    /// @param[in,out] L the lower triangular part of the leading n_factorized x n_factorized block holds the Cholesky factor. The other entries are ignored. It is n x n, and it may be overwritten by the backend.
+    /// @param[in]     n_factorized dimension of the factorized block
+    /// @param[in]     g0
+    /// @param[in]     CI
+    /// @param[in]     ci0
+    /// @param[out]    x optimal solution
+    /// @param[in]     m_eq number of equality constraints (the first m_eq rows of CI)
+    /// @param[in]     working_set indices of the inequality constraints that are guessed to be active at the solution
+    QPStatus solve_factorized(
+        Eigen::Ref<Eigen::MatrixXd> L,
+        int n_factorized,
+        const Eigen::Ref<const Eigen::VectorXd>& g0,
+        const Eigen::Ref<const Eigen::MatrixXd>& CI,
+        const Eigen::Ref<const Eigen::VectorXd>& ci0,
+        Eigen::Ref<Eigen::VectorXd> x,
+        int m_eq,
+        const Eigen::Ref<const Eigen::VectorXi>& working_set
+    );
+
+    /// @brief Solve the QP problem, with a Hessian given by the Cholesky factor of its leading block, where some of the inequality constraints are ranges.
+    /// @details The rows i >= m_eq of CI with a finite ci_upper(i) are the ranges - ci0_i <= CI_i x <= ci_upper_i, i.e. they also hold the constraint - CI_i x + ci_upper_i >= 0. The index of this upper side in the working set and in the active set is m + i, with m the number of rows of CI.
+    /// Only the backends for which accepts_ranges() is true implement it.
+    /// @param[in,out] L the lower triangular part of the leading n_factorized x n_factorized block holds the Cholesky factor. The other entries are ignored. It is n x n, and it may be overwritten by the backend.
+    /// @param[in]     n_factorized dimension of the factorized block
+    /// @param[in]     g0
+    /// @param[in]     CI
+    /// @param[in]     ci0
+    /// @param[in]     ci_upper upper offsets of the rows of CI, infinite for the one-sided constraints
+    /// @param[out]    x optimal solution
+    /// @param[in]     m_eq number of equality constraints (the first m_eq rows of CI)
+    /// @param[in]     working_set indices of the inequality constraints that are guessed to be active at the solution
+    QPStatus solve_factorized(
+        Eigen::Ref<Eigen::MatrixXd> L,
+        int n_factorized,
+        const Eigen::Ref<const Eigen::VectorXd>& g0,
+        const Eigen::Ref<const Eigen::MatrixXd>& CI,
+        const Eigen::Ref<const Eigen::VectorXd>& ci0,
+        const Eigen::Ref<const Eigen::VectorXd>& ci_upper,
+        Eigen::Ref<Eigen::VectorXd> x,
+        int m_eq,
+        const Eigen::Ref<const Eigen::VectorXi>& working_set
+    );
+
+    /// @brief Whether the backend uses the factor passed to solve_factorized() directly. The other backends rebuild the Hessian from it.
+    [[nodiscard]] virtual bool accepts_factorized() const {return false;}
+
+    /// @brief Whether the backend implements solve_factorized() with range constraints.
+    [[nodiscard]] virtual bool accepts_ranges() const {return false;}
+
+    /// @brief Get the exit status of the last solve.
+    [[nodiscard]] QPStatus get_status() const {return status_;}
+
+    /// @brief Get the wall time of the last solve [s].
+    [[nodiscard]] double get_solve_time() const {return solve_time_;}
+
+    /// @brief Get the number of iterations of the last solve.
+    [[nodiscard]] virtual int get_iterations() const = 0;
+
+    /// @brief Get the indices of the active constraints at the solution of the last solve.
+    [[nodiscard]] virtual Eigen::Ref<const Eigen::VectorXi> get_active_set() const = 0;
+
+    /// @brief Get the number of active constraints at the solution of the last solve.
+    [[nodiscard]] int get_n_active() const {return static_cast<int>(get_active_set().size());}
+
+    /// @brief Get the number of constraints of the working set of the last solve that were added to the active set before the first iteration.
+    [[nodiscard]] virtual int get_n_warm_started_constraints() const {return 0;}
+
+protected:
+    /// @brief Solve the QP problem. Called by solve(), which measures the solve time.
+    virtual QPStatus solve_impl(
+        Eigen::Ref<Eigen::MatrixXd> G,
+        const Eigen::Ref<const Eigen::VectorXd>& g0,
+        const Eigen::Ref<const Eigen::MatrixXd>& CI,
+        const Eigen::Ref<const Eigen::VectorXd>& ci0,
+        Eigen::Ref<Eigen::VectorXd> x,
+        int m_eq,
+        const Eigen::Ref<const Eigen::VectorXi>& working_set
+    ) = 0;
+
+    /// @brief Solve the QP problem with a factorized Hessian. Called by solve_factorized(), which measures the solve time.
+    /// @details The default implementation rebuilds the Hessian in place in L, and calls solve_impl().
+    virtual QPStatus solve_factorized_impl(
+        Eigen::Ref<Eigen::MatrixXd> L,
+        int n_factorized,
+        const Eigen::Ref<const Eigen::VectorXd>& g0,
+        const Eigen::Ref<const Eigen::MatrixXd>& CI,
+        const Eigen::Ref<const Eigen::VectorXd>& ci0,
+        Eigen::Ref<Eigen::VectorXd> x,
+        int m_eq,
+        const Eigen::Ref<const Eigen::VectorXi>& working_set
+    );
+
+    /// @brief Solve the QP problem with a factorized Hessian and range constraints. Called by solve_factorized(), which measures the solve time.
+    /// @details The default implementation throws std::logic_error, since the backends that do not accept ranges do not implement it.
+    virtual QPStatus solve_factorized_impl(
+        Eigen::Ref<Eigen::MatrixXd> L,
+        int n_factorized,
+        const Eigen::Ref<const Eigen::VectorXd>& g0,
+        const Eigen::Ref<const Eigen::MatrixXd>& CI,
+        const Eigen::Ref<const Eigen::VectorXd>& ci0,
+        const Eigen::Ref<const Eigen::VectorXd>& ci_upper,
+        Eigen::Ref<Eigen::VectorXd> x,
+        int m_eq,
+        const Eigen::Ref<const Eigen::VectorXi>& working_set
+    );
+
+private:
+    QPStatus status_ = QPStatus::success;
+
+    double solve_time_ = 0;
+};
+
+
+
+/// @brief Create a QP backend of the given type.
+std::unique_ptr<QPBackend> make_qp_backend(QPBackendType type);
+
+} // namespace hopt
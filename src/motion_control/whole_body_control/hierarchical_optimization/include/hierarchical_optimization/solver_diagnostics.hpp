@@ -0,0 +1,105 @@
+#pragma once
+
+#include "hierarchical_optimization/qp_backend.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+
+
+namespace hopt {
+
+/* ========================================================================== */
+/*                              LEVELRESULT ENUM                              */
+/* ========================================================================== */
+
+/// @brief How a priority of the hierarchical problem has been handled.
+/// @details solved: its QP has been solved.
+/// fully_constrained: its QP has not been solved, since the higher priority tasks already fixed the whole optimization vector.
+/// time_budget: it has not been solved, since the time budget of the problem was exhausted.
+enum class LevelResult {solved, fully_constrained, time_budget};
+
+
+
+/* ========================================================================== */
+/*                           LEVELDIAGNOSTICS STRUCT                          */
+/* ========================================================================== */
+
+/// @brief Diagnostics of the solve of a single priority of a hierarchical problem.
+struct LevelDiagnostics {
+    long cycle = 0;                     ///< @brief Number of the problem, incremented by each solve with priority 0
+    int priority = 0;
+    LevelResult result = LevelResult::solved;
+    QPStatus status = QPStatus::success;
+    int iterations = 0;                 ///< @brief Iterations of the QP backend
+    int n_active = 0;                   ///< @brief Number of active constraints at the solution of the QP
+    double slack_norm = 0;              ///< @brief Norm of the slack variables of the inequality constraints of the task
+    int rank = -1;                      ///< @brief Rank of A Z (-1 if it has not been computed)
+    int free_dimension = 0;             ///< @brief Dimension of the null space left for the lower priority tasks
+    double regularization = 0;
+    double wall_time = 0;               ///< @brief Time spent in solve_qp [s]
+};
+
+
+
+/* ========================================================================== */
+/*                           DIAGNOSTICSBUFFER CLASS                          */
+/* ========================================================================== */
+
+/// @class @brief Fixed size, lock-free ring buffer of LevelDiagnostics, with a single producer and a single consumer.
+/// @details The producer (the real-time thread that solves the hierarchical problems) never blocks and never allocates: when the buffer is full, the new records are dropped and counted.
+/// The consumer (e.g. a thread that publishes the records) drains it with pop().
+class DiagnosticsBuffer {
+public:
+    /// @brief Maximum number of records stored. It is a power of two, so that the indices wrap around with a mask.
+    static constexpr std::size_t capacity = 1024;
+
+    /// @brief Append a record. Only the producer thread may call it.
+    /// @return false if the buffer is full and the record has been dropped.
+    bool push(const LevelDiagnostics& record)
+    {
+        const std::size_t head = head_.load(std::memory_order_relaxed);
+
+        if (head - tail_.load(std::memory_order_acquire) == capacity) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        records_[head & (capacity - 1)] = record;
+        head_.store(head + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    /// @brief Remove the oldest record. Only the consumer thread may call it.
+    /// @return false if the buffer is empty.
+    bool pop(LevelDiagnostics& record)
+    {
+        const std::size_t tail = tail_.load(std::memory_order_relaxed);
+
+        if (tail == head_.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        record = records_[tail & (capacity - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    /// @brief Get the number of records dropped since the buffer was full.
+    [[nodiscard]] long get_dropped() const {return dropped_.load(std::memory_order_relaxed);}
+
+private:
+    static_assert((capacity & (capacity - 1)) == 0, "The capacity of DiagnosticsBuffer must be a power of two.");
+
+    std::array<LevelDiagnostics, capacity> records_;
+
+    // On different cache lines, since they are written by different threads.
+    alignas(64) std::atomic<std::size_t> head_ {0};     ///< @brief Index of the next record written by the producer
+    alignas(64) std::atomic<std::size_t> tail_ {0};     ///< @brief Index of the next record read by the consumer
+    alignas(64) std::atomic<long> dropped_ {0};
+};
+
+} // namespace hopt
@@ -0,0 +1,634 @@
+#include "hierarchical_optimization/active_set_qp.hpp"
+
+#include <Eigen/Cholesky>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+
+namespace hopt {
+
+using namespace Eigen;
+
+namespace {
+
+/// @brief Row of CI of the constraint with index i, where the indices from m on are the upper sides of the ranges.
+inline int constraint_row(int i, int m) {return i < m ? i : i - m;}
+
+/// @brief Sign of the row of CI in the constraint with index i: -1 for the upper side of a range.
+inline double constraint_sign(int i, int m) {return i < m ? 1 : -1;}
+
+} // namespace
+
+
+
+/* ========================================================================== */
+/*                                   RESERVE                                  */
+/* ========================================================================== */
+
+void ActiveSetQP::reserve(int n_max, int m_max)
+{
+    if (n_max <= n_max_ && m_max <= m_max_) {
+        return;
+    }
+
+    n_max_ = std::max(n_max, n_max_);
+    m_max_ = std::max(m_max, m_max_);
+
+    J_.resize(n_max_, n_max_);
+    R_.resize(n_max_, n_max_);
+
+    d_.resize(n_max_);
+    z_.resize(n_max_);
+    r_.resize(n_max_ + 1);
+    u_.resize(n_max_ + 1);
+    s_.resize(m_max_);
+
+    active_set_.resize(n_max_ + 1);
+    is_active_.resize(2 * m_max_);
+    is_excluded_.resize(2 * m_max_);
+    ci_scale_.resize(m_max_);
+
+    x_old_.resize(n_max_);
+    u_old_.resize(n_max_ + 1);
+    active_set_old_.resize(n_max_ + 1);
+}
+
+
+
+/* ========================================================================== */
+/*                                 SOLVE_IMPL                                 */
+/* ========================================================================== */
+
+/*
+    Goldfarb-Idnani dual method, as implemented in quadprog and eiquadprog.
+
+    Starting from the unconstrained minimum, the most violated constraint is added to the active set at every iteration. The step is taken in the primal and dual spaces along (z, r). If the step is blocked by the multiplier of an active constraint becoming negative (partial step), that constraint is dropped and the step is recomputed.
+
+    The matrices J = L^-T Q and R (with G = L L^T and N_active = Q [R; 0]) are updated with Givens rotations when constraints are added or removed.
+
+    If the constraint p turns out to be linearly dependent on the active ones after a full step, the active set, the multipliers, and x are restored to the beginning of the step, and p is excluded until another constraint is added (as in eiquadprog). The QP is infeasible if only excluded constraints are left violated.
+
+    A constraint is violated if CI_i x + ci0_i < - tol (1 + |ci0_i| + |CI_i|_1 max(1, |x|_inf)), so that the tolerance follows the scale of the problem.
+
+    The upper side - CI_i x + ci_upper_i >= 0 of a range has index m + i. Both sides are checked with the same product CI_i x, and the upper side enters the active set with the row - CI_i.
+*/
+
+QPStatus ActiveSetQP::solve_impl(
+    Ref<MatrixXd> G,
+    const Ref<const VectorXd>& g0,
+    const Ref<const MatrixXd>& CI,
+    const Ref<const VectorXd>& ci0,
+    Ref<VectorXd> x,
+    int m_eq,
+    const Ref<const VectorXi>& working_set
+) {
+    // G = L L^T (in place, in the lower triangular part of G).
+    LLT<Ref<MatrixXd>> llt(G);
+    if (llt.info() != Success) {
+        iterations_ = 0;
+        n_active_ = 0;
+        n_warm_started_constraints_ = 0;
+
+        return QPStatus::not_positive_definite;
+    }
+
+    return solve_factorized_impl(G, static_cast<int>(G.rows()), g0, CI, ci0, x, m_eq, working_set);
+}
+
+
+
+/* ========================================================================== */
+/*                            SOLVE_FACTORIZED_IMPL                           */
+/* ========================================================================== */
+
+QPStatus ActiveSetQP::solve_factorized_impl(
+    Ref<MatrixXd> L,
+    int n_factorized,
+    const Ref<const VectorXd>& g0,
+    const Ref<const MatrixXd>& CI,
+    const Ref<const VectorXd>& ci0,
+    Ref<VectorXd> x,
+    int m_eq,
+    const Ref<const VectorXi>& working_set
+) {
+    // Without ranges, ci_upper is empty.
+    return solve_factorized_impl(L, n_factorized, g0, CI, ci0, VectorXd(), x, m_eq, working_set);
+}
+
+QPStatus ActiveSetQP::solve_factorized_impl(
+    Ref<MatrixXd> L,
+    int n_factorized,
+    const Ref<const VectorXd>& g0,
+    const Ref<const MatrixXd>& CI,
+    const Ref<const VectorXd>& ci0,
+    const Ref<const VectorXd>& ci_upper,
+    Ref<VectorXd> x,
+    int m_eq,
+    const Ref<const VectorXi>& working_set
+) {
+    const int n = static_cast<int>(L.rows());
+    const int m = static_cast<int>(CI.rows());
+
+    // The constraints are the rows of CI, followed by the upper sides of the ranges.
+    const bool ranges = ci_upper.size() > 0;
+    const int m_sides = ranges ? 2 * m : m;
+
+    constexpr double inf = std::numeric_limits<double>::infinity();
+    constexpr double tol = 1e-10;   // Relative to the size of the terms of each constraint
+
+    reserve(n, m);
+
+    iterations_ = 0;
+    n_active_ = 0;
+    n_warm_started_constraints_ = 0;
+    R_norm_ = 1;
+
+    auto J = J_.topLeftCorner(n, n);
+    auto R = R_.topLeftCorner(n, n);
+    auto d = d_.head(n);
+    auto z = z_.head(n);
+    auto s = s_.head(m);
+    auto ci_scale = ci_scale_.head(m);
+
+
+    /* ============================== Compute J ============================= */
+
+    // J = L^-T, with L = [L_f, 0; 0, I]: only the factorized block is inverted.
+    J.setIdentity();
+    L.topLeftCorner(n_factorized, n_factorized).triangularView<Lower>().transpose().solveInPlace(J.topLeftCorner(n_factorized, n_factorized));
+
+
+    /* ====================== Unconstrained Minimum ========================= */
+
+    // x = - G^-1 g0 = - J J^T g0
+    d.noalias() = J.transpose() * g0;
+    x.noalias() = - J * d;
+
+    is_active_.head(m_sides).setZero();
+    is_excluded_.head(m_sides).setZero();
+
+    ci_scale = CI.rowwise().lpNorm<1>();
+
+    int iq = 0;
+
+
+    /* ====================== Add Equality Constraints ====================== */
+
+    for (int i = 0; i < m_eq; i++) {
+        d.noalias() = J.transpose() * CI.row(i).transpose();
+        z.noalias() = J.rightCols(n - iq) * d.tail(n - iq);
+
+        if (iq > 0) {
+            r_.head(iq) = d.head(iq);
+            R.topLeftCorner(iq, iq).triangularView<Upper>().solveInPlace(r_.head(iq));
+        }
+
+        // Full step along z, so that the equality is satisfied.
+        double t2 = 0;
+        if (z.squaredNorm() > std::numeric_limits<double>::epsilon()) {
+            t2 = - (CI.row(i).dot(x) + ci0(i)) / z.dot(CI.row(i));
+        }
+
+        x += t2 * z;
+        u_(iq) = t2;
+        u_.head(iq) -= t2 * r_.head(iq);
+        active_set_(iq) = i;
+
+        if (!add_constraint(n, iq)) {
+            n_active_ = iq;
+            return QPStatus::inconsistent_constraints;
+        }
+
+        is_active_(i) = 1;
+    }
+
+
+    /* ============================= Warm Start ============================= */
+
+    if (working_set.size() > 0) {
+        add_working_set(n, iq, m_eq, g0, CI, ci0, ci_upper, x, working_set);
+    }
+
+
+    /* ===================== Add Inequality Constraints ===================== */
+
+    while (true) {
+        // Step 1: choose the most violated constraint.
+
+        s.noalias() = CI * x;
+
+        const double x_scale = std::max(1.0, x.lpNorm<Infinity>());
+
+        int p = -1;
+        bool excluded_violated = false;
+        double s_min = 0;
+
+        // The constraint i has value s_i and offset c_i.
+        const auto check_constraint = [&](int i, double s_i, double c_i) {
+            if (is_active_(i) == 1 || s_i >= - tol * (1 + std::abs(c_i) + ci_scale(constraint_row(i, m)) * x_scale)) {
+                return;
+            }
+
+            if (is_excluded_(i) == 1) {
+                excluded_violated = true;
+            } else if (s_i < s_min) {
+                s_min = s_i;
+                p = i;
+            }
+        };
+
+        for (int i = m_eq; i < m; i++) {
+            check_constraint(i, s(i) + ci0(i), ci0(i));
+
+            if (ranges && ci_upper(i) < inf) {
+                check_constraint(m + i, ci_upper(i) - s(i), ci_upper(i));
+            }
+        }
+
+        if (p == -1) {
+            // All the constraints are satisfied, unless the violated ones are linearly dependent on the active ones.
+            n_active_ = iq;
+            return excluded_violated ? QPStatus::inconsistent_constraints : QPStatus::success;
+        }
+
+        // State at the beginning of the step, restored if p cannot be added to the active set.
+        x_old_.head(n) = x;
+        u_old_.head(iq) = u_.head(iq);
+        active_set_old_.head(iq) = active_set_.head(iq);
+        const int iq_old = iq;
+
+        u_(iq) = 0;
+        active_set_(iq) = p;
+
+        const int p_row = constraint_row(p, m);
+        const double p_sign = constraint_sign(p, m);
+        const double p_offset = p < m ? ci0(p) : ci_upper(p_row);
+
+        double s_p = s_min;
+
+        // Step 2: compute the step in the primal and dual spaces, until the constraint p is added to the active set.
+        while (true) {
+            if (iterations_++ >= max_iterations_) {
+                n_active_ = iq;
+                return QPStatus::max_iterations;
+            }
+
+            // Step 2a: step directions.
+            d.noalias() = p_sign * J.transpose() * CI.row(p_row).transpose();
+            z.noalias() = J.rightCols(n - iq) * d.tail(n - iq);
+
+            if (iq > 0) {
+                r_.head(iq) = d.head(iq);
+                R.topLeftCorner(iq, iq).triangularView<Upper>().solveInPlace(r_.head(iq));
+            }
+
+            // Step 2b: step length.
+
+            // Partial step length t1: maximum step in the dual space without violating dual feasibility.
+            double t1 = inf;
+            int l = -1;
+            for (int k = m_eq; k < iq; k++) {
+                if (r_(k) > 0 && u_(k) / r_(k) < t1) {
+                    t1 = u_(k) / r_(k);
+                    l = active_set_(k);
+                }
+            }
+
+            // Full step length t2: minimum step in the primal space such that the constraint p becomes feasible.
+            double t2 = inf;
+            if (z.squaredNorm() > std::numeric_limits<double>::epsilon()) {
+                t2 = - s_p / (p_sign * z.dot(CI.row(p_row)));
+            }
+
+            const double t = std::min(t1, t2);
+
+            // Step 2c: take the step.
+
+            if (t >= inf) {
+                // The QP is infeasible.
+                n_active_ = iq;
+                return QPStatus::inconsistent_constraints;
+            }
+
+            if (t2 >= inf) {
+                // Step in the dual space only.
+                u_.head(iq) -= t * r_.head(iq);
+                u_(iq) += t;
+                is_active_(l) = 0;
+                delete_constraint(n, iq, l);
+                continue;
+            }
+
+            // Step in the primal and dual spaces.
+            x += t * z;
+            u_.head(iq) -= t * r_.head(iq);
+            u_(iq) += t;
+
+            if (t == t2) {
+                // Full step: add the constraint p to the active set.
+                if (!add_constraint(n, iq)) {
+                    // Linearly dependent on the active constraints: exclude it and restore the beginning of the step.
+                    iq--;
+                    is_excluded_(p) = 1;
+                    if (!restore_active_set(n, iq, iq_old, CI)) {
+                        n_active_ = iq;
+                        return QPStatus::inconsistent_constraints;
+                    }
+                    x = x_old_.head(n);
+                    break;
+                }
+                is_active_(p) = 1;
+                is_excluded_.head(m_sides).setZero();
+                break;
+            }
+
+            // Partial step: drop the blocking constraint l and recompute the step.
+            is_active_(l) = 0;
+            delete_constraint(n, iq, l);
+
+            s_p = p_sign * CI.row(p_row).dot(x) + p_offset;
+        }
+    }
+}
+
+
+
+/* ========================================================================== */
+/*                               ADD_CONSTRAINT                               */
+/* ========================================================================== */
+
+bool ActiveSetQP::add_constraint(int n, int& iq)
+{
+    auto J = J_.topLeftCorner(n, n);
+
+    // Zero the elements of d from the last one to the (iq+1)-th one with Givens rotations, applying the same rotations to the columns of J.
+    for (int j = n - 1; j >= iq + 1; j--) {
+        double cc = d_(j - 1);
+        double ss = d_(j);
+        const double h = std::hypot(cc, ss);
+
+        if (h == 0) {
+            continue;
+        }
+
+        d_(j) = 0;
+        ss = ss / h;
+        cc = cc / h;
+
+        if (cc < 0) {
+            cc = - cc;
+            ss = - ss;
+            d_(j - 1) = - h;
+        } else {
+            d_(j - 1) = h;
+        }
+
+        const double xny = ss / (1 + cc);
+
+        for (int k = 0; k < n; k++) {
+            const double t1 = J(k, j - 1);
+            const double t2 = J(k, j);
+            J(k, j - 1) = t1 * cc + t2 * ss;
+            J(k, j) = xny * (t1 + J(k, j - 1)) - t2;
+        }
+    }
+
+    // The new column of R is the first iq+1 elements of d.
+    iq++;
+    R_.col(iq - 1).head(iq) = d_.head(iq);
+
+    if (std::abs(d_(iq - 1)) <= std::numeric_limits<double>::epsilon() * R_norm_) {
+        // The constraint is linearly dependent on the active ones.
+        return false;
+    }
+
+    R_norm_ = std::max(R_norm_, std::abs(d_(iq - 1)));
+
+    return true;
+}
+
+
+
+/* ========================================================================== */
+/*                             RESTORE_ACTIVE_SET                             */
+/* ========================================================================== */
+
+/*
+    The constraints dropped by the partial steps since the beginning of the step are still in the active set only in active_set_old_. The ones that were kept are in the same order at the beginning of active_set_, hence the dropped ones are added back after them, and the multipliers are taken from u_old_ in the same order.
+*/
+
+bool ActiveSetQP::restore_active_set(int n, int& iq, int iq_old, const Ref<const MatrixXd>& CI)
+{
+    const int m = static_cast<int>(CI.rows());
+
+    auto J = J_.topLeftCorner(n, n);
+    auto d = d_.head(n);
+
+    int k_kept = 0;
+
+    for (int k = 0; k < iq_old; k++) {
+        const int i = active_set_old_(k);
+
+        if (is_active_(i) == 1) {
+            u_(k_kept++) = u_old_(k);
+            continue;
+        }
+
+        d.noalias() = constraint_sign(i, m) * J.transpose() * CI.row(constraint_row(i, m)).transpose();
+
+        if (!add_constraint(n, iq)) {
+            iq--;
+            return false;
+        }
+
+        active_set_(iq - 1) = i;
+        u_(iq - 1) = u_old_(k);
+        is_active_(i) = 1;
+    }
+
+    return true;
+}
+
+
+
+/* ========================================================================== */
+/*                               ADD_WORKING_SET                              */
+/* ========================================================================== */
+
+/*
+    With the active constraints N^T x + c = 0 and x = J y, since J^T G J = I and N^T J = [R^T, 0], the minimum of the problem with the active constraints treated as equalities is
+
+        y1 = - R^-T c
+        y2 = - J2^T g0
+        x  = J1 y1 + J2 y2
+
+    and the multipliers of the active constraints are
+
+        u = R^-1 J1^T (G x + g0) = R^-1 (y1 + J1^T g0).
+*/
+
+void ActiveSetQP::add_working_set(
+    int n, int& iq, int m_eq,
+    const Ref<const VectorXd>& g0,
+    const Ref<const MatrixXd>& CI,
+    const Ref<const VectorXd>& ci0,
+    const Ref<const VectorXd>& ci_upper,
+    Ref<VectorXd> x,
+    const Ref<const VectorXi>& working_set
+) {
+    const int m = static_cast<int>(CI.rows());
+    const int m_sides = ci_upper.size() > 0 ? 2 * m : m;
+
+    auto J = J_.topLeftCorner(n, n);
+    auto d = d_.head(n);
+
+    // Offset of the constraint with index i.
+    const auto offset = [&](int i) {return i < m ? ci0(i) : ci_upper(i - m);};
+
+    const int iq_eq = iq;
+
+    for (int k = 0; k < static_cast<int>(working_set.size()) && iq < n; k++) {
+        const int i = working_set(k);
+
+        // The upper sides exist only for the inequality constraints that are ranges.
+        if (i < m_eq || i >= m_sides || (i >= m && (i - m < m_eq || std::isinf(ci_upper(i - m)))) || is_active_(i) == 1) {
+            continue;
+        }
+
+        d.noalias() = constraint_sign(i, m) * J.transpose() * CI.row(constraint_row(i, m)).transpose();
+
+        if (!add_constraint(n, iq)) {
+            // Linearly dependent on the active constraints. The rotations applied to J only mixed its columns not yet in the active set, hence it is enough to discard the new column of R.
+            iq--;
+            continue;
+        }
+
+        active_set_(iq - 1) = i;
+        is_active_(i) = 1;
+    }
+
+    if (iq == iq_eq) {
+        return;
+    }
+
+    while (true) {
+        auto y1 = r_.head(iq);
+        auto R = R_.topLeftCorner(iq, iq);
+
+        for (int k = 0; k < iq; k++) {
+            y1(k) = - offset(active_set_(k));
+        }
+        R.triangularView<Upper>().transpose().solveInPlace(y1);
+
+        d.noalias() = J.transpose() * g0;
+
+        x.noalias() = J.leftCols(iq) * y1;
+        x.noalias() -= J.rightCols(n - iq) * d.tail(n - iq);
+
+        u_.head(iq) = y1 + d.head(iq);
+        R.triangularView<Upper>().solveInPlace(u_.head(iq));
+
+        // Remove the inequality constraint with the most negative multiplier, if any.
+        int l = -1;
+        double u_min = 0;
+        for (int k = m_eq; k < iq; k++) {
+            if (u_(k) < u_min) {
+                u_min = u_(k);
+                l = active_set_(k);
+            }
+        }
+
+        if (l == -1) {
+            break;
+        }
+
+        is_active_(l) = 0;
+        delete_constraint(n, iq, l);
+    }
+
+    n_warm_started_constraints_ = iq - iq_eq;
+}
+
+
+
+/* ========================================================================== */
+/*                              DELETE_CONSTRAINT                             */
+/* ========================================================================== */
+
+void ActiveSetQP::delete_constraint(int n, int& iq, int l)
+{
+    auto J = J_.topLeftCorner(n, n);
+
+    // Find the position of the constraint l in the active set.
+    int qq = 0;
+    for (int i = 0; i < iq; i++) {
+        if (active_set_(i) == l) {
+            qq = i;
+            break;
+        }
+    }
+
+    // Remove it, shifting the following constraints (and the constraint being added, stored at iq).
+    for (int i = qq; i < iq - 1; i++) {
+        active_set_(i) = active_set_(i + 1);
+        u_(i) = u_(i + 1);
+        R_.col(i).head(n) = R_.col(i + 1).head(n);
+    }
+
+    active_set_(iq - 1) = active_set_(iq);
+    u_(iq - 1) = u_(iq);
+    active_set_(iq) = 0;
+    u_(iq) = 0;
+
+    R_.col(iq - 1).head(iq).setZero();
+
+    iq--;
+
+    if (iq == 0) {
+        return;
+    }
+
+    // Restore the upper triangular form of R with Givens rotations, applying the same rotations to the columns of J.
+    for (int j = qq; j < iq; j++) {
+        double cc = R_(j, j);
+        double ss = R_(j + 1, j);
+        const double h = std::hypot(cc, ss);
+
+        if (h == 0) {
+            continue;
+        }
+
+        cc = cc / h;
+        ss = ss / h;
+        R_(j + 1, j) = 0;
+
+        if (cc < 0) {
+            R_(j, j) = - h;
+            cc = - cc;
+            ss = - ss;
+        } else {
+            R_(j, j) = h;
+        }
+
+        const double xny = ss / (1 + cc);
+
+        for (int k = j + 1; k < iq; k++) {
+            const double t1 = R_(j, k);
+            const double t2 = R_(j + 1, k);
+            R_(j, k) = t1 * cc + t2 * ss;
+            R_(j + 1, k) = xny * (t1 + R_(j, k)) - t2;
+        }
+
+        for (int k = 0; k < n; k++) {
+            const double t1 = J(k, j);
+            const double t2 = J(k, j + 1);
+            J(k, j) = t1 * cc + t2 * ss;
+            J(k, j + 1) = xny * (J(k, j) + t1) - t2;
+        }
+    }
+}
+
+} // namespace hopt
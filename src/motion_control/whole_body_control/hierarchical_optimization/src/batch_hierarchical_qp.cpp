@@ -0,0 +1,193 @@
+#include "hierarchical_optimization/batch_hierarchical_qp.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+
+
+namespace hopt {
+
+using namespace Eigen;
+
+namespace {
+
+void accumulate_stats(SolverStats& total, const SolverStats& stats)
+{
+    total.solves += stats.solves;
+    total.solve_time += stats.solve_time;
+    total.warm_starts += stats.warm_starts;
+    total.cold_starts += stats.cold_starts;
+    total.iterations += stats.iterations;
+    total.warm_started_constraints += stats.warm_started_constraints;
+    total.skipped += stats.skipped;
+    total.budget_skips += stats.budget_skips;
+    total.fast_path_attempts += stats.fast_path_attempts;
+    total.fast_path_hits += stats.fast_path_hits;
+    total.pruned_constraints += stats.pruned_constraints;
+    total.failures += stats.failures;
+}
+
+} // namespace
+
+
+
+/* ========================================================================== */
+/*                         BATCHHIERARCHICALQP CLASS                          */
+/* ========================================================================== */
+
+BatchHierarchicalQP::BatchHierarchicalQP(int n_threads)
+: n_threads_(n_threads > 0 ? n_threads : std::max(static_cast<int>(std::thread::hardware_concurrency()), 1)),
+  workers_(n_threads_) {}
+
+
+
+/* ========================================================================== */
+/*                                    SOLVE                                   */
+/* ========================================================================== */
+
+void BatchHierarchicalQP::solve(const std::vector<HierarchicalProblem>& problems, std::vector<VectorXd>& solutions)
+{
+    const int n_problems = static_cast<int>(problems.size());
+
+    // Dimensions of the largest problem, used to size the HierarchicalQPs once per batch.
+    int n_tasks = 0;
+    int sol_dim = 0;
+    int eq_rows = 0;
+    int ineq_rows = 0;
+
+    for (const auto& problem : problems) {
+        n_tasks = std::max(n_tasks, static_cast<int>(problem.size()) - 1);
+
+        int problem_ineq_rows = 0;
+        for (const auto& task : problem) {
+            sol_dim = std::max(sol_dim, static_cast<int>(task.A.cols()));
+            eq_rows = std::max(eq_rows, static_cast<int>(task.A.rows()));
+            problem_ineq_rows += static_cast<int>(task.C.rows());
+        }
+        ineq_rows = std::max(ineq_rows, problem_ineq_rows);
+    }
+
+    // The HierarchicalQPs are rebuilt only when the depth of the problems or the backend change, so that their buffers are reused among the batches.
+    if (n_tasks != workers_n_tasks_ || qp_backend_type_ != workers_qp_backend_type_) {
+        for (auto& worker : workers_) {
+            if (worker) {
+                accumulate_stats(retired_stats_, worker->get_solver_stats());
+            }
+            worker = std::make_unique<HierarchicalQP>(n_tasks);
+            worker->set_qp_backend(qp_backend_type_);
+        }
+
+        workers_n_tasks_ = n_tasks;
+        workers_qp_backend_type_ = qp_backend_type_;
+    }
+
+    for (auto& worker : workers_) {
+        worker->set_regularization(regularization_);
+        worker->set_null_space_mode(null_space_mode_);
+        worker->reserve(sol_dim, eq_rows, ineq_rows);
+    }
+
+    // The outputs are allocated here, so that the threads only write in them.
+    solutions.resize(n_problems);
+    for (int i = 0; i < n_problems; i++) {
+        solutions[i].resize(problems[i].empty() ? 0 : problems[i].front().A.cols());
+    }
+    statuses_.assign(n_problems, QPStatus::success);
+
+    std::atomic<int> next_problem {0};
+    std::exception_ptr exception = nullptr;
+    std::mutex exception_mutex;
+
+    auto work = [&](HierarchicalQP& hqp) {
+        for (int i = next_problem++; i < n_problems; i = next_problem++) {
+            try {
+                statuses_[i] = solve_problem(hqp, problems[i], solutions[i]);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(exception_mutex);
+                if (!exception) {
+                    exception = std::current_exception();
+                }
+                next_problem = n_problems;
+            }
+        }
+    };
+
+    const int n_threads = std::min(n_threads_, n_problems);
+
+    std::vector<std::thread> threads;
+    threads.reserve(std::max(n_threads - 1, 0));
+    for (int t = 1; t < n_threads; t++) {
+        threads.emplace_back(work, std::ref(*workers_[t]));
+    }
+
+    // The calling thread solves its share of the problems too.
+    if (n_threads > 0) {
+        work(*workers_[0]);
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+}
+
+
+
+/* ========================================================================== */
+/*                                SOLVE_PROBLEM                               */
+/* ========================================================================== */
+
+QPStatus BatchHierarchicalQP::solve_problem(HierarchicalQP& hqp, const HierarchicalProblem& problem, VectorXd& solution) const
+{
+    QPStatus status = QPStatus::success;
+
+    for (int priority = 0; priority < static_cast<int>(problem.size()); priority++) {
+        const auto& task = problem[priority];
+        const long solves = hqp.get_solver_stats().solves;
+
+        if (task.we.size() == 0 && task.wi.size() == 0) {
+            hqp.solve_qp(priority, task.A, task.b, task.C, task.d, task.m_eq);
+        } else {
+            hqp.solve_qp(priority, task.A, task.b, task.C, task.d, task.we, task.wi, task.m_eq);
+        }
+
+        // The status of the backend is the one of this task only if its QP has been solved (and not skipped).
+        if (status == QPStatus::success && hqp.get_solver_stats().solves > solves) {
+            status = hqp.get_qp_backend().get_status();
+        }
+    }
+
+    if (!problem.empty()) {
+        solution = hqp.get_sol();
+    }
+
+    return status;
+}
+
+
+
+/* ========================================================================== */
+/*                              GET_SOLVER_STATS                              */
+/* ========================================================================== */
+
+SolverStats BatchHierarchicalQP::get_solver_stats() const
+{
+    SolverStats stats = retired_stats_;
+
+    for (const auto& worker : workers_) {
+        if (worker) {
+            accumulate_stats(stats, worker->get_solver_stats());
+        }
+    }
+
+    return stats;
+}
+
+} // namespace hopt
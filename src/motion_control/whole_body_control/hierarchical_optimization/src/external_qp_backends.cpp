@@ -0,0 +1,143 @@
+#include "hierarchical_optimization/external_qp_backends.hpp"
+
+#include "quadprog/quadprog.hpp"
+
+#include <algorithm>
+
+
+
+namespace hopt {
+
+using namespace Eigen;
+
+
+
+/* ========================================================================== */
+/*                              QUADPROGBACKEND                               */
+/* ========================================================================== */
+
+void QuadprogBackend::reserve(int n_max, int /*m_max*/)
+{
+    if (x_.size() < n_max) {
+        x_.resize(n_max);
+    }
+}
+
+
+QPStatus QuadprogBackend::solve_impl(
+    Ref<MatrixXd> G,
+    const Ref<const VectorXd>& g0,
+    const Ref<const MatrixXd>& CI,
+    const Ref<const VectorXd>& ci0,
+    Ref<VectorXd> x,
+    int m_eq,
+    const Ref<const VectorXi>& /*working_set*/
+) {
+    /* The quadprog problem is in the following form:
+     * min 0.5 * x G x - a^T x
+     * s.t.
+     * C^T x - b >= 0
+    */
+
+    x_.resize(G.rows());
+
+    const int result = solve_quadprog(
+        MatrixXd(G),
+        - g0,
+        CI.transpose(),
+        - ci0,
+        x_,
+        m_eq
+    );
+
+    x = x_;
+
+    if (result == 1) {
+        return QPStatus::inconsistent_constraints;
+    }
+    if (result == 2) {
+        return QPStatus::not_positive_definite;
+    }
+
+    return QPStatus::success;
+}
+
+
+
+/* ========================================================================== */
+/*                             EIQUADPROGBACKEND                              */
+/* ========================================================================== */
+
+void EiquadprogBackend::reserve(int /*n_max*/, int m_max)
+{
+    // The other buffers are sized at every solve, since EiquadprogFast requires them to have exactly the problem dimensions.
+    if (active_set_.size() < m_max) {
+        active_set_.resize(m_max);
+    }
+}
+
+
+QPStatus EiquadprogBackend::solve_impl(
+    Ref<MatrixXd> G,
+    const Ref<const VectorXd>& g0,
+    const Ref<const MatrixXd>& CI,
+    const Ref<const VectorXd>& ci0,
+    Ref<VectorXd> x,
+    int m_eq,
+    const Ref<const VectorXi>& /*working_set*/
+) {
+    using namespace eiquadprog::solvers;
+
+    const int n = static_cast<int>(G.rows());
+    const int m_in = static_cast<int>(CI.rows()) - m_eq;
+
+    // Reallocate the memory of the solver only if the dimensions of the problem changed.
+    if (n != n_ || m_eq != m_eq_ || m_in != m_in_) {
+        qp_.reset(n, m_eq, m_in);
+
+        n_ = n;
+        m_eq_ = m_eq;
+        m_in_ = m_in;
+    }
+
+    reserve(n, m_eq + m_in);
+
+    G_ = G;
+    g0_ = g0;
+    CE_ = CI.topRows(m_eq);
+    ce0_ = ci0.head(m_eq);
+    CI_ = CI.bottomRows(m_in);
+    ci0_ = ci0.tail(m_in);
+    x_.resize(n);
+
+    const EiquadprogFast_status status = qp_.solve_quadprog(
+        G_, g0_,
+        CE_, ce0_,
+        CI_, ci0_,
+        x_
+    );
+
+    x = x_;
+
+    iterations_ = qp_.getIteratios();
+    n_active_ = qp_.getActiveSetSize();
+
+    // EiquadprogFast stores the equality constraints as -i-1, and the inequality constraints with their index in CI_.
+    for (int i = 0; i < n_active_; i++) {
+        const int a = qp_.getActiveSet()(i);
+        active_set_(i) = a < 0 ? - a - 1 : a + m_eq;
+    }
+
+    switch (status) {
+    case EIQUADPROG_FAST_OPTIMAL:
+        return QPStatus::success;
+    case EIQUADPROG_FAST_MAX_ITER_REACHED:
+        return QPStatus::max_iterations;
+    case EIQUADPROG_FAST_UNBOUNDED:
+        return QPStatus::not_positive_definite;
+    default:
+        return QPStatus::inconsistent_constraints;
+    }
+}
+
+} // namespace hopt
@@ -0,0 +1,247 @@
+#include "hierarchical_optimization/hierarchical_qp.hpp"
+#include "hierarchical_optimization/problem_capture.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+
+
+/*
+    Replay the hierarchical problems written by hopt::ProblemCapture with a chosen QP backend and set of options, and print, for each file, the time taken to solve it and the difference between the solution found and the captured one.
+
+    Usage: hqp_replay [options] <capture files>
+*/
+
+namespace {
+
+struct ReplayOptions {
+    hopt::QPBackendType backend = hopt::QPBackendType::active_set;
+    hopt::NullSpaceMode null_space_mode = hopt::NullSpaceMode::projector;
+    double regularization = -1;     // Negative: the one of the captured problem.
+    int repeat = 100;
+    bool warm_start = false;
+    bool fast_path = true;
+    bool constraint_pruning = false;
+    int mixed_precision = -1;
+};
+
+void print_usage()
+{
+    std::cout
+        << "Usage: hqp_replay [options] <capture files>\n"
+        << "\n"
+        << "Options:\n"
+        << "    --backend <active_set|quadprog|eiquadprog>          QP backend (default: active_set)\n"
+        << "    --null-space <projector|basis>                      null space mode (default: projector)\n"
+        << "    --regularization <value>                            regularization (default: the captured one)\n"
+        << "    --repeat <n>                                        solves of each problem (default: 100)\n"
+        << "    --warm-start                                        warm start each solve with the previous one\n"
+        << "    --no-fast-path                                      always call the QP backend\n"
+        << "    --constraint-pruning                                prune the inactive inequality constraints\n"
+        << "    --mixed-precision <priority>                        first priority solved in mixed precision\n"
+        << std::endl;
+}
+
+const char* status_name(hopt::QPStatus status)
+{
+    switch (status)
+    {
+    case hopt::QPStatus::success:
+        return "success";
+    case hopt::QPStatus::inconsistent_constraints:
+        return "inconsistent";
+    case hopt::QPStatus::not_positive_definite:
+        return "not_pd";
+    case hopt::QPStatus::max_iterations:
+        break;
+    }
+
+    return "max_iter";
+}
+
+const char* trigger_name(hopt::CaptureTrigger trigger)
+{
+    switch (trigger)
+    {
+    case hopt::CaptureTrigger::failure:
+        return "failure";
+    case hopt::CaptureTrigger::overrun:
+        return "overrun";
+    case hopt::CaptureTrigger::request:
+        break;
+    }
+
+    return "request";
+}
+
+/// @brief Solve all the tasks of a problem, and return the status of the first QP that did not succeed.
+hopt::QPStatus solve_problem(hopt::HierarchicalQP& hqp, const hopt::HierarchicalProblem& problem)
+{
+    hopt::QPStatus status = hopt::QPStatus::success;
+
+    for (int priority = 0; priority < static_cast<int>(problem.size()); priority++) {
+        const auto& task = problem[priority];
+        const long solves = hqp.get_solver_stats().solves;
+
+        if (task.we.size() == 0 && task.wi.size() == 0) {
+            hqp.solve_qp(priority, task.A, task.b, task.C, task.d, task.m_eq);
+        } else {
+            hqp.solve_qp(priority, task.A, task.b, task.C, task.d, task.we, task.wi, task.m_eq);
+        }
+
+        if (status == hopt::QPStatus::success && hqp.get_solver_stats().solves > solves) {
+            status = hqp.get_qp_backend().get_status();
+        }
+    }
+
+    return status;
+}
+
+/// @brief Replay a capture file and print a line with its results.
+void replay(const std::string& path, const ReplayOptions& options)
+{
+    const hopt::CapturedProblem captured = hopt::read_captured_problem(path);
+
+    if (captured.tasks.empty()) {
+        std::cout << path << ": empty problem" << std::endl;
+        return;
+    }
+
+    int sol_dim = 0;
+    int eq_rows = 0;
+    int ineq_rows = 0;
+    for (const auto& task : captured.tasks) {
+        sol_dim = std::max(sol_dim, static_cast<int>(std::max(task.A.cols(), task.C.cols())));
+        eq_rows = std::max(eq_rows, static_cast<int>(task.A.rows()));
+        ineq_rows += static_cast<int>(task.C.rows());
+    }
+
+    hopt::HierarchicalQP hqp(static_cast<int>(captured.tasks.size()) - 1);
+    hqp.set_qp_backend(options.backend);
+    hqp.set_null_space_mode(options.null_space_mode);
+    hqp.set_regularization(options.regularization >= 0 ? options.regularization : captured.regularization);
+    hqp.set_warm_start(options.warm_start);
+    hqp.set_fast_path(options.fast_path);
+    hqp.set_constraint_pruning(options.constraint_pruning);
+    hqp.set_mixed_precision(options.mixed_precision);
+    hqp.reserve(sol_dim, eq_rows, ineq_rows);
+
+    // The first solve allocates the buffers of the backend, and is not timed.
+    hopt::QPStatus status = solve_problem(hqp, captured.tasks);
+
+    std::vector<double> times(options.repeat);
+
+    for (auto& time : times) {
+        const auto start = std::chrono::steady_clock::now();
+        status = solve_problem(hqp, captured.tasks);
+        time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::sort(times.begin(), times.end());
+
+    double mean = 0;
+    for (const double time : times) {
+        mean += time / static_cast<double>(times.size());
+    }
+
+    const Eigen::VectorXd sol = hqp.get_sol();
+
+    double delta = std::numeric_limits<double>::quiet_NaN();
+    double relative_delta = std::numeric_limits<double>::quiet_NaN();
+    if (captured.sol.size() == sol.size()) {
+        delta = (sol - captured.sol).lpNorm<Eigen::Infinity>();
+        relative_delta = (sol - captured.sol).norm() / std::max(captured.sol.norm(), 1e-12);
+    }
+
+    std::printf(
+        "%s: cycle %ld (%s), %zu tasks, %d variables, captured %.1f us | mean %.1f us, median %.1f us, max %.1f us | %s | |dx|_inf %.3e, |dx|/|x| %.3e\n",
+        path.c_str(), captured.cycle, trigger_name(captured.trigger), captured.tasks.size(), sol_dim, captured.wall_time * 1e6,
+        mean * 1e6, times.empty() ? 0. : times[times.size() / 2] * 1e6, times.empty() ? 0. : times.back() * 1e6,
+        status_name(status), delta, relative_delta
+    );
+}
+
+} // namespace
+
+
+
+int main(int argc, char* argv[])
+{
+    ReplayOptions options;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+
+        if (arg == "-h" || arg == "--help") {
+            print_usage();
+            return 0;
+        } else if (arg == "--backend" && has_value) {
+            const std::string value = argv[++i];
+            if (value == "active_set") {
+                options.backend = hopt::QPBackendType::active_set;
+            } else if (value == "quadprog") {
+                options.backend = hopt::QPBackendType::quadprog;
+            } else if (value == "eiquadprog") {
+                options.backend = hopt::QPBackendType::eiquadprog;
+            } else {
+                std::cerr << "'--backend' must be in [active_set, quadprog, eiquadprog]" << '\n' << std::endl;
+                return 1;
+            }
+        } else if (arg == "--null-space" && has_value) {
+            const std::string value = argv[++i];
+            if (value == "projector") {
+                options.null_space_mode = hopt::NullSpaceMode::projector;
+            } else if (value == "basis") {
+                options.null_space_mode = hopt::NullSpaceMode::basis;
+            } else {
+                std::cerr << "'--null-space' must be either 'projector' or 'basis'" << '\n' << std::endl;
+                return 1;
+            }
+        } else if (arg == "--regularization" && has_value) {
+            options.regularization = std::atof(argv[++i]);
+        } else if (arg == "--repeat" && has_value) {
+            options.repeat = std::max(std::atoi(argv[++i]), 1);
+        } else if (arg == "--warm-start") {
+            options.warm_start = true;
+        } else if (arg == "--no-fast-path") {
+            options.fast_path = false;
+        } else if (arg == "--constraint-pruning") {
+            options.constraint_pruning = true;
+        } else if (arg == "--mixed-precision" && has_value) {
+            options.mixed_precision = std::atoi(argv[++i]);
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Unknown option " << arg << '\n' << std::endl;
+            print_usage();
+            return 1;
+        } else {
+            files.push_back(arg);
+        }
+    }
+
+    if (files.empty()) {
+        print_usage();
+        return 1;
+    }
+
+    int failures = 0;
+
+    for (const auto& file : files) {
+        try {
+            replay(file, options);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << '\n' << std::endl;
+            failures++;
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,469 @@
+#include "hierarchical_optimization/problem_capture.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+
+
+namespace hopt {
+
+using namespace Eigen;
+
+namespace {
+
+/*
+    Format of the capture files (native endianness):
+
+        char[8]  magic "HQPCAP1"
+        int64    cycle
+        int32    trigger
+        int32    number of tasks
+        double   regularization
+        double   wall time
+        int32    dimension of the solution, followed by the solution
+
+    and, for each task:
+
+        int32    priority, m_eq, rows of A, rows of C, columns, weighted
+        double   A (column major), b, C (column major), d, and we and wi if weighted
+*/
+
+constexpr char magic[8] = "HQPCAP1";
+
+const char* trigger_name(CaptureTrigger trigger)
+{
+    switch (trigger)
+    {
+    case CaptureTrigger::failure:
+        return "failure";
+    case CaptureTrigger::overrun:
+        return "overrun";
+    case CaptureTrigger::request:
+        break;
+    }
+
+    return "request";
+}
+
+template<typename T>
+void write_value(std::ofstream& file, T value)
+{
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+T read_value(std::ifstream& file)
+{
+    T value {};
+    file.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return value;
+}
+
+void write_header(std::ofstream& file, long cycle, CaptureTrigger trigger, int n_tasks, double regularization, double wall_time)
+{
+    file.write(magic, sizeof(magic));
+    write_value<std::int64_t>(file, cycle);
+    write_value<std::int32_t>(file, static_cast<std::int32_t>(trigger));
+    write_value<std::int32_t>(file, n_tasks);
+    write_value<double>(file, regularization);
+    write_value<double>(file, wall_time);
+}
+
+void write_doubles(std::ofstream& file, const double* data, std::size_t size)
+{
+    file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size * sizeof(double)));
+}
+
+void read_doubles(std::ifstream& file, double* data, std::size_t size)
+{
+    file.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(size * sizeof(double)));
+}
+
+} // namespace
+
+
+
+/* ========================================================================== */
+/*                            READ_CAPTURED_PROBLEM                           */
+/* ========================================================================== */
+
+CapturedProblem read_captured_problem(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Cannot open the capture file " + path + ".");
+    }
+
+    char file_magic[8] = {};
+    file.read(file_magic, sizeof(file_magic));
+    if (!file || std::memcmp(file_magic, magic, sizeof(magic)) != 0) {
+        throw std::runtime_error(path + " is not a hierarchical QP capture file.");
+    }
+
+    CapturedProblem problem;
+    problem.cycle = static_cast<long>(read_value<std::int64_t>(file));
+    problem.trigger = static_cast<CaptureTrigger>(read_value<std::int32_t>(file));
+    const int n_tasks = read_value<std::int32_t>(file);
+    problem.regularization = read_value<double>(file);
+    problem.wall_time = read_value<double>(file);
+
+    const int sol_dim = read_value<std::int32_t>(file);
+    if (!file || n_tasks < 0 || sol_dim < 0) {
+        throw std::runtime_error("The capture file " + path + " is corrupted.");
+    }
+    problem.sol.resize(sol_dim);
+    read_doubles(file, problem.sol.data(), sol_dim);
+
+    problem.tasks.resize(n_tasks);
+
+    for (auto& task : problem.tasks) {
+        read_value<std::int32_t>(file);     // The priority is the position of the task.
+        task.m_eq = read_value<std::int32_t>(file);
+        const int A_rows = read_value<std::int32_t>(file);
+        const int C_rows = read_value<std::int32_t>(file);
+        const int cols = read_value<std::int32_t>(file);
+        const bool weighted = read_value<std::int32_t>(file) != 0;
+
+        if (!file || A_rows < 0 || C_rows < 0 || cols < 0) {
+            throw std::runtime_error("The capture file " + path + " is corrupted.");
+        }
+
+        task.A.resize(A_rows, cols);
+        task.b.resize(A_rows);
+        task.C.resize(C_rows, cols);
+        task.d.resize(C_rows);
+
+        read_doubles(file, task.A.data(), task.A.size());
+        read_doubles(file, task.b.data(), task.b.size());
+        read_doubles(file, task.C.data(), task.C.size());
+        read_doubles(file, task.d.data(), task.d.size());
+
+        if (weighted) {
+            task.we.resize(A_rows);
+            task.wi.resize(C_rows);
+            read_doubles(file, task.we.data(), task.we.size());
+            read_doubles(file, task.wi.data(), task.wi.size());
+        }
+    }
+
+    if (!file) {
+        throw std::runtime_error("The capture file " + path + " is truncated.");
+    }
+
+    return problem;
+}
+
+
+
+/* ========================================================================== */
+/*                           WRITE_CAPTURED_PROBLEM                           */
+/* ========================================================================== */
+
+void write_captured_problem(const std::string& path, const CapturedProblem& problem)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Cannot open the capture file " + path + ".");
+    }
+
+    write_header(file, problem.cycle, problem.trigger, static_cast<int>(problem.tasks.size()), problem.regularization, problem.wall_time);
+
+    write_value<std::int32_t>(file, static_cast<std::int32_t>(problem.sol.size()));
+    write_doubles(file, problem.sol.data(), problem.sol.size());
+
+    for (int priority = 0; priority < static_cast<int>(problem.tasks.size()); priority++) {
+        const auto& task = problem.tasks[priority];
+        const bool weighted = task.we.size() != 0 || task.wi.size() != 0;
+
+        write_value<std::int32_t>(file, priority);
+        write_value<std::int32_t>(file, task.m_eq);
+        write_value<std::int32_t>(file, static_cast<std::int32_t>(task.A.rows()));
+        write_value<std::int32_t>(file, static_cast<std::int32_t>(task.C.rows()));
+        write_value<std::int32_t>(file, static_cast<std::int32_t>(std::max(task.A.cols(), task.C.cols())));
+        write_value<std::int32_t>(file, weighted ? 1 : 0);
+
+        write_doubles(file, task.A.data(), task.A.size());
+        write_doubles(file, task.b.data(), task.b.size());
+        write_doubles(file, task.C.data(), task.C.size());
+        write_doubles(file, task.d.data(), task.d.size());
+
+        if (weighted) {
+            write_doubles(file, task.we.data(), task.we.size());
+            write_doubles(file, task.wi.data(), task.wi.size());
+        }
+    }
+
+    if (!file) {
+        throw std::runtime_error("Cannot write the capture file " + path + ".");
+    }
+}
+
+
+
+/* ========================================================================== */
+/*                            PROBLEMCAPTURE CLASS                            */
+/* ========================================================================== */
+
+ProblemCapture::ProblemCapture(std::string directory, std::size_t max_values, int n_slots)
+: directory_(std::move(directory)),
+  slots_(std::max(n_slots, 2)),
+  full_(std::max(n_slots, 2)),
+  free_(std::max(n_slots, 2))
+{
+    for (auto& slot : slots_) {
+        slot.values.reserve(max_values);
+        slot.levels.reserve(64);
+        slot.sol.reserve(1024);
+    }
+
+    // The first slot is the one being recorded, the other ones are free.
+    for (int i = 1; i < static_cast<int>(slots_.size()); i++) {
+        free_.push(i);
+    }
+
+    writer_thread_ = std::thread([this]() {
+        while (running_) {
+            write_pending();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        write_pending();
+    });
+}
+
+
+ProblemCapture::~ProblemCapture()
+{
+    running_ = false;
+
+    if (writer_thread_.joinable()) {
+        writer_thread_.join();
+    }
+}
+
+
+
+/* ========================================================================== */
+/*                                BEGIN_PROBLEM                               */
+/* ========================================================================== */
+
+void ProblemCapture::begin_problem(long cycle, double regularization)
+{
+    auto& slot = slots_[current_];
+
+    slot.cycle = cycle;
+    slot.regularization = regularization;
+    slot.overflow = false;
+    slot.levels.clear();
+    slot.values.clear();
+    slot.sol.clear();
+
+    recording_ = true;
+}
+
+
+
+/* ========================================================================== */
+/*                                RECORD_LEVEL                                */
+/* ========================================================================== */
+
+void ProblemCapture::record_level(
+    int priority,
+    const Ref<const MatrixXd>& A,
+    const Ref<const VectorXd>& b,
+    const Ref<const MatrixXd>& C,
+    const Ref<const VectorXd>& d,
+    const Ref<const VectorXd>& we,
+    const Ref<const VectorXd>& wi,
+    int m_eq
+) {
+    if (!recording_) {
+        return;
+    }
+
+    auto& slot = slots_[current_];
+
+    const bool weighted = we.size() != 0 || wi.size() != 0;
+    const std::size_t size = A.size() + b.size() + C.size() + d.size() + (weighted ? we.size() + wi.size() : 0);
+
+    // The buffers are never enlarged, so that the real-time thread does not allocate.
+    if (slot.overflow || slot.levels.size() == slot.levels.capacity() || slot.values.size() + size > slot.values.capacity()) {
+        slot.overflow = true;
+        return;
+    }
+
+    LevelHeader level;
+    level.priority = priority;
+    level.m_eq = m_eq;
+    level.A_rows = static_cast<int>(A.rows());
+    level.C_rows = static_cast<int>(C.rows());
+    level.cols = static_cast<int>(std::max(A.cols(), C.cols()));
+    level.weighted = weighted ? 1 : 0;
+    level.offset = slot.values.size();
+    level.size = size;
+    slot.levels.push_back(level);
+
+    // A and C may be blocks of larger matrices, hence they are copied column by column.
+    for (Index j = 0; j < A.cols(); j++) {
+        append_values(A.col(j).data(), A.rows());
+    }
+    append_values(b.data(), b.size());
+    for (Index j = 0; j < C.cols(); j++) {
+        append_values(C.col(j).data(), C.rows());
+    }
+    append_values(d.data(), d.size());
+
+    if (weighted) {
+        append_values(we.data(), we.size());
+        append_values(wi.data(), wi.size());
+    }
+}
+
+
+
+/* ========================================================================== */
+/*                                 END_PROBLEM                                */
+/* ========================================================================== */
+
+void ProblemCapture::end_problem(const Ref<const VectorXd>& sol, bool failed, bool budget_exhausted, double wall_time)
+{
+    if (!recording_) {
+        return;
+    }
+    recording_ = false;
+
+    const bool overrun = budget_exhausted || (overrun_threshold_ > 0 && wall_time > overrun_threshold_);
+    const bool requested = request_.exchange(false, std::memory_order_relaxed);
+
+    if (!(failed && capture_failures_) && !overrun && !requested) {
+        return;
+    }
+
+    auto& slot = slots_[current_];
+
+    int next = 0;
+    if (slot.overflow || static_cast<std::size_t>(sol.size()) > slot.sol.capacity() || !free_.pop(next)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    slot.trigger = (failed && capture_failures_) ? CaptureTrigger::failure : (overrun ? CaptureTrigger::overrun : CaptureTrigger::request);
+    slot.wall_time = wall_time;
+    slot.sol.assign(sol.data(), sol.data() + sol.size());
+
+    full_.push(current_);
+    current_ = next;
+}
+
+
+
+/* ========================================================================== */
+/*                               APPEND_VALUES                                */
+/* ========================================================================== */
+
+void ProblemCapture::append_values(const double* data, std::size_t size)
+{
+    auto& values = slots_[current_].values;
+    values.insert(values.end(), data, data + size);
+}
+
+
+
+/* ========================================================================== */
+/*                                WRITE_PENDING                               */
+/* ========================================================================== */
+
+void ProblemCapture::write_pending()
+{
+    int index = 0;
+
+    while (full_.pop(index)) {
+        try {
+            write_slot(slots_[index]);
+            written_.fetch_add(1, std::memory_order_relaxed);
+        } catch (const std::exception& e) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            std::cerr << e.what() << '\n' << std::endl;
+        }
+
+        free_.push(index);
+    }
+}
+
+
+
+/* ========================================================================== */
+/*                                 WRITE_SLOT                                 */
+/* ========================================================================== */
+
+void ProblemCapture::write_slot(const Slot& slot) const
+{
+    const std::string path = directory_ + "/hqp_capture_" + std::to_string(slot.cycle) + "_" + trigger_name(slot.trigger) + ".bin";
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Cannot open the capture file " + path + ".");
+    }
+
+    write_header(file, slot.cycle, slot.trigger, static_cast<int>(slot.levels.size()), slot.regularization, slot.wall_time);
+
+    write_value<std::int32_t>(file, static_cast<std::int32_t>(slot.sol.size()));
+    write_doubles(file, slot.sol.data(), slot.sol.size());
+
+    for (const auto& level : slot.levels) {
+        write_value<std::int32_t>(file, level.priority);
+        write_value<std::int32_t>(file, level.m_eq);
+        write_value<std::int32_t>(file, level.A_rows);
+        write_value<std::int32_t>(file, level.C_rows);
+        write_value<std::int32_t>(file, level.cols);
+        write_value<std::int32_t>(file, level.weighted);
+
+        write_doubles(file, slot.values.data() + level.offset, level.size);
+    }
+
+    if (!file) {
+        throw std::runtime_error("Cannot write the capture file " + path + ".");
+    }
+}
+
+
+
+/* ========================================================================== */
+/*                                 SLOTQUEUE                                  */
+/* ========================================================================== */
+
+bool ProblemCapture::SlotQueue::push(int index)
+{
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+
+    if (head - tail_.load(std::memory_order_acquire) == indices_.size()) {
+        return false;
+    }
+
+    indices_[head % indices_.size()] = index;
+    head_.store(head + 1, std::memory_order_release);
+
+    return true;
+}
+
+
+bool ProblemCapture::SlotQueue::pop(int& index)
+{
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+
+    if (tail == head_.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    index = indices_[tail % indices_.size()];
+    tail_.store(tail + 1, std::memory_order_release);
+
+    return true;
+}
+
+} // namespace hopt
@@ -0,0 +1,155 @@
+#include "hierarchical_optimization/qp_backend.hpp"
+
+#include "hierarchical_optimization/active_set_qp.hpp"
+#include "hierarchical_optimization/external_qp_backends.hpp"
+
+#include <chrono>
+#include <stdexcept>
+
+
+
+namespace hopt {
+
+using namespace Eigen;
+
+
+
+/* ========================================================================== */
+/*                                    SOLVE                                   */
+/* ========================================================================== */
+
+QPStatus QPBackend::solve(
+    Ref<MatrixXd> G,
+    const Ref<const VectorXd>& g0,
+    const Ref<const MatrixXd>& CI,
+    const Ref<const VectorXd>& ci0,
+    Ref<VectorXd> x,
+    int m_eq,
+    const Ref<const VectorXi>& working_set
+) {
+    const auto start = std::chrono::steady_clock::now();
+
+    status_ = solve_impl(G, g0, CI, ci0, x, m_eq, working_set);
+
+    solve_time_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return status_;
+}
+
+
+
+/* ========================================================================== */
+/*                              SOLVE_FACTORIZED                              */
+/* ========================================================================== */
+
+QPStatus QPBackend::solve_factorized(
+    Ref<MatrixXd> L,
+    int n_factorized,
+    const Ref<const VectorXd>& g0,
+    const Ref<const MatrixXd>& CI,
+    const Ref<const VectorXd>& ci0,
+    Ref<VectorXd> x,
+    int m_eq,
+    const Ref<const VectorXi>& working_set
+) {
+    const auto start = std::chrono::steady_clock::now();
+
+    status_ = solve_factorized_impl(L, n_factorized, g0, CI, ci0, x, m_eq, working_set);
+
+    solve_time_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return status_;
+}
+
+
+
+QPStatus QPBackend::solve_factorized(
+    Ref<MatrixXd> L,
+    int n_factorized,
+    const Ref<const VectorXd>& g0,
+    const Ref<const MatrixXd>& CI,
+    const Ref<const VectorXd>& ci0,
+    const Ref<const VectorXd>& ci_upper,
+    Ref<VectorXd> x,
+    int m_eq,
+    const Ref<const VectorXi>& working_set
+) {
+    const auto start = std::chrono::steady_clock::now();
+
+    status_ = solve_factorized_impl(L, n_factorized, g0, CI, ci0, ci_upper, x, m_eq, working_set);
+
+    solve_time_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return status_;
+}
+
+
+
+/* ========================================================================== */
+/*                            SOLVE_FACTORIZED_IMPL                           */
+/* ========================================================================== */
+
+QPStatus QPBackend::solve_factorized_impl(
+    Ref<MatrixXd> L,
+    int n_factorized,
+    const Ref<const VectorXd>& g0,
+    const Ref<const MatrixXd>& CI,
+    const Ref<const VectorXd>& ci0,
+    Ref<VectorXd> x,
+    int m_eq,
+    const Ref<const VectorXi>& working_set
+) {
+    const int n = static_cast<int>(L.rows());
+    const int nf = n_factorized;
+
+    // G_ij = L_i,0:j L_j,0:j^T (j <= i). Starting from the last row, the entries of L still needed are never overwritten: row i of G only uses the rows i and j < i of L.
+    for (int i = nf - 1; i >= 0; i--) {
+        for (int j = i; j >= 0; j--) {
+            L(i, j) = L.row(i).head(j + 1).dot(L.row(j).head(j + 1));
+            L(j, i) = L(i, j);
+        }
+    }
+
+    L.topRightCorner(nf, n - nf).setZero();
+    L.bottomLeftCorner(n - nf, nf).setZero();
+    L.bottomRightCorner(n - nf, n - nf).setIdentity();
+
+    return solve_impl(L, g0, CI, ci0, x, m_eq, working_set);
+}
+
+QPStatus QPBackend::solve_factorized_impl(
+    Ref<MatrixXd> /*L*/,
+    int /*n_factorized*/,
+    const Ref<const VectorXd>& /*g0*/,
+    const Ref<const MatrixXd>& /*CI*/,
+    const Ref<const VectorXd>& /*ci0*/,
+    const Ref<const VectorXd>& /*ci_upper*/,
+    Ref<VectorXd> /*x*/,
+    int /*m_eq*/,
+    const Ref<const VectorXi>& /*working_set*/
+) {
+    throw std::logic_error("The QP backend does not accept range constraints.");
+}
+
+
+
+/* ========================================================================== */
+/*                               MAKE_QP_BACKEND                              */
+/* ========================================================================== */
+
+std::unique_ptr<QPBackend> make_qp_backend(QPBackendType type)
+{
+    switch (type)
+    {
+    case QPBackendType::quadprog:
+        return std::make_unique<QuadprogBackend>();
+    case QPBackendType::eiquadprog:
+        return std::make_unique<EiquadprogBackend>();
+    case QPBackendType::active_set:
+        break;
+    }
+
+    return std::make_unique<ActiveSetQP>();
+}
+
+} // namespace hopt
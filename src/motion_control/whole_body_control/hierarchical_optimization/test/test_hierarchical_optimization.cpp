@@ -1,13 +1,50 @@
+#include "hierarchical_optimization/active_set_qp.hpp"
+#include "hierarchical_optimization/batch_hierarchical_qp.hpp"
 #include "hierarchical_optimization/hierarchical_qp.hpp"
+#include "hierarchical_optimization/problem_capture.hpp"
 
 #include <gtest/gtest.h>
 
+#include <cmath>
 #include <cstdlib>
+#include <filesystem>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
 
 
 using namespace Eigen;
 
+#if defined(__GLIBC__)
+// The heap allocations of the process are counted while count_allocations is set, by wrapping the allocation functions of glibc.
+extern "C" void* __libc_malloc(std::size_t size);
+extern "C" void* __libc_calloc(std::size_t n, std::size_t size);
+extern "C" void* __libc_realloc(void* ptr, std::size_t size);
+
+static bool count_allocations = false;
+static long allocations = 0;
+
+extern "C" void* malloc(std::size_t size)
+{
+    if (count_allocations) {allocations++;}
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(std::size_t n, std::size_t size)
+{
+    if (count_allocations) {allocations++;}
+    return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void* ptr, std::size_t size)
+{
+    if (count_allocations) {allocations++;}
+    return __libc_realloc(ptr, size);
+}
+#endif
+
 inline void test_equal_vectors(const VectorXd& v1, const VectorXd& v2)
 {
      EXPECT_EQ(v1.size(), v2.size()) << "The solution has wrong dimension";
@@ -72,6 +109,1095 @@ TEST(hierarchical_optimization, correct_solution)
 }
 
 
+TEST(hierarchical_optimization, repeated_solutions)
+{
+    // Solving the same problem after a different one must give the same solution, regardless of the buffers reused from the previous solves.
+    hopt::HierarchicalQP hqp(2);
+    hqp.reserve(6, 4, 4);
+
+    MatrixXd A0 = MatrixXd::Zero(2, 6);
+    A0 << 1, 0, 0, 0, 0, 1,
+          0, 1, 0, 1, 0, 0;
+    VectorXd b0(2);
+    b0 << 1, 2;
+
+    MatrixXd C0 = MatrixXd::Zero(1, 6);
+    C0 << 0, 0, 1, 0, 0, 0;
+    VectorXd d0(1);
+    d0 << -1;
+
+    MatrixXd A1 = MatrixXd::Identity(6, 6).topRows(3);
+    VectorXd b1 = VectorXd::Zero(3);
+
+    MatrixXd C1 = MatrixXd::Zero(0, 6);
+    VectorXd d1 = VectorXd::Zero(0);
+
+    hqp.solve_qp(0, A0, b0, C0, d0);
+    hqp.solve_qp(1, A1, b1, C1, d1);
+    VectorXd sol = hqp.get_sol();
+
+    // A larger problem, that enlarges the buffers.
+    hqp.solve_qp(0, MatrixXd::Identity(8, 8), VectorXd::Ones(8), MatrixXd::Zero(0, 8), VectorXd::Zero(0));
+    hqp.solve_qp(1, MatrixXd::Zero(0, 8), VectorXd::Zero(0), MatrixXd::Zero(0, 8), VectorXd::Zero(0));
+
+    hqp.solve_qp(0, A0, b0, C0, d0);
+    hqp.solve_qp(1, A1, b1, C1, d1);
+
+    test_equal_vectors(hqp.get_sol(), sol);
+
+    // The equality constraints of the first task are satisfied, the inequality too.
+    test_equal_vectors(A0 * hqp.get_sol(), b0);
+    EXPECT_LE((C0 * hqp.get_sol())(0), d0(0) + 1e-6);
+}
+
+
+
+TEST(hierarchical_optimization, no_heap_allocations)
+{
+#if !defined(__GLIBC__)
+    GTEST_SKIP() << "The heap allocations are counted only with glibc.";
+#else
+    // Hierarchies with the dimensions of the whole-body controller, with 2, 3, and 4 feet in contact. The inequalities are feasible in the origin.
+    struct Task {
+        MatrixXd A, C;
+        VectorXd b, d, we, wi;
+    };
+
+    std::srand(1);
+    std::vector<std::vector<Task>> hierarchies;
+
+    for (int nc = 2; nc <= 4; nc++) {
+        const int n = 18 + 3*nc;
+        const int eq_rows[5] = {6 + 3*nc, 0, 0, 18 - 3*nc, 12 + 3*nc};
+        const int ineq_rows[5] = {0, 4, 24 + 6*nc, 0, 0};
+
+        std::vector<Task> hierarchy;
+
+        for (int p = 0; p < 5; p++) {
+            Task task;
+            task.A = MatrixXd::Random(eq_rows[p], n);
+            task.b = VectorXd::Random(eq_rows[p]);
+            task.C = MatrixXd::Random(ineq_rows[p], n);
+            task.d = VectorXd::Random(ineq_rows[p]).cwiseAbs() + VectorXd::Ones(ineq_rows[p]);
+            task.we = VectorXd::Ones(eq_rows[p]);
+            task.wi = VectorXd::Ones(ineq_rows[p]);
+            hierarchy.push_back(task);
+        }
+
+        hierarchies.push_back(hierarchy);
+    }
+
+    // Both the null space modes, with and without the warm start and the pruning of the constraints.
+    for (int config = 0; config < 8; config++) {
+        const auto mode = (config & 1) ? hopt::NullSpaceMode::basis : hopt::NullSpaceMode::projector;
+        const bool warm_start = config & 2;
+        const bool constraint_pruning = config & 4;
+
+        hopt::HierarchicalQP hqp(4);
+        hqp.set_null_space_mode(mode);
+        hqp.set_warm_start(warm_start);
+        hqp.set_constraint_pruning(constraint_pruning);
+
+        auto solve_all = [&hqp, &hierarchies]() {
+            for (const auto& hierarchy : hierarchies) {
+                for (int p = 0; p < 5; p++) {
+                    const Task& t = hierarchy[p];
+                    hqp.solve_qp(p, t.A, t.b, t.C, t.d, t.we, t.wi);
+                }
+            }
+        };
+
+        // The first solves enlarge the buffers (warm-up), the following ones must not allocate.
+        solve_all();
+
+        allocations = 0;
+        count_allocations = true;
+        for (int rep = 0; rep < 3; rep++) {
+            solve_all();
+        }
+        count_allocations = false;
+
+        EXPECT_EQ(allocations, 0) << "with the null space mode " << static_cast<int>(mode) << ", warm start " << warm_start << ", and constraint pruning " << constraint_pruning;
+    }
+#endif
+}
+
+
+
+TEST(hierarchical_optimization, null_space_basis)
+{
+    // The solution does not depend on how the null space is represented.
+    hopt::HierarchicalQP hqp_projector(2);
+    hopt::HierarchicalQP hqp_basis(2);
+    hqp_basis.set_null_space_mode(hopt::NullSpaceMode::basis);
+
+    MatrixXd A0(2, 6);
+    A0 << 0.4387,   0.1869,   0.7094,   0.6551,   0.9597,   0.7513,
+          0.3816,   0.4898,   0.7547,   0.1626,   0.3404,   0.2551;
+    VectorXd b0(2);
+    b0 << 0.6948,   0.3171;
+
+    MatrixXd C0(2, 6);
+    C0 << 0.8909,   0.5472,   0.1493,   0.8407,   0.8143,   0.9293,
+          0.9593,   0.1386,   0.2575,   0.2543,   0.2435,   0.3500;
+    VectorXd d0(2);
+    d0 << 0.3804,    0.0759;
+
+    MatrixXd A1(2, 6);
+    A1 << 0.7655,   0.4456,   0.2760,   0.1190,   0.5853,   0.5060,
+          0.7952,   0.6463,   0.6797,   0.4984,   0.2238,   0.6991;
+    VectorXd b1(2);
+    b1 << 0.9502,   0.0344;
+
+    MatrixXd C1(2, 6);
+    C1 << 0.2630,   0.6892,   0.4505,   0.2290,   0.1524,   0.5383,
+          0.6541,   0.7482,   0.0838,   0.9133,   0.8258,   0.9961;
+    VectorXd d1(2);
+    d1 << 0.0782, 0.0782;
+
+    MatrixXd A2 = MatrixXd::Identity(6, 6);
+    VectorXd b2 = VectorXd::Zero(6);
+
+    for (auto* hqp : {&hqp_projector, &hqp_basis}) {
+        hqp->solve_qp(0, A0, b0, C0, d0);
+        hqp->solve_qp(1, A1, b1, C1, d1);
+        hqp->solve_qp(2, A2, b2, MatrixXd::Zero(0, 6), VectorXd::Zero(0));
+    }
+
+    test_equal_vectors(hqp_basis.get_sol(), hqp_projector.get_sol());
+
+    // Each of the first two tasks removes two dimensions from the null space.
+    EXPECT_EQ(hqp_basis.get_null_space_dimension(), 2);
+}
+
+
+
+TEST(hierarchical_optimization, warm_start)
+{
+    // Warm starting with the active set of the previous cycle does not change the solution.
+    hopt::HierarchicalQP hqp_cold(1);
+    hopt::HierarchicalQP hqp_warm(1);
+    hqp_warm.set_warm_start(true);
+
+    // Every QP is solved by the backend, also the ones without inequality constraints of their own.
+    hqp_cold.set_fast_path(false);
+    hqp_warm.set_fast_path(false);
+
+    // The first task leaves one direction free for the second one.
+    MatrixXd A0 = MatrixXd::Identity(4, 4).topRows(3);
+    VectorXd b0(3);
+    b0 << 1, 1, 1;
+
+    MatrixXd C0(3, 4);
+    C0 << 1, 0, 0, 0,
+          0, 1, 1, 0,
+          0, 0, 1, 1;
+    VectorXd d0(3);
+    d0 << 0.5, 0.5, 0.2;
+
+    MatrixXd A1 = MatrixXd::Ones(1, 4);
+    VectorXd b1 = VectorXd::Zero(1);
+
+    for (int cycle = 0; cycle < 3; cycle++) {
+        for (auto* hqp : {&hqp_cold, &hqp_warm}) {
+            hqp->solve_qp(0, A0, b0 * (1 + 0.01 * cycle), C0, d0);
+            hqp->solve_qp(1, A1, b1, MatrixXd::Zero(0, 4), VectorXd::Zero(0));
+        }
+
+        test_equal_vectors(hqp_warm.get_sol(), hqp_cold.get_sol());
+    }
+
+    // Only the first cycle is cold started.
+    EXPECT_EQ(hqp_warm.get_solver_stats().cold_starts, 2);
+    EXPECT_EQ(hqp_warm.get_solver_stats().warm_starts, 4);
+    EXPECT_LT(hqp_warm.get_solver_stats().iterations, hqp_cold.get_solver_stats().iterations);
+
+    // After a change of the key, the QPs are cold started again.
+    hqp_warm.set_warm_start_key(1);
+    hqp_warm.solve_qp(0, A0, b0, C0, d0);
+    EXPECT_EQ(hqp_warm.get_solver_stats().cold_starts, 3);
+}
+
+
+TEST(hierarchical_optimization, qp_backends)
+{
+    // All the QP backends find the same solution of the hierarchical problem.
+    MatrixXd A0(4, 6);
+    A0 << 0.4387,   0.1869,   0.7094,   0.6551,   0.9597,   0.7513,
+          0.3816,   0.4898,   0.7547,   0.1626,   0.3404,   0.2551,
+          0.7655,   0.4456,   0.2760,   0.1190,   0.5853,   0.5060,
+          0.7952,   0.6463,   0.6797,   0.4984,   0.2238,   0.6991;
+    VectorXd b0(4);
+    b0 << 0.6948,   0.3171,   0.9502,   0.0344;
+
+    MatrixXd C0(2, 6);
+    C0 << 0.8909,   0.5472,   0.1493,   0.8407,   0.8143,   0.9293,
+          0.9593,   0.1386,   0.2575,   0.2543,   0.2435,   0.3500;
+    VectorXd d0(2);
+    d0 << 0.3804,    0.0759;
+
+    MatrixXd A1(1, 6);
+    A1 << 0.1622,   0.7943,   0.3112,   0.5285,   0.1656,   0.6020;
+    VectorXd b1 = VectorXd::Zero(1);
+
+    MatrixXd C1(2, 6);
+    C1 << 0.2630,   0.6892,   0.4505,   0.2290,   0.1524,   0.5383,
+          0.6541,   0.7482,   0.0838,   0.9133,   0.8258,   0.9961;
+    VectorXd d1(2);
+    d1 << 0.0782, 0.0782;
+
+    VectorXd sol(6);
+    sol << -0.166568, -0.156958, 0.0831332, -2.1497, 1.06716, 1.49388;
+
+    for (auto backend : {hopt::QPBackendType::active_set, hopt::QPBackendType::quadprog, hopt::QPBackendType::eiquadprog}) {
+        hopt::HierarchicalQP hqp(2);
+        hqp.set_qp_backend(backend);
+
+        hqp.solve_qp(0, A0, b0, C0, d0);
+        hqp.solve_qp(1, A1, b1, C1, d1);
+
+        test_equal_vectors(hqp.get_sol(), sol);
+        EXPECT_EQ(hqp.get_qp_backend().get_status(), hopt::QPStatus::success);
+    }
+}
+
+
+
+TEST(hierarchical_optimization, active_set_degenerate)
+{
+    // Feasible QPs whose constraints are linearly dependent combinations of a few rows, with scales from 1e-2 to 1e5, and many of them active at the same point. The constraints that are dependent on the active ones are excluded instead of making the QP inconsistent.
+    std::srand(3);
+
+    hopt::ActiveSetQP qp;
+
+    for (int trial = 0; trial < 500; trial++) {
+        const int n = 6;
+        const int n_rows = 3 + std::rand() % 3;
+        const int m = 8 + std::rand() % 8;
+
+        const MatrixXd rows = MatrixXd::Random(n_rows, n);
+        MatrixXd CI(m, n);
+        for (int i = 0; i < m; i++) {
+            CI.row(i) = VectorXd::Random(n_rows).transpose() * rows * std::pow(10.0, std::rand() % 8 - 2);
+        }
+
+        // Half of the constraints are active in x0.
+        const VectorXd x0 = 10 * VectorXd::Random(n);
+        VectorXd slack = VectorXd::Random(m).cwiseAbs();
+        for (int i = 0; i < m; i += 2) {
+            slack(i) = 0;
+        }
+        const VectorXd ci0 = - CI * x0 + slack.cwiseProduct(CI.rowwise().norm());
+
+        const MatrixXd M = MatrixXd::Random(n, n);
+        const MatrixXd G0 = M * M.transpose() + MatrixXd::Identity(n, n);
+        const VectorXd g0 = 100 * VectorXd::Random(n);
+
+        MatrixXd G = G0;
+        VectorXd x(n);
+        ASSERT_EQ(qp.solve(G, g0, CI, ci0, x), hopt::QPStatus::success) << "at trial " << trial;
+
+        // Feasibility, and the KKT conditions with the multipliers of the active constraints.
+        const VectorXd s = CI * x + ci0;
+        for (int i = 0; i < m; i++) {
+            EXPECT_GT(s(i), -1e-8 * (1 + CI.row(i).norm())) << "at trial " << trial;
+        }
+
+        VectorXd residual = G0 * x + g0;
+        for (int k = 0; k < qp.get_active_set().size(); k++) {
+            EXPECT_GT(qp.get_multipliers()(k), -1e-8) << "at trial " << trial;
+            residual -= qp.get_multipliers()(k) * CI.row(qp.get_active_set()(k)).transpose();
+        }
+        EXPECT_LT(residual.norm(), 1e-6 * (1 + g0.norm())) << "at trial " << trial;
+    }
+}
+
+
+
+TEST(hierarchical_optimization, fixed_size)
+{
+    // The fixed size version gives the same solution of the dynamic one.
+    hopt::HierarchicalQP hqp_dynamic(1);
+    hopt::FixedHierarchicalQP<6, 4, 4> hqp_fixed(1);
+
+    MatrixXd A0(2, 6);
+    A0 << 1, 0, 0, 0, 0, 1,
+          0, 1, 0, 1, 0, 0;
+    VectorXd b0(2);
+    b0 << 1, 2;
+
+    MatrixXd C0(2, 6);
+    C0 << 0, 0, 1, 0, 0, 0,
+          1, 1, 0, 0, 0, 0;
+    VectorXd d0(2);
+    d0 << -1, 0.5;
+
+    MatrixXd A1 = MatrixXd::Identity(6, 6).topRows(4);
+    VectorXd b1 = VectorXd::Ones(4);
+
+    MatrixXd C1 = MatrixXd::Ones(1, 6);
+    VectorXd d1 = VectorXd::Ones(1);
+
+    hqp_dynamic.solve_qp(0, A0, b0, C0, d0);
+    hqp_dynamic.solve_qp(1, A1, b1, C1, d1);
+
+    hqp_fixed.solve_qp(0, A0, b0, C0, d0);
+    hqp_fixed.solve_qp(1, A1, b1, C1, d1);
+
+    test_equal_vectors(hqp_fixed.get_sol(), hqp_dynamic.get_sol());
+
+    // A problem larger than the maximum dimensions is rejected.
+    EXPECT_THROW(hqp_fixed.reserve(7, 4, 4), std::length_error);
+    EXPECT_THROW(
+        hqp_fixed.solve_qp(0, MatrixXd::Identity(5, 6), VectorXd::Ones(5), MatrixXd::Zero(0, 6), VectorXd::Zero(0)),
+        std::length_error
+    );
+}
+
+
+
+TEST(hierarchical_optimization, task_ranks)
+{
+    // The rank of each task is exposed, and the tasks after the optimization vector is fully constrained are skipped.
+    for (auto mode : {hopt::NullSpaceMode::projector, hopt::NullSpaceMode::basis}) {
+        hopt::HierarchicalQP hqp(3);
+        hqp.set_null_space_mode(mode);
+
+        // Two linearly dependent rows: rank 1.
+        MatrixXd A0(2, 3);
+        A0 << 1, 1, 0,
+              2, 2, 0;
+        VectorXd b0(2);
+        b0 << 1, 2;
+
+        hqp.solve_qp(0, A0, b0, MatrixXd::Zero(0, 3), VectorXd::Zero(0));
+
+        EXPECT_EQ(hqp.get_task_rank(0), 1);
+        EXPECT_EQ(hqp.get_free_dimension(), 2);
+        EXPECT_EQ(hqp.get_task_rank(1), -1);
+
+        MatrixXd A1(2, 3);
+        A1 << 1, 0, 0,
+              0, 0, 1;
+        VectorXd b1(2);
+        b1 << 0.2, 3;
+
+        hqp.solve_qp(1, A1, b1, MatrixXd::Zero(0, 3), VectorXd::Zero(0));
+
+        EXPECT_EQ(hqp.get_task_rank(1), 2);
+        EXPECT_TRUE(hqp.is_fully_constrained());
+
+        VectorXd sol(3);
+        sol << 0.2, 0.8, 3;
+        test_equal_vectors(hqp.get_sol(), sol);
+
+        // This task cannot change the solution.
+        MatrixXd C2 = MatrixXd::Identity(3, 3);
+        VectorXd d2 = VectorXd::Zero(3);
+
+        hqp.solve_qp(2, MatrixXd::Identity(3, 3), VectorXd::Zero(3), C2, d2);
+
+        test_equal_vectors(hqp.get_sol(), sol);
+        EXPECT_EQ(hqp.get_task_rank(2), 0);
+        EXPECT_EQ(hqp.get_solver_stats().skipped, 1);
+        EXPECT_EQ(hqp.get_solver_stats().solves + hqp.get_solver_stats().fast_path_hits, 2);
+    }
+}
+
+
+
+TEST(hierarchical_optimization, time_budget)
+{
+    // When the time budget is exhausted, the lower priority tasks are not solved and the solution of the higher priority ones is kept.
+    MatrixXd A0(1, 3);
+    A0 << 1, 1, 1;
+    VectorXd b0(1);
+    b0 << 3;
+
+    const MatrixXd A1 = MatrixXd::Identity(3, 3).topRows(2);
+    VectorXd b1(2);
+    b1 << 2, 0;
+
+    const MatrixXd C1 = MatrixXd::Identity(3, 3).bottomRows(1);
+    VectorXd d1(1);
+    d1 << 5;
+
+    hopt::HierarchicalQP hqp_reference(1);
+    hqp_reference.solve_qp(0, A0, b0, MatrixXd::Zero(0, 3), VectorXd::Zero(0));
+    const VectorXd sol_0 = hqp_reference.get_sol();
+
+    hopt::HierarchicalQP hqp(2);
+
+    // A budget that is exhausted by the task with priority 0 (which is always solved).
+    hqp.set_time_budget(1e-12);
+
+    hqp.solve_qp(0, A0, b0, MatrixXd::Zero(0, 3), VectorXd::Zero(0));
+    EXPECT_TRUE(hqp.fits_time_budget(0));
+    EXPECT_FALSE(hqp.fits_time_budget(1));
+
+    hqp.solve_qp(1, A1, b1, C1, d1);
+    hqp.solve_qp(2, MatrixXd::Identity(3, 3), VectorXd::Zero(3), MatrixXd::Zero(0, 3), VectorXd::Zero(0));
+
+    EXPECT_EQ(hqp.get_solved_levels(), 1);
+    EXPECT_TRUE(hqp.is_time_budget_exhausted());
+    EXPECT_EQ(hqp.get_solver_stats().budget_skips, 2);
+    test_equal_vectors(hqp.get_sol(), sol_0);
+
+    // Without the limit, the whole hierarchy is solved again.
+    hqp.set_time_budget(0);
+
+    hqp.solve_qp(0, A0, b0, MatrixXd::Zero(0, 3), VectorXd::Zero(0));
+    hqp.solve_qp(1, A1, b1, C1, d1);
+    hqp.solve_qp(2, MatrixXd::Identity(3, 3), VectorXd::Zero(3), MatrixXd::Zero(0, 3), VectorXd::Zero(0));
+
+    EXPECT_EQ(hqp.get_solved_levels(), 3);
+    EXPECT_FALSE(hqp.is_time_budget_exhausted());
+
+    VectorXd sol(3);
+    sol << 2, 0, 1;
+    test_equal_vectors(hqp.get_sol(), sol);
+
+    // A caller that stops passing the tasks with skip_remaining() gets the same bookkeeping, and the problem is captured as an overrun.
+    const auto directory = std::filesystem::temp_directory_path() / "hqp_skip_remaining_test";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    auto buffer = std::make_shared<hopt::DiagnosticsBuffer>();
+    hqp.set_diagnostics_buffer(buffer);
+    hqp.reset_solver_stats();
+
+    {
+        auto capture = std::make_shared<hopt::ProblemCapture>(directory.string());
+        hqp.set_problem_capture(capture);
+        hqp.set_time_budget(1e-12);
+
+        hqp.solve_qp(0, A0, b0, MatrixXd::Zero(0, 3), VectorXd::Zero(0));
+        ASSERT_FALSE(hqp.fits_time_budget(1));
+        hqp.skip_remaining(1);
+
+        hqp.set_problem_capture(nullptr);
+    }
+
+    EXPECT_TRUE(hqp.is_time_budget_exhausted());
+    EXPECT_EQ(hqp.get_solver_stats().budget_skips, 2);
+    test_equal_vectors(hqp.get_sol(), sol_0);
+
+    hopt::LevelDiagnostics record;
+    ASSERT_TRUE(buffer->pop(record));
+    EXPECT_EQ(record.result, hopt::LevelResult::solved);
+    for (int p = 1; p <= 2; p++) {
+        ASSERT_TRUE(buffer->pop(record));
+        EXPECT_EQ(record.priority, p);
+        EXPECT_EQ(record.result, hopt::LevelResult::time_budget);
+    }
+
+    const auto captured = hopt::read_captured_problem((directory / ("hqp_capture_" + std::to_string(record.cycle) + "_overrun.bin")).string());
+    EXPECT_EQ(captured.tasks.size(), 1);
+
+    std::filesystem::remove_all(directory);
+}
+
+
+
+TEST(hierarchical_optimization, diagnostics)
+{
+    // A record is written for each priority of each problem.
+    MatrixXd A0(1, 3);
+    A0 << 1, 1, 1;
+    VectorXd b0(1);
+    b0 << 3;
+
+    const MatrixXd A1 = MatrixXd::Identity(3, 3).topRows(2);
+    VectorXd b1(2);
+    b1 << 2, 0;
+
+    // Violated by the solution: in the null space of the task with priority 0, each of the three rows of the task with priority 1 has a residual of 1/3.
+    const MatrixXd C1 = MatrixXd::Identity(3, 3).bottomRows(1);
+    VectorXd d1(1);
+    d1 << 0;
+
+    auto buffer = std::make_shared<hopt::DiagnosticsBuffer>();
+
+    hopt::HierarchicalQP hqp(2);
+    hqp.set_diagnostics_buffer(buffer);
+
+    for (int cycle = 1; cycle <= 2; cycle++) {
+        hqp.solve_qp(0, A0, b0, MatrixXd::Zero(0, 3), VectorXd::Zero(0));
+        hqp.solve_qp(1, A1, b1, C1, d1);
+        hqp.solve_qp(2, MatrixXd::Identity(3, 3), VectorXd::Zero(3), MatrixXd::Zero(0, 3), VectorXd::Zero(0));
+
+        hopt::LevelDiagnostics record;
+
+        ASSERT_TRUE(buffer->pop(record));
+        EXPECT_EQ(record.cycle, cycle);
+        EXPECT_EQ(record.priority, 0);
+        EXPECT_EQ(record.result, hopt::LevelResult::solved);
+        EXPECT_EQ(record.status, hopt::QPStatus::success);
+        EXPECT_EQ(record.rank, 1);
+        EXPECT_EQ(record.free_dimension, 2);
+
+        ASSERT_TRUE(buffer->pop(record));
+        EXPECT_EQ(record.priority, 1);
+        EXPECT_EQ(record.result, hopt::LevelResult::solved);
+        EXPECT_EQ(record.rank, 2);
+        EXPECT_EQ(record.free_dimension, 0);
+        EXPECT_NEAR(record.slack_norm, 1. / 3., 1e-5);
+
+        // The higher priority tasks already fixed the whole optimization vector.
+        ASSERT_TRUE(buffer->pop(record));
+        EXPECT_EQ(record.priority, 2);
+        EXPECT_EQ(record.result, hopt::LevelResult::fully_constrained);
+        EXPECT_EQ(record.rank, 0);
+
+        EXPECT_FALSE(buffer->pop(record));
+    }
+
+    // When the buffer is full, the new records are dropped and counted.
+    hopt::DiagnosticsBuffer full_buffer;
+    for (std::size_t i = 0; i < hopt::DiagnosticsBuffer::capacity; i++) {
+        EXPECT_TRUE(full_buffer.push(hopt::LevelDiagnostics()));
+    }
+    EXPECT_FALSE(full_buffer.push(hopt::LevelDiagnostics()));
+    EXPECT_EQ(full_buffer.get_dropped(), 1);
+}
+
+
+
+
+TEST(hierarchical_optimization, batch)
+{
+    // Random hierarchies of different depths and sizes: the solutions do not depend on the number of threads, and are the ones of a single HierarchicalQP.
+    std::srand(0);
+
+    std::vector<hopt::HierarchicalProblem> problems(40);
+
+    for (int i = 0; i < static_cast<int>(problems.size()); i++) {
+        const int n = 6 + i % 3;
+        const int n_tasks = 1 + i % 3;
+
+        for (int p = 0; p <= n_tasks; p++) {
+            hopt::HierarchicalTask task;
+            const int A_rows = (p == n_tasks) ? n : 2;
+
+            task.A = MatrixXd::Random(A_rows, n);
+            task.b = VectorXd::Random(A_rows);
+            task.C = MatrixXd::Random(2, n);
+            task.d = VectorXd::Random(2);
+
+            // Some tasks are weighted.
+            if (p == 1) {
+                task.we = VectorXd::Constant(A_rows, 2);
+                task.wi = VectorXd::Ones(2);
+            }
+
+            problems[i].push_back(task);
+        }
+    }
+
+    hopt::BatchHierarchicalQP batch_1(1);
+    hopt::BatchHierarchicalQP batch_3(3);
+    EXPECT_EQ(batch_3.get_n_threads(), 3);
+
+    std::vector<VectorXd> solutions_1;
+    std::vector<VectorXd> solutions_3;
+
+    // The second batch reuses the HierarchicalQPs of the threads.
+    for (int k = 0; k < 2; k++) {
+        batch_1.solve(problems, solutions_1);
+        batch_3.solve(problems, solutions_3);
+
+        ASSERT_EQ(solutions_1.size(), problems.size());
+        ASSERT_EQ(solutions_3.size(), problems.size());
+
+        for (int i = 0; i < static_cast<int>(problems.size()); i++) {
+            EXPECT_EQ(solutions_1[i], solutions_3[i]) << "at problem " << i;
+        }
+    }
+
+    for (int i = 0; i < static_cast<int>(problems.size()); i++) {
+        const auto& problem = problems[i];
+        hopt::HierarchicalQP hqp(static_cast<int>(problem.size()) - 1);
+
+        for (int p = 0; p < static_cast<int>(problem.size()); p++) {
+            const auto& task = problem[p];
+            if (task.we.size() == 0) {
+                hqp.solve_qp(p, task.A, task.b, task.C, task.d);
+            } else {
+                hqp.solve_qp(p, task.A, task.b, task.C, task.d, task.we, task.wi);
+            }
+        }
+
+        test_equal_vectors(solutions_3[i], hqp.get_sol());
+        EXPECT_EQ(batch_3.get_statuses()[i], hopt::QPStatus::success);
+    }
+
+    EXPECT_EQ(batch_3.get_solver_stats().solves, batch_1.get_solver_stats().solves);
+}
+
+
+
+
+TEST(hierarchical_optimization, mixed_precision)
+{
+    // The tasks solved in mixed precision are close to the double precision solution, and the task with priority 0 (always solved in double precision) is not degraded: the differences are in its null space.
+    std::srand(0);
+
+    for (const auto mode : {hopt::NullSpaceMode::projector, hopt::NullSpaceMode::basis}) {
+        for (int trial = 0; trial < 20; trial++) {
+            const int n = 12;
+            const int n_tasks = 3;
+
+            hopt::HierarchicalQP hqp(n_tasks);
+            hopt::HierarchicalQP hqp_mixed(n_tasks);
+            hqp.set_null_space_mode(mode);
+            hqp_mixed.set_null_space_mode(mode);
+            hqp_mixed.set_mixed_precision(1);
+
+            const MatrixXd A0 = MatrixXd::Random(3, n);
+            const VectorXd b0 = VectorXd::Random(3);
+
+            hqp.solve_qp(0, A0, b0, MatrixXd::Zero(0, n), VectorXd::Zero(0));
+            hqp_mixed.solve_qp(0, A0, b0, MatrixXd::Zero(0, n), VectorXd::Zero(0));
+
+            for (int p = 1; p <= n_tasks; p++) {
+                const int A_rows = (p == n_tasks) ? n : 3;
+
+                const MatrixXd A = MatrixXd::Random(A_rows, n);
+                const VectorXd b = VectorXd::Random(A_rows);
+                const MatrixXd C = MatrixXd::Random(2, n);
+                const VectorXd d = VectorXd::Random(2);
+
+                hqp.solve_qp(p, A, b, C, d);
+                hqp_mixed.solve_qp(p, A, b, C, d);
+            }
+
+            const double scale = 1 + hqp.get_sol().lpNorm<Infinity>();
+            EXPECT_LT((hqp.get_sol() - hqp_mixed.get_sol()).lpNorm<Infinity>() / scale, 1e-4) << "at trial " << trial;
+            EXPECT_LT((A0 * (hqp_mixed.get_sol() - hqp.get_sol())).lpNorm<Infinity>(), 1e-10) << "at trial " << trial;
+        }
+    }
+}
+
+
+
+
+TEST(hierarchical_optimization, mixed_precision_inequalities)
+{
+    // With many inequality constraints, the constraints of the higher priority tasks are satisfied as in double precision: their products with the null space are not rounded to single precision.
+    std::srand(0);
+
+    for (const auto mode : {hopt::NullSpaceMode::projector, hopt::NullSpaceMode::basis}) {
+        for (int trial = 0; trial < 20; trial++) {
+            const int n = 30;
+            const int n_tasks = 4;
+
+            hopt::HierarchicalQP hqp(n_tasks);
+            hopt::HierarchicalQP hqp_mixed(n_tasks);
+            hqp.set_null_space_mode(mode);
+            hqp_mixed.set_null_space_mode(mode);
+            hqp_mixed.set_mixed_precision(2);
+
+            // All the inequality constraints are feasible at x0, and the equality tasks pull the solution away from it.
+            const VectorXd x0 = VectorXd::Random(n);
+
+            std::vector<MatrixXd> Cs;
+            std::vector<VectorXd> ds;
+
+            for (int p = 0; p <= n_tasks; p++) {
+                const int A_rows = (p == n_tasks) ? n : 4;
+
+                const MatrixXd A = MatrixXd::Random(A_rows, n);
+                const VectorXd b = VectorXd::Random(A_rows);
+                const MatrixXd C = MatrixXd::Random(10, n);
+                const VectorXd d = C * x0 + 0.1 * VectorXd::Random(10).cwiseAbs();
+
+                hqp.solve_qp(p, A, b, C, d);
+                hqp_mixed.solve_qp(p, A, b, C, d);
+
+                Cs.push_back(C);
+                ds.push_back(d);
+            }
+
+            EXPECT_EQ(hqp.get_solver_stats().failures, 0) << "at trial " << trial;
+            EXPECT_EQ(hqp_mixed.get_solver_stats().failures, 0) << "at trial " << trial;
+
+            // The tasks solved in double precision.
+            for (int p = 0; p < 2; p++) {
+                const double violation = (Cs[p] * hqp.get_sol() - ds[p]).cwiseMax(0).lpNorm<Infinity>();
+                const double violation_mixed = (Cs[p] * hqp_mixed.get_sol() - ds[p]).cwiseMax(0).lpNorm<Infinity>();
+
+                EXPECT_LT(violation_mixed, violation + 1e-8 * (1 + violation)) << "at priority " << p << ", trial " << trial;
+            }
+        }
+    }
+}
+
+
+
+TEST(hierarchical_optimization, fast_path)
+{
+    // The tasks without inequality constraints of their own are solved in closed form when the inequality constraints of the higher priority tasks are not violated, with the solution of the QP backend.
+    MatrixXd A0 = MatrixXd::Identity(3, 3).topRows(1);
+    VectorXd b0(1);
+    b0 << 1;
+
+    MatrixXd C0 = MatrixXd::Identity(3, 3).bottomRows(1);
+    VectorXd d0(1);
+    d0 << 0.5;
+
+    MatrixXd A1 = MatrixXd::Identity(3, 3).bottomRows(2);
+
+    for (const double target : {0.2, 1.}) {
+        VectorXd b1(2);
+        b1 << 0.3, target;
+
+        hopt::HierarchicalQP hqp(1);
+        hopt::HierarchicalQP hqp_backend(1);
+        hqp_backend.set_fast_path(false);
+
+        for (auto* h : {&hqp, &hqp_backend}) {
+            h->solve_qp(0, A0, b0, C0, d0);
+            h->solve_qp(1, A1, b1, MatrixXd::Zero(0, 3), VectorXd::Zero(0));
+        }
+
+        test_equal_vectors(hqp.get_sol(), hqp_backend.get_sol());
+        EXPECT_EQ(hqp.get_solver_stats().fast_path_attempts, 1);
+
+        // With a target of 1, the closed-form solution violates the constraint x_3 <= 0.5 of the first task.
+        EXPECT_EQ(hqp.get_solver_stats().fast_path_hits, target < 0.5 ? 1 : 0);
+        EXPECT_EQ(hqp.get_solver_stats().solves, target < 0.5 ? 1 : 2);
+    }
+}
+
+
+
+
+TEST(hierarchical_optimization, constraint_pruning)
+{
+    // Inactive and duplicated constraints are not passed to the QP backend, without changing the solution and the warm start.
+    std::srand(0);
+
+    const int n = 8;
+
+    // Limits far from the solution, as the torque limits, in both directions, and a duplicated row.
+    MatrixXd C0(2 * n + 2, n);
+    C0 << MatrixXd::Identity(n, n), - MatrixXd::Identity(n, n), MatrixXd::Ones(1, n), MatrixXd::Ones(1, n);
+    VectorXd d0 = VectorXd::Constant(2 * n + 2, 100);
+    d0(2 * n) = 0.5;
+
+    for (const auto mode : {hopt::NullSpaceMode::projector, hopt::NullSpaceMode::basis}) {
+        hopt::HierarchicalQP hqp(2);
+        hopt::HierarchicalQP hqp_pruning(2);
+
+        for (auto* h : {&hqp, &hqp_pruning}) {
+            h->set_null_space_mode(mode);
+            h->set_warm_start(true);
+        }
+        hqp_pruning.set_constraint_pruning(true);
+
+        for (int cycle = 0; cycle < 3; cycle++) {
+            const MatrixXd A0 = MatrixXd::Random(2, n);
+            const VectorXd b0 = VectorXd::Random(2);
+            const MatrixXd A1 = MatrixXd::Random(3, n);
+            const VectorXd b1 = VectorXd::Random(3) * 5;
+            const MatrixXd C1 = MatrixXd::Random(2, n);
+            const VectorXd d1 = VectorXd::Random(2);
+
+            for (auto* h : {&hqp, &hqp_pruning}) {
+                h->solve_qp(0, A0, b0, C0, d0);
+                h->solve_qp(1, A1, b1, C1, d1);
+                h->solve_qp(2, MatrixXd::Identity(n, n), VectorXd::Zero(n), MatrixXd::Zero(0, n), VectorXd::Zero(0));
+            }
+
+            test_equal_vectors(hqp_pruning.get_sol(), hqp.get_sol());
+        }
+
+        // At least the far limits and the duplicate of the lower priority tasks are dropped.
+        EXPECT_GE(hqp_pruning.get_solver_stats().pruned_constraints, 3 * (2 * n + 1));
+        EXPECT_EQ(hqp_pruning.get_solver_stats().warm_starts, hqp.get_solver_stats().warm_starts);
+    }
+}
+
+
+
+TEST(hierarchical_optimization, constraint_pruning_ranges)
+{
+    // Opposite constraints are merged into ranges, and parallel ones (up to the rounding errors) into a single constraint, without changing the solution and the warm start.
+    std::srand(0);
+
+    const int n = 8;
+
+    // Limits in both directions close to the solution, as the torque limits at saturation, and a scaled copy of the upper limits with rounding errors.
+    MatrixXd C0(3 * n, n);
+    C0 << MatrixXd::Identity(n, n), - MatrixXd::Identity(n, n), 2 * MatrixXd::Identity(n, n) + 1e-15 * MatrixXd::Random(n, n);
+    VectorXd d0(3 * n);
+    d0 << VectorXd::Constant(n, 0.3), VectorXd::Constant(n, 0.2), VectorXd::Constant(n, 0.5);
+
+    const int n_cycles = 3;
+
+    for (const auto mode : {hopt::NullSpaceMode::projector, hopt::NullSpaceMode::basis}) {
+        hopt::HierarchicalQP hqp(2);
+        hopt::HierarchicalQP hqp_pruning(2);
+
+        for (auto* h : {&hqp, &hqp_pruning}) {
+            h->set_null_space_mode(mode);
+            h->set_warm_start(true);
+        }
+        hqp_pruning.set_constraint_pruning(true);
+
+        for (int cycle = 0; cycle < n_cycles; cycle++) {
+            const MatrixXd A0 = MatrixXd::Random(2, n);
+            const VectorXd b0 = VectorXd::Random(2);
+            const MatrixXd A1 = MatrixXd::Random(3, n);
+            const VectorXd b1 = VectorXd::Random(3) * 5;
+
+            for (auto* h : {&hqp, &hqp_pruning}) {
+                h->solve_qp(0, A0, b0, C0, d0);
+                h->solve_qp(1, A1, b1, MatrixXd::Zero(0, n), VectorXd::Zero(0));
+                h->solve_qp(2, MatrixXd::Identity(n, n), VectorXd::Zero(n), MatrixXd::Zero(0, n), VectorXd::Zero(0));
+            }
+
+            test_equal_vectors(hqp_pruning.get_sol(), hqp.get_sol());
+        }
+
+        // In the QPs of the priorities 1 and 2, at least the lower limits and the scaled copies are merged.
+        EXPECT_GE(hqp_pruning.get_solver_stats().pruned_constraints, n_cycles * 2 * (2 * n));
+        EXPECT_EQ(hqp_pruning.get_solver_stats().warm_starts, hqp.get_solver_stats().warm_starts);
+        EXPECT_EQ(hqp_pruning.get_solver_stats().failures, 0);
+    }
+
+    // ActiveSetQP gives the same solution with the ranges as with their two sides as separate constraints, also warm started with the upper sides.
+    {
+        const int nq = 6;
+        const int m = 5;
+
+        const MatrixXd M = MatrixXd::Random(nq, nq);
+        const MatrixXd G = M.transpose() * M + 1e-3 * MatrixXd::Identity(nq, nq);
+        const VectorXd g0 = VectorXd::Random(nq) * 5;
+        const MatrixXd CI = MatrixXd::Random(m, nq);
+        const VectorXd ci0 = VectorXd::Constant(m, 0.1);
+
+        // The first constraint is one-sided.
+        VectorXd ci_upper = VectorXd::Constant(m, 0.2);
+        ci_upper(0) = std::numeric_limits<double>::infinity();
+
+        MatrixXd CI_sides(2 * m - 1, nq);
+        CI_sides << CI, - CI.bottomRows(m - 1);
+        VectorXd ci0_sides(2 * m - 1);
+        ci0_sides << ci0, ci_upper.tail(m - 1);
+
+        hopt::ActiveSetQP qp;
+
+        MatrixXd G_copy = G;
+        VectorXd x(nq);
+        EXPECT_EQ(qp.solve(G_copy, g0, CI_sides, ci0_sides, x), hopt::QPStatus::success);
+
+        MatrixXd L = G.llt().matrixL();
+        VectorXd x_ranges(nq);
+        EXPECT_EQ(qp.solve_factorized(L, nq, g0, CI, ci0, ci_upper, x_ranges, 0, VectorXi()), hopt::QPStatus::success);
+        EXPECT_LT((x_ranges - x).norm(), 1e-9);
+
+        const VectorXi active_set = qp.get_active_set();
+        EXPECT_TRUE((active_set.array() >= m).any()) << "no upper side is active";
+
+        L = G.llt().matrixL();
+        EXPECT_EQ(qp.solve_factorized(L, nq, g0, CI, ci0, ci_upper, x_ranges, 0, active_set), hopt::QPStatus::success);
+        EXPECT_LT((x_ranges - x).norm(), 1e-9);
+        EXPECT_EQ(qp.get_n_warm_started_constraints(), active_set.size());
+    }
+}
+
+
+
+TEST(hierarchical_optimization, factorized_hessian)
+{
+    // Passing the Cholesky factor of the leading block of G = [H, 0; 0, I] gives the same solution as passing G, both with the backends that use the factor and with the ones that rebuild G.
+    std::srand(0);
+
+    const int nz = 6;
+    const int n = nz + 3;
+    const int m = 8;
+
+    const MatrixXd M = MatrixXd::Random(nz, nz);
+    MatrixXd G = MatrixXd::Identity(n, n);
+    G.topLeftCorner(nz, nz) = M.transpose() * M + 1e-3 * MatrixXd::Identity(nz, nz);
+
+    const VectorXd g0 = VectorXd::Random(n);
+    const MatrixXd CI = MatrixXd::Random(m, n);
+    const VectorXd ci0 = VectorXd::Random(m) - VectorXd::Constant(m, 0.5);
+
+    for (auto backend : {hopt::QPBackendType::active_set, hopt::QPBackendType::eiquadprog}) {
+        auto qp = hopt::make_qp_backend(backend);
+
+        MatrixXd G_copy = G;
+        VectorXd x(n);
+        EXPECT_EQ(qp->solve(G_copy, g0, CI, ci0, x, 1), hopt::QPStatus::success);
+
+        // Only the lower triangular part of the factorized block is read.
+        MatrixXd L = MatrixXd::Random(n, n);
+        L.topLeftCorner(nz, nz).triangularView<Lower>() = G.topLeftCorner(nz, nz).llt().matrixL();
+
+        VectorXd x_factorized(n);
+        EXPECT_EQ(qp->solve_factorized(L, nz, g0, CI, ci0, x_factorized, 1), hopt::QPStatus::success);
+
+        EXPECT_LT((x_factorized - x).norm(), 1e-9);
+    }
+}
+
+
+
+TEST(hierarchical_optimization, problem_capture)
+{
+    // The problems are written only when requested (or when they overrun), and replaying a captured problem gives the captured solution.
+    std::srand(0);
+
+    const auto directory = std::filesystem::temp_directory_path() / "hqp_problem_capture_test";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    const int n = 8;
+
+    hopt::HierarchicalProblem problem(3);
+    for (int p = 0; p < 3; p++) {
+        const int A_rows = (p == 2) ? n : 3;
+
+        problem[p].A = MatrixXd::Random(A_rows, n);
+        problem[p].b = VectorXd::Random(A_rows);
+        problem[p].C = MatrixXd::Random(2, n);
+        problem[p].d = VectorXd::Random(2);
+    }
+    problem[1].we = VectorXd::Constant(3, 2);
+    problem[1].wi = VectorXd::Constant(2, 0.5);
+
+    auto solve = [&problem](hopt::HierarchicalQP& hqp) {
+        for (int p = 0; p < static_cast<int>(problem.size()); p++) {
+            const auto& task = problem[p];
+            if (task.we.size() == 0) {
+                hqp.solve_qp(p, task.A, task.b, task.C, task.d);
+            } else {
+                hqp.solve_qp(p, task.A, task.b, task.C, task.d, task.we, task.wi);
+            }
+        }
+    };
+
+    hopt::HierarchicalQP hqp(2);
+    VectorXd sol;
+
+    {
+        auto capture = std::make_shared<hopt::ProblemCapture>(directory.string());
+        hqp.set_problem_capture(capture);
+
+        solve(hqp);
+
+        capture->request();
+        solve(hqp);
+        sol = hqp.get_sol();
+
+        solve(hqp);
+
+        capture->set_overrun_threshold(1e-12);
+        solve(hqp);
+
+        // The problems still waiting are written by the destructor.
+        hqp.set_problem_capture(nullptr);
+    }
+
+    int n_files = 0;
+    for ([[maybe_unused]] const auto& entry : std::filesystem::directory_iterator(directory)) {
+        n_files++;
+    }
+    EXPECT_EQ(n_files, 2);
+    EXPECT_TRUE(std::filesystem::exists(directory / "hqp_capture_4_overrun.bin"));
+
+    const auto captured = hopt::read_captured_problem((directory / "hqp_capture_2_request.bin").string());
+
+    EXPECT_EQ(captured.cycle, 2);
+    EXPECT_EQ(captured.trigger, hopt::CaptureTrigger::request);
+    ASSERT_EQ(captured.tasks.size(), problem.size());
+    for (int p = 0; p < static_cast<int>(problem.size()); p++) {
+        EXPECT_EQ(captured.tasks[p].A, problem[p].A);
+        EXPECT_EQ(captured.tasks[p].b, problem[p].b);
+        EXPECT_EQ(captured.tasks[p].C, problem[p].C);
+        EXPECT_EQ(captured.tasks[p].d, problem[p].d);
+        EXPECT_EQ(captured.tasks[p].we, problem[p].we);
+        EXPECT_EQ(captured.tasks[p].wi, problem[p].wi);
+    }
+    EXPECT_EQ(captured.sol, sol);
+
+    problem = captured.tasks;
+    hopt::HierarchicalQP hqp_replay(2);
+    hqp_replay.set_regularization(captured.regularization);
+    solve(hqp_replay);
+    test_equal_vectors(hqp_replay.get_sol(), captured.sol);
+
+    // The files written by write_captured_problem() are read back unchanged.
+    const auto path = (directory / "roundtrip.bin").string();
+    hopt::write_captured_problem(path, captured);
+    const auto read = hopt::read_captured_problem(path);
+
+    EXPECT_EQ(read.cycle, captured.cycle);
+    EXPECT_EQ(read.sol, captured.sol);
+    ASSERT_EQ(read.tasks.size(), captured.tasks.size());
+    EXPECT_EQ(read.tasks[1].A, captured.tasks[1].A);
+    EXPECT_EQ(read.tasks[1].wi, captured.tasks[1].wi);
+
+    EXPECT_THROW(hopt::read_captured_problem((directory / "missing.bin").string()), std::runtime_error);
+
+    std::filesystem::remove_all(directory);
+}
+
+
+
+
+
+TEST(hierarchical_optimization, set_n_tasks)
+{
+    // After changing the number of tasks, the hierarchical QP keeps its settings and solve as if they were constructed with it.
+    std::srand(0);
+
+    const int n = 8;
+    const int n_tasks = 3;
+
+    std::vector<MatrixXd> As, Cs;
+    std::vector<VectorXd> bs, ds;
+    for (int p = 0; p <= n_tasks; p++) {
+        const int A_rows = (p == n_tasks) ? n : 2;
+        As.push_back(MatrixXd::Random(A_rows, n));
+        bs.push_back(VectorXd::Random(A_rows));
+        Cs.push_back(MatrixXd::Random(2, n));
+        ds.push_back(VectorXd::Random(2));
+    }
+
+    auto buffer = std::make_shared<hopt::DiagnosticsBuffer>();
+
+    hopt::HierarchicalQP hqp(1);
+    hqp.set_null_space_mode(hopt::NullSpaceMode::basis);
+    hqp.set_diagnostics_buffer(buffer);
+    hqp.reserve(n, n, 2 * (n_tasks + 1));
+    hqp.set_n_tasks(n_tasks);
+
+    hopt::HierarchicalQP hqp_ref(n_tasks);
+    hqp_ref.set_null_space_mode(hopt::NullSpaceMode::basis);
+
+    for (int p = 0; p <= n_tasks; p++) {
+        hqp.solve_qp(p, As[p], bs[p], Cs[p], ds[p]);
+        hqp_ref.solve_qp(p, As[p], bs[p], Cs[p], ds[p]);
+    }
+
+    test_equal_vectors(hqp.get_sol(), hqp_ref.get_sol());
+
+    // The diagnostics buffer is still set.
+    int n_records = 0;
+    hopt::LevelDiagnostics record;
+    while (buffer->pop(record)) {
+        n_records++;
+    }
+    EXPECT_EQ(n_records, n_tasks + 1);
+}
+
+
+
+
 
 int main(int argc, char** argv)
 {
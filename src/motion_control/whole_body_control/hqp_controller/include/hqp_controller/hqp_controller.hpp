@@ -4,6 +4,7 @@
 #include "whole_body_controller/whole_body_controller.hpp"
 
 #include "controller_interface/controller_interface.hpp"
+#include "pluginlib/class_loader.hpp"
 #include "rclcpp/rclcpp.hpp"
 #include "rclcpp_lifecycle/node_interfaces/lifecycle_node_interface.hpp"
 #include "rclcpp_lifecycle/state.hpp"
@@ -12,7 +13,9 @@
 #include "generalized_pose_msgs/msg/generalized_pose.hpp"
 #include "geometry_msgs/msg/pose.hpp"
 #include "geometry_msgs/msg/twist.hpp"
+#include "std_msgs/msg/empty.hpp"
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -46,6 +49,9 @@ public:
     // CallbackReturn on_shutdown(const rclcpp_lifecycle::State& previous_state) override;
 
 private:
+    /// @brief Loader of the task plugins. It is declared before wbc, so that it is destroyed after the plugins.
+    std::unique_ptr<pluginlib::ClassLoader<wbc::TaskPlugin>> task_plugin_loader_ = nullptr;
+
     wbc::WholeBodyController wbc;
 
     std::vector<std::string> joint_names_;
@@ -66,6 +72,8 @@ private:
 
     rclcpp::Subscription<generalized_pose_msgs::msg::GeneralizedPose>::SharedPtr desired_generalized_pose_subscription_ = nullptr;
 
+    rclcpp::Subscription<std_msgs::msg::Empty>::SharedPtr capture_request_subscription_ = nullptr;
+
     /// @brief If true, the controller will publish the computed optimal joint torques, contact forces, and feet deformations.
     bool logging_ = false;
 
@@ -74,6 +82,12 @@ private:
 
     std::shared_ptr<HQPPublisher> logger_ = nullptr;
 
+    /// @brief Recorder of the hierarchical problems to be replayed offline. nullptr if capture_directory is empty.
+    std::shared_ptr<hopt::ProblemCapture> problem_capture_ = nullptr;
+
+    /// @brief Time available for each step of the whole-body controller [s]. When it is exhausted, the lowest priority tasks are not solved. 0 disables the limit.
+    double time_budget_ = 0;
+
     /// @brief Initialization time to give the state estimator some time to get better estimates. During this time, a PD controller is used to keep the robot in q0 and the planner is paused.
     double init_time_ = 1;
     std::vector<double> init_phases_ = {1};
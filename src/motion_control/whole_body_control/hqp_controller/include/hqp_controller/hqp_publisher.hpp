@@ -1,5 +1,7 @@
 #pragma once
 
+#include "hierarchical_optimization/solver_diagnostics.hpp"
+
 #include "rclcpp/rclcpp.hpp"
 
 #include "geometry_msgs/msg/polygon_stamped.hpp"
@@ -13,8 +15,10 @@
 
 #include <Eigen/Core>
 
+#include <atomic>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 
@@ -29,6 +33,8 @@ class HQPPublisher : public rclcpp::Node {
 public:
     HQPPublisher(const std::vector<std::string>& feet_names);
 
+    ~HQPPublisher() override;
+
     void publish_all(
         const Eigen::VectorXd& joints_accelerations, const Eigen::VectorXd& torques,
         const Eigen::VectorXd& forces, const Eigen::VectorXd& deformations,
@@ -38,7 +44,14 @@ public:
         const Eigen::Vector3d& com_position,
         const Eigen::VectorXd& q, const Eigen::VectorXd& v);
 
+    /// @brief Start a thread that periodically drains the diagnostics buffer of the hierarchical QP and publishes its records on /logging/hqp_diagnostics.
+    /// @details Each record is published as [cycle, priority, result, status, iterations, n_active, slack_norm, rank, free_dimension, regularization, wall_time].
+    /// The real-time thread only writes in the buffer, and never waits for this one.
+    void start_diagnostics_publisher(std::shared_ptr<hopt::DiagnosticsBuffer> buffer);
+
 private:
+    /// @brief Publish all the records in the diagnostics buffer.
+    void publish_diagnostics();
     static inline void publish_float64_multi_array(
         const Eigen::VectorXd& vector,
         const rclcpp::Publisher<std_msgs::msg::Float64MultiArray>::SharedPtr publisher);
@@ -75,6 +88,12 @@ private:
     rclcpp::Publisher<geometry_msgs::msg::PolygonStamped>::SharedPtr polygon_stamped_publisher_;
     rclcpp::Publisher<rviz_legged_msgs::msg::FrictionCones>::SharedPtr friction_cones_publisher_;
     rclcpp::Publisher<geometry_msgs::msg::PointStamped>::SharedPtr com_publisher_;
+
+    rclcpp::Publisher<std_msgs::msg::Float64MultiArray>::SharedPtr diagnostics_publisher_;
+
+    std::shared_ptr<hopt::DiagnosticsBuffer> diagnostics_buffer_ = nullptr;
+    std::thread diagnostics_thread_;
+    std::atomic<bool> diagnostics_running_ {false};
 };
 
 } // hqp_controller
\ No newline at end of file
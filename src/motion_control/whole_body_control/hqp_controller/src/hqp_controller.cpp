@@ -71,6 +71,26 @@ CallbackReturn HQPController::on_init()
         auto_declare<std::vector<double>>("kc_v", std::vector<double>());
 
         auto_declare<double>("regularization", double());
+
+        auto_declare<std::string>("null_space_mode", std::string("projector"));
+
+        auto_declare<bool>("warm_start", bool());
+
+        auto_declare<bool>("constraint_pruning", bool());
+
+        auto_declare<std::string>("qp_backend", std::string("active_set"));
+
+        auto_declare<std::string>("formulation", std::string("full"));
+
+        auto_declare<double>("time_budget", double());
+
+        auto_declare<std::string>("capture_directory", std::string());
+
+        auto_declare<double>("capture_overrun", double());
+
+        auto_declare<std::vector<std::string>>("task_plugins", std::vector<std::string>());
+
+        auto_declare<std::vector<std::string>>("task_priorities", std::vector<std::string>());
     }
     catch(const std::exception& e) {
         fprintf(stderr,"Exception thrown during init stage with message: %s \n", e.what());
@@ -155,6 +175,60 @@ CallbackReturn HQPController::on_configure(const rclcpp_lifecycle::State& /*prev
 
     wbc = wbc::WholeBodyController(robot_name, dt);
 
+    // The control tasks of other packages are loaded with pluginlib.
+    try {
+        for (const auto& class_name : get_node()->get_parameter("task_plugins").as_string_array()) {
+            if (!task_plugin_loader_) {
+                task_plugin_loader_ = std::make_unique<pluginlib::ClassLoader<wbc::TaskPlugin>>("whole_body_controller", "wbc::TaskPlugin");
+            }
+
+            wbc.add_task_plugin(task_plugin_loader_->createSharedInstance(class_name));
+        }
+    } catch (const std::exception& e) {
+        RCLCPP_ERROR(get_node()->get_logger(),"Cannot load the task plugins: %s", e.what());
+        return CallbackReturn::ERROR;
+    }
+
+    // The setters of the task hierarchy and of the formulation keep the parameters of the solvers.
+    {
+        const auto task_names = wbc.get_task_names();
+        const int n_tasks = static_cast<int>(task_names.size());
+
+        std::vector<double> task_weights(n_tasks);
+        std::vector<bool> enabled_tasks(n_tasks);
+
+        try {
+            // The parameters of the control tasks are declared once the plugins are loaded.
+            for (int i = 0; i < n_tasks; i++) {
+                auto_declare<double>("task_weights." + task_names[i], 1.);
+                auto_declare<bool>("task_enabled." + task_names[i], true);
+
+                task_weights[i] = get_node()->get_parameter("task_weights." + task_names[i]).as_double();
+                enabled_tasks[i] = get_node()->get_parameter("task_enabled." + task_names[i]).as_bool();
+            }
+
+            // Without 'task_priorities', the default priority order is used.
+            const auto task_priorities = get_node()->get_parameter("task_priorities").as_string_array();
+
+            wbc.set_task_hierarchy(
+                task_priorities.empty() ? wbc.get_task_priorities() : wbc.parse_task_priorities(task_priorities),
+                task_weights, enabled_tasks
+            );
+        } catch (const std::exception& e) {
+            RCLCPP_ERROR(get_node()->get_logger(),"Invalid task hierarchy: %s", e.what());
+            return CallbackReturn::ERROR;
+        }
+    }
+
+    if (get_node()->get_parameter("formulation").as_string() == "full") {
+        wbc.set_formulation_type(wbc::FormulationType::full);
+    } else if (get_node()->get_parameter("formulation").as_string() == "reduced") {
+        wbc.set_formulation_type(wbc::FormulationType::reduced);
+    } else {
+        RCLCPP_ERROR(get_node()->get_logger(),"'formulation' parameter must be in [full, reduced]");
+        return CallbackReturn::ERROR;
+    }
+
     q_.resize(wbc.get_nv() + 1);
     q_(6) = 1;
     v_.resize(wbc.get_nv());
@@ -312,6 +386,51 @@ CallbackReturn HQPController::on_configure(const rclcpp_lifecycle::State& /*prev
     }
     wbc.set_regularization(get_node()->get_parameter("regularization").as_double());
 
+    if (get_node()->get_parameter("null_space_mode").as_string() == "projector") {
+        wbc.set_null_space_mode(hopt::NullSpaceMode::projector);
+    } else if (get_node()->get_parameter("null_space_mode").as_string() == "basis") {
+        wbc.set_null_space_mode(hopt::NullSpaceMode::basis);
+    } else {
+        RCLCPP_ERROR(get_node()->get_logger(),"'null_space_mode' parameter must be either 'projector' or 'basis'");
+        return CallbackReturn::ERROR;
+    }
+
+    wbc.set_warm_start(get_node()->get_parameter("warm_start").as_bool());
+
+    wbc.set_constraint_pruning(get_node()->get_parameter("constraint_pruning").as_bool());
+
+    if (get_node()->get_parameter("qp_backend").as_string() == "active_set") {
+        wbc.set_qp_backend(hopt::QPBackendType::active_set);
+    } else if (get_node()->get_parameter("qp_backend").as_string() == "quadprog") {
+        wbc.set_qp_backend(hopt::QPBackendType::quadprog);
+    } else if (get_node()->get_parameter("qp_backend").as_string() == "eiquadprog") {
+        wbc.set_qp_backend(hopt::QPBackendType::eiquadprog);
+    } else {
+        RCLCPP_ERROR(get_node()->get_logger(),"'qp_backend' parameter must be in [active_set, quadprog, eiquadprog]");
+        return CallbackReturn::ERROR;
+    }
+
+    if (get_node()->get_parameter("time_budget").as_double() < 0) {
+        RCLCPP_ERROR(get_node()->get_logger(),"'time_budget' parameter must be >= 0");
+        return CallbackReturn::ERROR;
+    }
+    time_budget_ = get_node()->get_parameter("time_budget").as_double();
+
+    // Capture of the problems that fail, overrun, or are requested on /logging/hqp_capture_request.
+    if (!get_node()->get_parameter("capture_directory").as_string().empty()) {
+        problem_capture_ = std::make_shared<hopt::ProblemCapture>(get_node()->get_parameter("capture_directory").as_string());
+        problem_capture_->set_overrun_threshold(get_node()->get_parameter("capture_overrun").as_double());
+        wbc.set_problem_capture(problem_capture_);
+
+        capture_request_subscription_ = get_node()->create_subscription<std_msgs::msg::Empty>(
+            "/logging/hqp_capture_request", QUEUE_SIZE,
+            [this](const std_msgs::msg::Empty::SharedPtr /*msg*/) -> void
+            {
+                problem_capture_->request();
+            }
+        );
+    }
+
 
     /* ====================================================================== */
 
@@ -397,6 +516,11 @@ CallbackReturn HQPController::on_configure(const rclcpp_lifecycle::State& /*prev
 
     if (logging_) {
         logger_ = std::make_shared<HQPPublisher>(wbc.get_all_feet_names());
+
+        // The failures of the QPs are published by the logger instead of being printed by the real-time thread.
+        auto diagnostics_buffer = std::make_shared<hopt::DiagnosticsBuffer>();
+        wbc.set_diagnostics_buffer(diagnostics_buffer);
+        logger_->start_diagnostics_publisher(diagnostics_buffer);
     }
 
 
@@ -416,6 +540,15 @@ CallbackReturn HQPController::on_activate(const rclcpp_lifecycle::State& /*previ
 
 CallbackReturn HQPController::on_deactivate(const rclcpp_lifecycle::State& /*previous_state*/)
 {
+    const auto& stats = wbc.get_solver_stats();
+
+    RCLCPP_INFO(
+        get_node()->get_logger(),
+        "QPs solved: %ld (%ld warm started, %ld cold started) in %f s, skipped: %ld, not solved for the time budget: %ld. Iterations: %ld, constraints taken from the previous active set: %ld. Solved in closed form: %ld of %ld. Constraints pruned: %ld. Failures: %ld",
+        stats.solves, stats.warm_starts, stats.cold_starts, stats.solve_time, stats.skipped, stats.budget_skips, stats.iterations, stats.warm_started_constraints,
+        stats.fast_path_hits, stats.fast_path_attempts, stats.pruned_constraints, stats.failures
+    );
+
     return CallbackReturn::SUCCESS;
 }
 
@@ -479,7 +612,7 @@ controller_interface::return_type HQPController::update(
             des_gen_pose_copy.base_pos[2] -= wbc.get_mass() * 9.81 / (n * wbc.get_kp_terr()[2]);
         }
         
-        wbc.step(q_, v_, des_gen_pose_copy);
+        wbc.step(q_, v_, des_gen_pose_copy, time_budget_);
 
         contact_feet_names = std::move(des_gen_pose_copy.contact_feet_names);
 
@@ -1,5 +1,7 @@
 #include "hqp_controller/hqp_publisher.hpp"
 
+#include <chrono>
+
 
 
 namespace hqp_controller {
@@ -62,6 +64,70 @@ HQPPublisher::HQPPublisher(const std::vector<std::string>& feet_names)
 }
 
 
+/* =============================== Destructor =============================== */
+
+HQPPublisher::~HQPPublisher()
+{
+    diagnostics_running_ = false;
+
+    if (diagnostics_thread_.joinable()) {
+        diagnostics_thread_.join();
+    }
+}
+
+
+/* ======================= Start_diagnostics_publisher ====================== */
+
+void HQPPublisher::start_diagnostics_publisher(std::shared_ptr<hopt::DiagnosticsBuffer> buffer)
+{
+    if (diagnostics_running_) {
+        return;
+    }
+
+    diagnostics_buffer_ = std::move(buffer);
+
+    // The queue is long enough for the records of many control cycles.
+    diagnostics_publisher_ = this->create_publisher<std_msgs::msg::Float64MultiArray>(
+        "/logging/hqp_diagnostics", 100);
+
+    diagnostics_running_ = true;
+
+    diagnostics_thread_ = std::thread([this]() {
+        while (diagnostics_running_) {
+            publish_diagnostics();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        publish_diagnostics();
+    });
+}
+
+
+/* =========================== Publish_diagnostics ========================== */
+
+void HQPPublisher::publish_diagnostics()
+{
+    hopt::LevelDiagnostics record;
+
+    while (diagnostics_buffer_->pop(record)) {
+        auto message = std_msgs::msg::Float64MultiArray();
+        message.data = {
+            static_cast<double>(record.cycle),
+            static_cast<double>(record.priority),
+            static_cast<double>(record.result),
+            static_cast<double>(record.status),
+            static_cast<double>(record.iterations),
+            static_cast<double>(record.n_active),
+            record.slack_norm,
+            static_cast<double>(record.rank),
+            static_cast<double>(record.free_dimension),
+            record.regularization,
+            record.wall_time,
+        };
+        diagnostics_publisher_->publish(message);
+    }
+}
+
+
 /* ======================= Publish_float64_multi_array ====================== */
 
 inline void HQPPublisher::publish_float64_multi_array(
@@ -2,6 +2,9 @@
 
 #include "robot_model/robot_model.hpp"
 
+#include <array>
+#include <vector>
+
 
 
 namespace wbc {
@@ -14,14 +17,50 @@ enum class ContactConstraintType {soft_kv, soft_sim, rigid, invalid};
 
 
 
+/* ========================================================================== */
+/*                             FORMULATIONTYPE ENUM                           */
+/* ========================================================================== */
+
+/// @brief Optimization vector of the hierarchical problem.
+/// @details full: [u_dot, F_c, d_des]. reduced: [u_dot_j, F_c, d_des], where the base accelerations u_dot_b are eliminated with the floating base equations of motion.
+enum class FormulationType {full, reduced};
+
+
+
+/* ========================================================================== */
+/*                              TORQUEMAP STRUCT                              */
+/* ========================================================================== */
+
+/// @brief Affine map from the optimization variables to the joint torques, tau = M_a * u_dot - Jc_a^T * F_c + h_a, where _a denotes the rows (or columns) of the actuated joints.
+/// @details It is computed once per cycle by ControlTasks::reset(), and used by the torque limits, by the torques minimization and by the computation of the optimal torques.
+struct TorqueMap {
+    Eigen::MatrixXd A;      ///< @brief [M_a, - Jc_a^T] ∈ (nv-6) x (nv+nF)
+    Eigen::VectorXd h_a;    ///< @brief Nonlinear terms of the actuated joints
+};
+
+
+
+/* ========================================================================== */
+/*                          BASEELIMINATION STRUCT                            */
+/* ========================================================================== */
+
+/// @brief Base accelerations as an affine function of the reduced optimization vector y = [u_dot_j, F_c, d_des], u_dot_b = T_b * y + t_b.
+/// @details From the floating base equations of motion, M_bb * u_dot_b + M_bj * u_dot_j + h_b = Jc_b^T * F_c, hence T_b = M_bb^-1 * [- M_bj, Jc_b^T] and t_b = - M_bb^-1 * h_b. The columns of the deformations are zero and are omitted.
+struct BaseElimination {
+    Eigen::MatrixXd T_b;    ///< @brief ∈ 6 x (nv-6+nF)
+    Eigen::VectorXd t_b;    ///< @brief ∈ 6
+};
+
+
+
 /// @class @brief Implements all the tasks that are used for the the hierarchical optimization problem.
 /// @details The ControlTasks class provides methods to compute the matrices A, b, C, d that define the tasks used in the control problem. These tasks are specified in no specific order.
-/// This class is intended to be used with prioritized_tasks. This second class organizes the various control tasks by merging them in a single task of a certain priority. The priority order of the control tasks can be specified by means of the attribute prioritized_tasks_list.
+/// This class is intended to be used with prioritized_tasks. This second class organizes the various control tasks by merging them in a single task of a certain priority. The priority order of the control tasks can be specified with PrioritizedTasks::set_task_hierarchy().
 class ControlTasks {
 public:
     ControlTasks(const std::string& robot_name, float dt);
 
-    /// @brief Reset the class before restarting the optimization problem.
+    /// @brief Reset the class before restarting the optimization problem, and compute the kinematics and dynamics quantities set with set_model_quantities().
     /// @param[in] q
     /// @param[in] v
     /// @param[in] contact_feet_names
@@ -37,7 +76,7 @@ public:
     /// @brief Compute the matrices C and d that enfore the limits on the joint torques.
     /// @param[out] C
     /// @param[out] d
-    void task_torque_limits(Eigen::Ref<Eigen::MatrixXd> C, Eigen::Ref<Eigen::VectorXd> d);
+    void task_torque_limits(Eigen::Ref<Eigen::MatrixXd> C, Eigen::Ref<Eigen::VectorXd> d) const;
 
     /// @brief Compute C and d that enforce the friction limits and the limits on the normal component of the contact forces.
     /// @param[out] C
@@ -90,9 +129,10 @@ public:
     );
 
     /// @brief Compute A and b that enforce the rigid contact constraints.
+    /// @details When the jacobian of a leg in contact is singular, its contact constraint is reduced and the contact forces that do not generate joint torques are constrained to zero. Since Jc_a^T is block diagonal, this is done leg by leg, on the 3x3 blocks.
     /// @param[out] A 
     /// @param[out] b 
-    void task_contact_constraints_rigid(Eigen::Ref<Eigen::MatrixXd> A, Eigen::Ref<Eigen::VectorXd> b);
+    void task_contact_constraints_rigid(Eigen::Ref<Eigen::MatrixXd> A, Eigen::Ref<Eigen::VectorXd> b) const;
     
     /// @brief Compute A, b, C, d that enforce the soft contact constraints, assuming a Hunt-Crossley soft contact model (nonlinear springs and nonlinear dampers).
     /// @param[out] A
@@ -152,6 +192,24 @@ public:
     const Eigen::VectorXd& get_h()  const { return h; }
     const Eigen::MatrixXd& get_Jc() const { return Jc; }
 
+    /// @brief Get the map of the joint torques, computed when M, h, and Jc are computed.
+    const TorqueMap& get_torque_map() const { return torque_map; }
+
+    /// @brief Get the elimination of the base accelerations, computed with the reduced formulation.
+    const BaseElimination& get_base_elimination() const { return base_elimination; }
+
+    /// @brief Express a task computed in the full optimization vector in the reduced one, A x = b -> (A_y + A_b T_b) y = b - A_b t_b (and similarly for the inequality constraints).
+    /// @details The reduced task is written in the columns of A after the first six ones (the ones of the base accelerations), which are left unchanged.
+    /// @param[in,out] A
+    /// @param[in,out] b
+    void reduce_task(Eigen::Ref<Eigen::MatrixXd> A, Eigen::Ref<Eigen::VectorXd> b) const;
+
+    const Eigen::VectorXd& get_Jc_dot_times_v() const { return Jc_dot_times_v; }
+    const Eigen::MatrixXd& get_Jb() const { return Jb; }
+    const Eigen::VectorXd& get_Jb_dot_times_v() const { return Jb_dot_times_v; }
+    const Eigen::MatrixXd& get_Js() const { return Js; }
+    const Eigen::VectorXd& get_Js_dot_times_v() const { return Js_dot_times_v; }
+
     Eigen::VectorXd get_feet_positions() const{ return robot_model.get_feet_positions(); }
 
     Eigen::VectorXd get_feet_velocities(const Eigen::VectorXd& v) { return robot_model.get_feet_velocities(v); }
@@ -159,6 +217,9 @@ public:
     /// @brief Return the generic feet names. The generic feet names are the same for all quadrupedal robots: LF, RF, LH, and RH.
     const std::vector<std::string>& get_generic_feet_names() const {return robot_model.get_generic_feet_names();}
 
+    /// @brief Return the indices (in the generic feet names) of the feet in contact, in the order in which they have been set in reset().
+    const std::vector<int>& get_contact_feet() const {return robot_model.get_contact_feet();}
+
     /// @brief Return the feet names of the specific robot. These are the names of the links used for computing the contact point.
     const std::vector<std::string>& get_all_feet_names() const {return robot_model.get_all_feet_names();}
 
@@ -167,10 +228,18 @@ public:
 
     /* =============================== Setters ============================== */
 
+    /// @brief Set the optimization vector. With the reduced formulation, reset() also computes the elimination of the base accelerations.
+    void set_formulation_type(FormulationType formulation_type) {this->formulation_type = formulation_type;}
+
+    /// @brief Set the kinematics and dynamics quantities computed by reset(), which must include the ones used by the control tasks that are computed. By default, all of them are computed.
+    void set_model_quantities(const robot_wrapper::ModelQuantities& model_quantities) {this->model_quantities = model_quantities;}
+
+    // The setters of the parameters that enter the constant blocks invalidate them.
+
     void set_tau_max(const double tau_max) {this->tau_max = tau_max;}
-    void set_mu(const double mu) {this->mu = mu;}
-    void set_Fn_max(const double Fn_max) {this->Fn_max = Fn_max;}
-    void set_Fn_min(const double Fn_min) {this->Fn_min = Fn_min;}
+    void set_mu(const double mu) {this->mu = mu; constant_blocks.nc = -1;}
+    void set_Fn_max(const double Fn_max) {this->Fn_max = Fn_max; constant_blocks.nc = -1;}
+    void set_Fn_min(const double Fn_min) {this->Fn_min = Fn_min; constant_blocks.nc = -1;}
 
     void set_kp_b_pos(const Eigen::Ref<const Eigen::Vector3d>& kp_b_pos) {this->kp_b_pos = kp_b_pos;}
     void set_kd_b_pos(const Eigen::Ref<const Eigen::Vector3d>& kd_b_pos) {this->kd_b_pos = kd_b_pos;}
@@ -178,15 +247,35 @@ public:
     void set_kp_b_ang(const Eigen::Ref<const Eigen::Vector3d>& kp_b_ang) {this->kp_b_ang = kp_b_ang;}
     void set_kd_b_ang(const Eigen::Ref<const Eigen::Vector3d>& kd_b_ang) {this->kd_b_ang = kd_b_ang;}
 
-    void set_kp_s_pos(const Eigen::Ref<const Eigen::Vector3d>& kp_s_pos) {this->kp_s_pos = kp_s_pos;}
-    void set_kd_s_pos(const Eigen::Ref<const Eigen::Vector3d>& kd_s_pos) {this->kd_s_pos = kd_s_pos;}
+    void set_kp_s_pos(const Eigen::Ref<const Eigen::Vector3d>& kp_s_pos) {this->kp_s_pos = kp_s_pos; constant_blocks.nc = -1;}
+    void set_kd_s_pos(const Eigen::Ref<const Eigen::Vector3d>& kd_s_pos) {this->kd_s_pos = kd_s_pos; constant_blocks.nc = -1;}
 
-    void set_kp_terr(const Eigen::Ref<const Eigen::Vector3d>& kp_terr) {this->kp_terr = kp_terr;}
-    void set_kd_terr(const Eigen::Ref<const Eigen::Vector3d>& kd_terr) {this->kd_terr = kd_terr;}
+    void set_kp_terr(const Eigen::Ref<const Eigen::Vector3d>& kp_terr) {this->kp_terr = kp_terr; constant_blocks.nc = -1;}
+    void set_kd_terr(const Eigen::Ref<const Eigen::Vector3d>& kd_terr) {this->kd_terr = kd_terr; constant_blocks.nc = -1;}
 
-    void set_kc_v(const Eigen::Ref<const Eigen::Vector3d>& kc_v) {this->kc_v = kc_v;}
+    void set_kc_v(const Eigen::Ref<const Eigen::Vector3d>& kc_v) {this->kc_v = kc_v; constant_blocks.nc = -1;}
 
 private:
+    /// @brief Blocks of the tasks that depend only on the parameters and on the number of feet in contact (and not on the state of the robot).
+    struct ConstantBlocks {
+        int nc = -1;                    ///< @brief Number of feet in contact they have been computed for, -1 if they must be recomputed
+
+        Eigen::MatrixXd C_friction;     ///< @brief Friction pyramids and limits of the normal forces, in the columns of the contact forces (6 nc x nF)
+        Eigen::VectorXd d_friction;     ///< @brief Right-hand side of C_friction
+
+        Eigen::MatrixXd S_n;            ///< @brief Selector of the normal components of the contact forces (nc x nF)
+
+        Eigen::VectorXd kp_terr;        ///< @brief kp_terr repeated nc times (diagonal of Kp of the Kelvin-Voigt model)
+        Eigen::VectorXd kd_terr;        ///< @brief kd_terr repeated nc times (diagonal of Kd of the Kelvin-Voigt model)
+        Eigen::VectorXd kc_v;           ///< @brief kc_v repeated nc times (diagonal of Kc_v)
+
+        Eigen::VectorXd kp_s_pos;       ///< @brief kp_s_pos repeated for each swing foot
+        Eigen::VectorXd kd_s_pos;       ///< @brief kd_s_pos repeated for each swing foot
+    };
+
+    /// @brief Recompute the constant blocks for the current number of feet in contact.
+    void update_constant_blocks();
+
     robot_wrapper::RobotModel robot_model;
 
     int nv = 18;    ///< @brief Dimension of the generalized velocity vector
@@ -194,6 +283,12 @@ private:
     int nF =  0;    ///< @brief Dimension of the stack of the contact forces with the terrain (= 3*nc)
     int nd =  0;    ///< @brief Dimension of the stack of the desired feet deformations (= 3*nc iff a soft contact model is used)
 
+    /// @brief Maximum number of actuated joints of a leg.
+    static constexpr int max_leg_joints = 6;
+
+    /// @brief Columns of the actuated joints of each leg in the jacobians, in the order of the generic feet names.
+    std::array<std::vector<int>, 4> leg_columns;
+
     Eigen::VectorXd q;      ///< @brief Generalized coordinates vector
     Eigen::VectorXd v;      ///< @brief Generalized velocities vector
 
@@ -207,10 +302,23 @@ private:
     Eigen::MatrixXd M;                  ///< @brief Mass matrix
     Eigen::VectorXd h;                  ///< @brief Nonlinear terms vector
     Eigen::MatrixXd Jc;                 ///< @brief Stack of the contact points jacobians
+    Eigen::VectorXd Jc_dot_times_v;     ///< @brief Vector representing Jc_dot * v
 
     Eigen::MatrixXd Jb;                 ///< @brief Base jacobian
     Eigen::VectorXd Jb_dot_times_v;     ///< @brief Vector representing Jb_dot * v
 
+    Eigen::MatrixXd Js;                 ///< @brief Stack of the swing feet jacobians
+    Eigen::VectorXd Js_dot_times_v;     ///< @brief Vector representing Js_dot * v
+
+    TorqueMap torque_map;               ///< @brief Map of the joint torques
+
+    BaseElimination base_elimination;   ///< @brief Elimination of the base accelerations (reduced formulation)
+
+    FormulationType formulation_type = FormulationType::full;
+
+    /// @brief Kinematics and dynamics quantities computed by reset().
+    robot_wrapper::ModelQuantities model_quantities = {true, true, true, true, true, true, true, true};
+
     Eigen::Vector3d kp_b_pos = {1, 1, 1};       ///< @brief Controller gains on the position error of the base
     Eigen::Vector3d kd_b_pos = {1, 1, 1};       ///< @brief Controller gains on the velocity error of the base
 
@@ -227,6 +335,9 @@ private:
 
     /// @brief 
     Eigen::Vector4d knee_joint_sign = {0, 0, 0, 0};
+
+    /// @brief Cache of the blocks that do not depend on the state, recomputed by reset() when the number of feet in contact changes or after a setter invalidated them.
+    ConstantBlocks constant_blocks;
 };
 
 } // namespace wbc
\ No newline at end of file
@@ -27,6 +27,12 @@ public:
     /// @return std::pair<Eigen::VectorXd, Eigen::VectorXd> 
     std::pair<Eigen::VectorXd, Eigen::VectorXd> get_deformations_history();
 
+    /// @brief Get the deformations at the previous optimization time step, without copying them.
+    const Eigen::VectorXd& get_d_k1() const {return d_k1;}
+
+    /// @brief Get the deformations of two time steps ago, without copying them.
+    const Eigen::VectorXd& get_d_k2() const {return d_k2;}
+
     int get_def_size() const {return def_size;}
 
     void set_def_size(int def_size) {this->def_size = def_size;}
@@ -1,6 +1,12 @@
 #pragma once
 
 #include "whole_body_controller/control_tasks.hpp"
+#include "whole_body_controller/task_plugin.hpp"
+
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
 
 
 
@@ -40,7 +46,7 @@ struct GeneralizedPose {
 /*                               TASKSNAMES ENUM                              */
 /* ========================================================================== */
 
-/// @brief Contains the names of the tasks defined in the ControlTasks class.
+/// @brief Contains the names of the built-in tasks, defined in the ControlTasks class. Their value is their index among the control tasks registered in PrioritizedTasks.
 enum class TasksNames {
     FloatingBaseEOM,
     TorqueLimits,
@@ -51,7 +57,53 @@ enum class TasksNames {
     ContactConstraints,
     EnergyAndForcesOptimization,
     JointSingularities,
-    SEPARATOR       // this should be the last element of the struct (used to count the number of control tasks too).
+    SEPARATOR       // this should be the last element of the struct (used to count the number of built-in control tasks too).
+};
+
+
+
+/* ========================================================================== */
+/*                              TASKLAYOUT STRUCT                             */
+/* ========================================================================== */
+
+/// @brief Function that writes a control task in its rows of the matrices A, b, C, d of its priority.
+using TaskFunction = void (*)(
+    ControlTasks& control_tasks,
+    Eigen::Ref<Eigen::MatrixXd> A, Eigen::Ref<Eigen::VectorXd> b,
+    Eigen::Ref<Eigen::MatrixXd> C, Eigen::Ref<Eigen::VectorXd> d,
+    const GeneralizedPose& gen_pose,
+    const Eigen::VectorXd& d_k1, const Eigen::VectorXd& d_k2
+);
+
+/// @brief Rows and columns of the matrices of each priority, for a given number of feet in contact and contact constraint type.
+/// @details It is the dispatch table of the control loop: each block already points to the function (or the plugin) that computes its control task, and the weights of the rows are already expanded.
+struct TaskLayout {
+    /// @brief Rows of a control task in the matrices A (and b) and C (and d) of its priority.
+    struct Block {
+        int task = -1;                      ///< @brief Index of the control task
+        TaskFunction function = nullptr;    ///< @brief Function of a built-in control task
+        TaskPlugin* plugin = nullptr;       ///< @brief Plugin of the control task, when it is not a built-in one
+        int eq_offset = 0;
+        int eq_rows = 0;
+        int ineq_offset = 0;
+        int ineq_rows = 0;
+    };
+
+    /// @brief Control tasks of each priority, in the order in which they are stacked.
+    std::vector<std::vector<Block>> blocks;
+
+    /// @brief Rows of A (and b) of each priority.
+    std::vector<int> eq_rows;
+    /// @brief Rows of C (and d) of each priority.
+    std::vector<int> ineq_rows;
+
+    /// @brief Weights of the rows of A (and b) of each priority.
+    std::vector<Eigen::VectorXd> we;
+    /// @brief Weights of the rows of C (and d) of each priority.
+    std::vector<Eigen::VectorXd> wi;
+
+    /// @brief Dimension of the optimization vector.
+    int cols = 0;
 };
 
 
@@ -62,7 +114,8 @@ enum class TasksNames {
 
 /// @class @brief Implements the prioritized tasks, using the control tasks defined with the ControlTasks class component.
 /// @details Provides methods to merge the control tasks generated by the ControlTasks class in a single task of priority p.
-/// The priority order of the control tasks can be specified by means of the attribute prioritized_tasks_list.
+/// The control tasks are the built-in ones, with the indices of TasksNames, followed by the plugins registered with add_task_plugin().
+/// The priority order of the control tasks, their weights and which ones are used can be changed with set_task_hierarchy().
 class PrioritizedTasks {
 public:
     /// @brief Construct a new PrioritizedTasks class.
@@ -89,6 +142,19 @@ public:
         const Eigen::VectorXd& d_k1, const Eigen::VectorXd& d_k2
     );
 
+    /// @brief Compute the matrices A, b, C, d that represents the task, in blocks that already have the dimensions given by get_task_layout().
+    /// @details The blocks may belong to larger preallocated buffers, so that the task is assembled without any allocation.
+    void compute_task_p(
+        int priority,
+        Eigen::Ref<Eigen::MatrixXd> A, Eigen::Ref<Eigen::VectorXd> b,
+        Eigen::Ref<Eigen::MatrixXd> C, Eigen::Ref<Eigen::VectorXd> d,
+        const GeneralizedPose& gen_pose,
+        const Eigen::VectorXd& d_k1, const Eigen::VectorXd& d_k2
+    );
+
+    /// @brief Get the layout of the tasks with the feet in contact of the last reset() and the current contact constraint type.
+    const TaskLayout& get_task_layout() const {return task_layouts[control_tasks.get_nc()];}
+
     int get_nv() const {return control_tasks.get_nv();}
     int get_nF() const {return control_tasks.get_nF();}
     int get_nd() const {return control_tasks.get_nd();}
@@ -102,6 +168,7 @@ public:
     const Eigen::MatrixXd& get_M()  const {return control_tasks.get_M();}
     const Eigen::VectorXd& get_h()  const {return control_tasks.get_h();}
     const Eigen::MatrixXd& get_Jc() const {return control_tasks.get_Jc();}
+    const TorqueMap& get_torque_map() const {return control_tasks.get_torque_map();}
 
     Eigen::VectorXd get_feet_positions() { return control_tasks.get_feet_positions(); }
 
@@ -109,18 +176,75 @@ public:
 
     const std::vector<std::string>& get_generic_feet_names() const {return control_tasks.get_generic_feet_names();}
 
+    /// @brief Return the indices (in the generic feet names) of the feet in contact, in the order in which they have been set in reset().
+    const std::vector<int>& get_contact_feet() const {return control_tasks.get_contact_feet();}
+
     const std::vector<std::string>& get_all_feet_names() const {return control_tasks.get_all_feet_names();}
 
     int get_max_priority() const {return *max_element(tasks_vector.begin(), tasks_vector.end());}
 
+    /// @brief Get the indices of the control tasks of each priority, from the highest one.
+    const std::vector<std::vector<int>>& get_task_priorities() const {return task_priorities;}
+
+    /// @brief Get the names of the registered control tasks, in the order of their indices.
+    std::vector<std::string> get_task_names() const;
+
+    /// @brief Get the index of the control task with the given name, or -1 if there is none.
+    int get_task_index(const std::string& task_name) const;
+
+    /// @brief Convert the priorities read from the parameters in the indices of the control tasks of each priority.
+    /// @param[in] priorities one element per priority, from the highest one, with the names of its control tasks separated by spaces or commas
+    /// @throws std::invalid_argument if a name is not the one of a registered control task
+    std::vector<std::vector<int>> parse_task_priorities(const std::vector<std::string>& priorities) const;
+
     auto get_contact_constraint_type() const {return this->contact_constraint_type;}
 
+    FormulationType get_formulation_type() const {return this->formulation_type;}
+
+    /// @brief Express a task computed in the full optimization vector in the reduced one (see ControlTasks::reduce_task()).
+    void reduce_task(Eigen::Ref<Eigen::MatrixXd> A, Eigen::Ref<Eigen::VectorXd> b) const {control_tasks.reduce_task(A, b);}
+
+    const BaseElimination& get_base_elimination() const {return control_tasks.get_base_elimination();}
+
+    /// @brief Get the maximum dimensions of the hierarchical problem, over all the possible numbers of feet in contact.
+    /// @return Tuple of (dimension of the optimization vector, rows of the equality constraints of a single priority, rows of the inequality constraints of all the priorities)
+    std::tuple<int,int,int> get_max_problem_dimensions();
+
     const Eigen::Vector3d& get_kp_terr() const {return control_tasks.get_kp_terr();}
 
 
     /* =============================== Setters ============================== */
 
-    void set_contact_constraint_type(ContactConstraintType contact_constraint_type) {this->contact_constraint_type = contact_constraint_type;}
+    void set_contact_constraint_type(ContactConstraintType contact_constraint_type)
+    {
+        this->contact_constraint_type = contact_constraint_type;
+        compute_task_layouts();
+    }
+
+    /// @brief Set the optimization vector of the hierarchical problem. The tasks are still computed in the full optimization vector, and are expressed in the reduced one with reduce_task().
+    void set_formulation_type(FormulationType formulation_type)
+    {
+        this->formulation_type = formulation_type;
+        control_tasks.set_formulation_type(formulation_type);
+        compile_task_hierarchy();
+    }
+
+    /// @brief Register a control task implemented by a plugin. It is used once it is added to the hierarchy with set_task_hierarchy().
+    /// @return The index of the control task.
+    /// @throws std::invalid_argument if the plugin is null, or if its name is empty or already used
+    int add_task_plugin(std::shared_ptr<TaskPlugin> plugin);
+
+    /// @brief Set the priority order of the control tasks, the weights of their rows and which ones are used, and compile them in the layouts of the tasks.
+    /// @details The disabled control tasks are removed from the hierarchy, together with the priorities that are left empty. The floating base equations of motion must be in the first priority. The previous hierarchy is kept if the new one is not valid.
+    /// @param[in] task_priorities indices of the control tasks of each priority, from the highest one. The control tasks that are not listed are not used.
+    /// @param[in] task_weights positive weight of the rows of each control task, indexed by control task
+    /// @param[in] enabled_tasks whether each control task is used, indexed by control task
+    /// @throws std::invalid_argument if the hierarchy is not valid
+    void set_task_hierarchy(
+        const std::vector<std::vector<int>>& task_priorities,
+        const std::vector<double>& task_weights,
+        const std::vector<bool>& enabled_tasks
+    );
 
     void set_tau_max(const double tau_max) {control_tasks.set_tau_max(tau_max);}
     void set_mu(const double mu) {control_tasks.set_mu(mu);}
@@ -142,31 +266,60 @@ public:
     void set_kc_v(const Eigen::Ref<const Eigen::Vector3d>& kc_v) {control_tasks.set_kc_v(kc_v);}
 
 private:
-    /// @brief 
-    std::pair<int,int> get_task_dimension(TasksNames task_name);
-
-    /// @brief Get the number of rows of the equality and inequality matrices (A and C) of a whole task of priority p (which may be composed by several elementary control tasks).
-    std::pair<int,int> get_prioritized_task_dimension(int priority);
-
-    /// @brief Compute the vector that specifies the priority for each control task.
-    void compute_prioritized_tasks_vector();
-
-    /// @brief List of TaskNames used to specify the priority of every task.
-    std::vector<TasksNames> prioritized_tasks_list = {
-        TasksNames::FloatingBaseEOM, TasksNames::ContactConstraints, TasksNames::SEPARATOR,
-        TasksNames::JointSingularities, TasksNames::SEPARATOR,
-        TasksNames::TorqueLimits, TasksNames::FrictionAndFcModulation, TasksNames::SEPARATOR,
-        TasksNames::LinearBaseMotionTracking, TasksNames::AngularBaseMotionTracking, TasksNames::SwingFeetMotionTracking, TasksNames::SEPARATOR,
-        TasksNames::EnergyAndForcesOptimization, TasksNames::SEPARATOR
+    /// @brief A registered control task.
+    struct RegisteredTask {
+        std::string name;
+        robot_wrapper::ModelQuantities model_quantities;    ///< @brief Kinematics and dynamics quantities used by the control task
+        std::shared_ptr<TaskPlugin> plugin;                 ///< @brief Null for the built-in control tasks
     };
 
+    /// @brief Get the number of rows of the equality and inequality matrices (A and C) of a control task, with nc feet in contact.
+    std::pair<int,int> get_task_dimension(int task, int nc);
+
+    /// @brief Compute the vector that specifies the priority of each control task (-1 if it is not used).
+    /// @throws std::invalid_argument if a control task is listed more than once, or is not registered
+    std::vector<int> compute_prioritized_tasks_vector(
+        const std::vector<std::vector<int>>& task_priorities,
+        const std::vector<bool>& enabled_tasks
+    ) const;
+
+    /// @brief Get the function that computes a built-in control task with the current contact constraint type.
+    TaskFunction get_task_function(TasksNames task_name) const;
+
+    /// @brief Compute the layout of the tasks for every number of feet in contact, with the current priorities and contact constraint type.
+    void compute_task_layouts();
+
+    /// @brief Compute the priority of each control task from the current hierarchy and formulation, and the quantities derived from it.
+    void compile_task_hierarchy();
+
+    /// @brief Set the kinematics and dynamics quantities computed by ControlTasks::reset() to the ones used by the enabled control tasks and by the computation of the torques.
+    void update_model_quantities();
+
+    /// @brief Registered control tasks: the built-in ones, in the order of TasksNames, followed by the plugins.
+    std::vector<RegisteredTask> tasks;
+
+    /// @brief Indices of the control tasks of each priority, from the highest one.
+    std::vector<std::vector<int>> task_priorities;
+
+    /// @brief Weight of the rows of each control task, indexed by control task.
+    std::vector<double> task_weights;
+
+    /// @brief Whether each control task is used, indexed by control task.
+    std::vector<bool> enabled_tasks;
+
     ControlTasks control_tasks;
 
     /// @brief Auxiliary vector that is used to compute the various tasks matrices.
     std::vector<int> tasks_vector;
 
+    /// @brief Layout of the tasks for each number of feet in contact. The dimensions of the tasks only depend on how many feet are in contact, and not on which ones.
+    std::vector<TaskLayout> task_layouts;
+
     /// @brief
     ContactConstraintType contact_constraint_type = ContactConstraintType::rigid;
+
+    /// @brief With the reduced formulation, floating_base_eom is removed from the hierarchy, since it is always satisfied.
+    FormulationType formulation_type = FormulationType::full;
 };
 
 } // namespace wbc
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "whole_body_controller/control_tasks.hpp"
+
+#include <Eigen/Core>
+
+#include <string>
+#include <utility>
+
+
+
+namespace wbc {
+
+struct GeneralizedPose;
+
+
+
+/* ========================================================================== */
+/*                              TASKPLUGIN CLASS                              */
+/* ========================================================================== */
+
+/// @class @brief Interface of the control tasks that are not built in PrioritizedTasks, e.g. the ones loaded with pluginlib from other packages.
+/// @details A control task writes its rows of the matrices A, b, C, d of its priority, whose columns are the ones of the optimization vector [v_dot, F_c, d_des].
+/// The rows are zero initialized, and their number is the one given by get_dimension().
+/// The kinematics and dynamics quantities of ControlTasks that the control tasks use (see get_model_quantities()) are computed once per cycle by ControlTasks::reset(), before any control task, hence the control tasks do not depend on each other.
+/// The plugins are called through a virtual function, while the built-in tasks are dispatched with plain function pointers.
+class TaskPlugin {
+public:
+    virtual ~TaskPlugin() = default;
+
+    /// @brief Get the name of the control task used in the parameters. It must be different from the names of the other control tasks.
+    virtual std::string get_name() const = 0;
+
+    /// @brief Get the number of rows of the matrices A (and b) and C (and d) of the control task.
+    /// @param[in] nv dimension of the generalized velocities vector
+    /// @param[in] nc number of feet in contact
+    /// @param[in] contact_constraint_type contact model, which sets the size of the deformations in the optimization vector
+    virtual std::pair<int,int> get_dimension(int nv, int nc, ContactConstraintType contact_constraint_type) const = 0;
+
+    /// @brief Get the kinematics and dynamics quantities of ControlTasks that the control task uses (e.g. ControlTasks::get_Jb()).
+    virtual robot_wrapper::ModelQuantities get_model_quantities() const {return robot_wrapper::ModelQuantities();}
+
+    /// @brief Compute the rows of the control task.
+    virtual void compute(
+        ControlTasks& control_tasks,
+        Eigen::Ref<Eigen::MatrixXd> A, Eigen::Ref<Eigen::VectorXd> b,
+        Eigen::Ref<Eigen::MatrixXd> C, Eigen::Ref<Eigen::VectorXd> d,
+        const GeneralizedPose& gen_pose,
+        const Eigen::VectorXd& d_k1, const Eigen::VectorXd& d_k2
+    ) = 0;
+};
+
+} // namespace wbc
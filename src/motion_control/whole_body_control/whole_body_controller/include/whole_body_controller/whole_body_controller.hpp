@@ -8,6 +8,10 @@
 
 namespace wbc {
 
+/* ========================================================================== */
+/*                          WHOLEBODYCONTROLLER CLASS                         */
+/* ========================================================================== */
+
 /// @class @brief 
 class WholeBodyController {
 public:
@@ -18,7 +22,8 @@ public:
     ///@param q 
     ///@param v 
     ///@param gen_pose 
-    void step(const Eigen::VectorXd& q, const Eigen::VectorXd& v, const GeneralizedPose& gen_pose);
+    ///@param time_budget time available for the step [s]. When it is not enough, the lowest priority tasks are not solved. A non-positive value disables the limit.
+    void step(const Eigen::VectorXd& q, const Eigen::VectorXd& v, const GeneralizedPose& gen_pose, double time_budget = 0);
 
     void reset(
         const Eigen::VectorXd& q, const Eigen::VectorXd& v,
@@ -60,6 +65,14 @@ public:
     /// @brief Get the dimension of the generalized velocities vector.
     int get_nv() const {return prioritized_tasks.get_nv();}
 
+    /// @brief Get the number of contact forces of the last step (3 times the number of feet in contact).
+    int get_nF() const {return prioritized_tasks.get_nF();}
+
+    /// @brief Get the mass matrix, the nonlinear terms and the contact Jacobian computed in the last step.
+    const Eigen::MatrixXd& get_M()  const {return prioritized_tasks.get_M();}
+    const Eigen::VectorXd& get_h()  const {return prioritized_tasks.get_h();}
+    const Eigen::MatrixXd& get_Jc() const {return prioritized_tasks.get_Jc();}
+
     /// @brief Get the mass of the robot. 
     double get_mass() const {return prioritized_tasks.get_mass();}
 
@@ -73,6 +86,21 @@ public:
 
     const Eigen::Vector3d& get_kp_terr() const {return prioritized_tasks.get_kp_terr();}
 
+    /// @brief Get the number of priorities solved in the last step. It is smaller than the number of tasks when the time budget was exhausted.
+    int get_solved_levels() const {return hierarchical_qp.get_solved_levels();}
+
+    /// @brief Get the indices of the control tasks of each priority, from the highest one.
+    const std::vector<std::vector<int>>& get_task_priorities() const {return prioritized_tasks.get_task_priorities();}
+
+    /// @brief Get the names of the registered control tasks, in the order of their indices.
+    std::vector<std::string> get_task_names() const {return prioritized_tasks.get_task_names();}
+
+    /// @brief Convert the priorities read from the parameters in the indices of the control tasks of each priority (see PrioritizedTasks::parse_task_priorities()).
+    std::vector<std::vector<int>> parse_task_priorities(const std::vector<std::string>& priorities) const {return prioritized_tasks.parse_task_priorities(priorities);}
+
+    /// @brief Get the counters of the solves of the hierarchical QP.
+    const hopt::SolverStats& get_solver_stats() const {return hierarchical_qp.get_solver_stats();}
+
 
     /* =============================== Setters ============================== */
 
@@ -94,8 +122,25 @@ public:
         } else {
             prioritized_tasks.set_contact_constraint_type(ContactConstraintType::invalid);
         }
+
+        reserve_hierarchical_qp();
     }
 
+    /// @brief Register a control task implemented by a plugin (see PrioritizedTasks::add_task_plugin()).
+    int add_task_plugin(std::shared_ptr<TaskPlugin> plugin) {return prioritized_tasks.add_task_plugin(std::move(plugin));}
+
+    /// @brief Set the priority order of the control tasks, the weights of their rows and which ones are used (see PrioritizedTasks::set_task_hierarchy()).
+    /// @details The hierarchical QP is resized for the new number of priorities. Its settings are kept, hence it can be called at any time.
+    /// @throws std::invalid_argument if the hierarchy is not valid. The previous one is kept.
+    void set_task_hierarchy(
+        const std::vector<std::vector<int>>& task_priorities,
+        const std::vector<double>& task_weights,
+        const std::vector<bool>& enabled_tasks);
+
+    /// @brief Set the optimization vector of the hierarchical problem. With the reduced formulation, the base accelerations are eliminated with the floating base equations of motion, and recovered after the hierarchy is solved.
+    /// @details The hierarchical QP is resized for the new problem. Its settings are kept, hence it can be called at any time.
+    void set_formulation_type(FormulationType formulation_type);
+
     void set_tau_max(const double tau_max) {prioritized_tasks.set_tau_max(tau_max);}
     void set_mu(const double mu) {prioritized_tasks.set_mu(mu);}
     void set_Fn_max(const double Fn_max) {prioritized_tasks.set_Fn_max(Fn_max);}
@@ -117,15 +162,41 @@ public:
 
     void set_regularization(double reg) {hierarchical_qp.set_regularization(reg);}
 
+    void set_null_space_mode(hopt::NullSpaceMode mode) {hierarchical_qp.set_null_space_mode(mode);}
+
+    void set_warm_start(bool warm_start) {hierarchical_qp.set_warm_start(warm_start);}
+
+    void set_constraint_pruning(bool constraint_pruning) {hierarchical_qp.set_constraint_pruning(constraint_pruning);}
+
+    void set_qp_backend(hopt::QPBackendType type) {hierarchical_qp.set_qp_backend(type);}
+
+    /// @brief Set the buffer in which the diagnostics of each priority are written. nullptr disables them.
+    void set_diagnostics_buffer(std::shared_ptr<hopt::DiagnosticsBuffer> buffer) {hierarchical_qp.set_diagnostics_buffer(std::move(buffer));}
+
+    /// @brief Set the recorder of the hierarchical problems that fail, overrun, or are requested. nullptr disables it.
+    void set_problem_capture(std::shared_ptr<hopt::ProblemCapture> capture) {hierarchical_qp.set_problem_capture(std::move(capture));}
+
 private:
     void compute_torques();
 
+    /// @brief Preallocate the memory of the hierarchical QP, and the buffers of the tasks, for the largest problem that can be generated with the current contact constraint type.
+    void reserve_hierarchical_qp();
+
+    /// @brief Resize the hierarchical QP for the current number of priorities, keeping its settings, and preallocate it.
+    void rebuild_hierarchical_qp();
+
     PrioritizedTasks prioritized_tasks;
 
     DeformationsHistoryManager deformations_history_manager;
 
     hopt::HierarchicalQP hierarchical_qp;
 
+    /// @brief Buffers in which the task of each priority is assembled, sized for the largest one by reserve_hierarchical_qp().
+    Eigen::MatrixXd task_A;
+    Eigen::VectorXd task_b;
+    Eigen::MatrixXd task_C;
+    Eigen::VectorXd task_d;
+
     Eigen::VectorXd x_opt;      /// @brief Optimal value of the optimization vector
 
     Eigen::VectorXd tau_opt;    /// @brief Optimal joint torques
@@ -2,7 +2,12 @@
 
 #include "robot_model/robot_model.hpp"
 
+#include <Eigen/Cholesky>
 #include <Eigen/Geometry>
+#include <Eigen/LU>
+
+#include <stdexcept>
+#include <string>
 
 
 
@@ -39,7 +44,29 @@ ControlTasks::ControlTasks(const std::string& robot_name, float dt)
 : robot_model(robot_name),
   nv(robot_model.get_model().nv),
   dt(dt)
-{}
+{
+    const auto& model = robot_model.get_model();
+    const auto& feet_ids = robot_model.get_feet_ids();
+
+    // The joints of a leg are the joints that support its foot, except the universe and the floating base (the first 6 columns).
+    for (int k = 0; k < 4; k++) {
+        const auto& supports = model.supports[model.frames[feet_ids[k]].parent];
+
+        for (std::size_t j = 1; j < supports.size(); j++) {
+            const auto& joint = model.joints[supports[j]];
+
+            for (int col = joint.idx_v(); col < joint.idx_v() + joint.nv(); col++) {
+                if (col >= 6) {
+                    leg_columns[k].push_back(col);
+                }
+            }
+        }
+
+        if (static_cast<int>(leg_columns[k].size()) > max_leg_joints) {
+            throw std::invalid_argument("A leg of '" + robot_name + "' has more than " + std::to_string(max_leg_joints) + " actuated joints.");
+        }
+    }
+}
 
 
 /* ================================== reset ================================= */
@@ -54,7 +81,8 @@ void ControlTasks::reset(
 
     robot_model.set_feet_names(contact_feet_names);
 
-    robot_model.compute_EOM(q, v);
+    // Compute only the kinematics and dynamics quantities used by the control tasks, once per cycle.
+    robot_model.compute(q, v, model_quantities);
 
     nc = static_cast<int>(contact_feet_names.size());
     nF = 3 * nc;
@@ -68,10 +96,134 @@ void ControlTasks::reset(
     }
     
 
-    // Initialize these matrices with all zeros (required by Pinocchio library)
-    Jc = Eigen::MatrixXd::Zero(3*nc, nv);
-    Jb = Eigen::MatrixXd::Zero(6, nv);
-    Jb_dot_times_v = Eigen::VectorXd::Zero(6);
+    // The getters of RobotModel fill all the rows of these matrices and vectors.
+    if (model_quantities.M) {
+        M = robot_model.get_data().M;
+    }
+    if (model_quantities.h) {
+        h = robot_model.get_data().nle;
+    }
+    if (model_quantities.Jc) {
+        Jc.resize(nF, nv);
+        robot_model.get_Jc(Jc);
+    }
+    if (model_quantities.Jc_dot_times_v) {
+        Jc_dot_times_v.resize(nF);
+        robot_model.get_Jc_dot_times_v(Jc_dot_times_v);
+    }
+    if (model_quantities.Jb) {
+        Jb.resize(6, nv);
+        robot_model.get_Jb(Jb);
+    }
+    if (model_quantities.Jb_dot_times_v) {
+        Jb_dot_times_v.resize(6);
+        robot_model.get_Jb_dot_times_v(Jb_dot_times_v);
+    }
+    if (model_quantities.Js) {
+        Js.resize(4*3-nF, nv);
+        robot_model.get_Js(Js);
+    }
+    if (model_quantities.Js_dot_times_v) {
+        Js_dot_times_v.resize(4*3-nF);
+        robot_model.get_Js_dot_times_v(Js_dot_times_v);
+    }
+
+    // The torque map is shared by all the quantities that depend on the joint torques.
+    if (model_quantities.M && model_quantities.h && model_quantities.Jc) {
+        torque_map.A.resize(nv-6, nv+nF);
+        torque_map.A.leftCols(nv) = M.bottomRows(nv-6);
+        torque_map.A.rightCols(nF) = - Jc.rightCols(nv-6).transpose();
+        torque_map.h_a = h.tail(nv-6);
+    }
+
+    if (formulation_type == FormulationType::reduced) {
+        // M_bb is symmetric and positive definite.
+        const Eigen::LLT<Eigen::Matrix<double, 6, 6>> M_bb_llt(M.topLeftCorner<6,6>());
+
+        base_elimination.T_b.resize(6, nv-6+nF);
+        base_elimination.T_b.leftCols(nv-6) = - M.topRightCorner(6, nv-6);
+        base_elimination.T_b.rightCols(nF) = Jc.leftCols<6>().transpose();
+        M_bb_llt.solveInPlace(base_elimination.T_b);
+
+        base_elimination.t_b = - M_bb_llt.solve(h.head<6>());
+    }
+
+    if (constant_blocks.nc != nc) {
+        update_constant_blocks();
+    }
+}
+
+
+/* ============================== Reduce_task =============================== */
+
+void ControlTasks::reduce_task(Eigen::Ref<Eigen::MatrixXd> A, Eigen::Ref<Eigen::VectorXd> b) const
+{
+    // A x = A_b u_dot_b + A_y y = (A_y + A_b T_b) y + A_b t_b
+
+    const auto& T_b = base_elimination.T_b;
+
+    b.noalias() -= A.leftCols<6>() * base_elimination.t_b;
+    A.middleCols(6, T_b.cols()).noalias() += A.leftCols<6>() * T_b;
+}
+
+
+/* ========================= Update_constant_blocks ========================= */
+
+void ControlTasks::update_constant_blocks()
+{
+    using namespace Eigen;
+
+    // For example, with nc = 3:
+    //      [ 1 0 0 0 0 0 0 0 0 ]
+    // he = [ 0 0 0 1 0 0 0 0 0 ]   ∈ nc x (3 nc)
+    //      [ 0 0 0 0 0 0 1 0 0 ]
+
+    MatrixXd he = MatrixXd::Zero(nc, nF);
+    MatrixXd la = MatrixXd::Zero(nc, nF);
+    MatrixXd  n = MatrixXd::Zero(nc, nF);
+
+    for (int i = 0; i < nc; i++) {
+        he.block(i, 3*i, 1, 3) << 1, 0, 0;
+        la.block(i, 3*i, 1, 3) << 0, 1, 0;
+         n.block(i, 3*i, 1, 3) << 0, 0, 1;
+    }
+
+    //              [ + he - mu*n ]
+    //              | - he - mu*n |
+    // C_friction = | + la - mu*n |   ∈ 6(nc) x nF
+    //              | - la - mu*n |
+    //              | + n         |
+    //              [ - n         ]
+
+    //              [   0      ]
+    //              |   0      |
+    // d_friction = |   0      |
+    //              |   0      |
+    //              |   Fn_max |
+    //              [ - Fn_min ]
+
+    constant_blocks.C_friction.resize(6*nc, nF);
+    constant_blocks.C_friction <<   he - mu * n,
+                                  - he - mu * n,
+                                    la - mu * n,
+                                  - la - mu * n,
+                                    n,
+                                  - n;
+
+    constant_blocks.d_friction = VectorXd::Zero(6*nc);
+    constant_blocks.d_friction.segment(4*nc, nc).setConstant(Fn_max);
+    constant_blocks.d_friction.segment(5*nc, nc).setConstant(- Fn_min);
+
+    constant_blocks.S_n = n;
+
+    constant_blocks.kp_terr = tile(kp_terr, nc);
+    constant_blocks.kd_terr = tile(kd_terr, nc);
+    constant_blocks.kc_v = tile(kc_v, nc);
+
+    constant_blocks.kp_s_pos = tile(kp_s_pos, 4-nc);
+    constant_blocks.kd_s_pos = tile(kd_s_pos, 4-nc);
+
+    constant_blocks.nc = nc;
 }
 
 /* ========================================================================== */
@@ -96,12 +248,6 @@ using namespace Eigen;
 
 void ControlTasks::task_floating_base_eom(Ref<MatrixXd> A, Ref<VectorXd> b)
 {
-    // Get the EOM quantities
-    M = robot_model.get_data().M;
-    h = robot_model.get_data().nle;
-
-    robot_model.get_Jc(Jc);
-    
     // A = [ M_u, - Jc_u.T, 0 ];   ∈ 6 x (nv+nF+nd) ]   ∈ 6 x (nv+nF+nd)
     // b = - h_u
 
@@ -114,21 +260,19 @@ void ControlTasks::task_floating_base_eom(Ref<MatrixXd> A, Ref<VectorXd> b)
 
 /* =========================== Task_torque_limits =========================== */
 
-void ControlTasks::task_torque_limits(Ref<MatrixXd> C, Ref<VectorXd> d)
+void ControlTasks::task_torque_limits(Ref<MatrixXd> C, Ref<VectorXd> d) const
 {
     // C = [   M_a, - Jc_a.T, 0 ]
     //     [ - M_a,   Jc_a.T, 0 ]   ∈ 2(nv-6) x (nv+nF+nd)
     // d = [   tau_max - h_a ]
     //     [ - tau_min + h_a ]
 
-    C.topLeftCorner(nv-6, nv) = M.bottomRows(nv-6);
-    C.block(0, nv, nv-6, nF) = - Jc.rightCols(nv-6).transpose();
+    // Both the rows are written directly from the torque map, without temporaries.
+    C.topLeftCorner(nv-6, nv+nF) = torque_map.A;
+    C.block(nv-6, 0, nv-6, nv+nF) = - torque_map.A;
 
-    d.head(nv-6) = VectorXd::Ones(nv-6) * tau_max - h.tail(nv-6);
-
-    C.bottomRows(nv-6) = - C.topRows(nv-6);
-    // d.bottomRows(nv-6) = - d.topRows(nv-6);
-    d.tail(nv-6) = VectorXd::Ones(nv-6) * tau_max + h.tail(nv-6);
+    d.head(nv-6) = VectorXd::Constant(nv-6, tau_max) - torque_map.h_a;
+    d.tail(nv-6) = VectorXd::Constant(nv-6, tau_max) + torque_map.h_a;
 }
 
 
@@ -136,22 +280,6 @@ void ControlTasks::task_torque_limits(Ref<MatrixXd> C, Ref<VectorXd> d)
 
 void ControlTasks::task_friction_Fc_modulation(Ref<MatrixXd> C, Ref<VectorXd> d) const
 {
-    // For example, with nc = 3:
-    //      [ 1 0 0 0 0 0 0 0 0 ]
-    // he = [ 0 0 0 1 0 0 0 0 0 ]   ∈ nc x (3 nc)
-    //      [ 0 0 0 0 0 0 1 0 0 ]
-
-    MatrixXd he = MatrixXd::Zero(nc, nF);
-    MatrixXd la = MatrixXd::Zero(nc, nF);
-    MatrixXd  n = MatrixXd::Zero(nc, nF);
-
-    for (int i = 0; i < nc; i++) {
-        he.block(i, 3*i, 1, 3) << 1, 0, 0;
-        la.block(i, 3*i, 1, 3) << 0, 1, 0;
-         n.block(i, 3*i, 1, 3) << 0, 0, 1;
-    }
-
-
     //     [ 0_(nc, nv), + he - mu*n, 0_(nc, nf) ]
     //     | 0,          - he - mu*n, 0          |
     // C = | 0,          + la - mu*n, 0          |   ∈ 6(nc) x (nv+nF+nd)
@@ -166,17 +294,9 @@ void ControlTasks::task_friction_Fc_modulation(Ref<MatrixXd> C, Ref<VectorXd> d)
     //     |   Fn_max |
     //     [ - Fn_min ]
 
-    C.block(   0, nv, nc, nF) =   he - mu * n;
-    C.block(  nc, nv, nc, nF) = - he - mu * n;
-    C.block(2*nc, nv, nc, nF) =   la - mu * n;
-    C.block(3*nc, nv, nc, nF) = - la - mu * n;
-
-    C.block(4*nc, nv, nc, nF) =   n;
-    C.block(5*nc, nv, nc, nF) = - n;
-
-
-    d.segment(4*nc, nc) =   Fn_max * VectorXd::Ones(nc);
-    d.segment(5*nc, nc) = - Fn_min * VectorXd::Ones(nc);
+    // The blocks only change with the parameters and the number of feet in contact (see update_constant_blocks()).
+    C.middleCols(nv, nF) = constant_blocks.C_friction;
+    d = constant_blocks.d_friction;
 }
 
 
@@ -186,11 +306,6 @@ void ControlTasks::task_linear_motion_tracking(
     Ref<MatrixXd> A, Ref<VectorXd> b,
     const Vector3d& r_b_ddot_des, const Vector3d& r_b_dot_des, const Vector3d& r_b_des
 ) {
-    // Compute the second order kinematics
-    robot_model.compute_second_order_FK(q, v);
-    robot_model.get_Jb(Jb);
-    robot_model.get_Jb_dot_times_v(Jb_dot_times_v);
-
     // A = [ Jb_pos, 0, 0 ]   ∈ 3 x (nv+nF+nd)
 
     A.leftCols(nv) = Jb.topRows(3);
@@ -230,20 +345,18 @@ void ControlTasks::task_swing_feet_tracking(
     Ref<MatrixXd> A, Ref<VectorXd> b,
     const VectorXd& r_s_ddot_des, const VectorXd& r_s_dot_des, const VectorXd& r_s_des
 ) {
-    MatrixXd Js = MatrixXd::Zero(4*3-nF, nv);
-    robot_model.get_Js(Js);
-
-    VectorXd Js_dot_times_v = VectorXd::Zero(4*3-nF);
-    robot_model.get_Js_dot_times_v(Js_dot_times_v);
-
-    VectorXd r_s = VectorXd::Zero(4*3-nF);
+    // At most four feet are in swing phase, hence r_s does not need the heap.
+    Matrix<double, Dynamic, 1, 0, 4*3, 1> r_s(4*3-nF);
     robot_model.get_r_s(r_s);
 
     A.leftCols(nv) = Js;
 
+    // The swing feet velocities are stored in b first, so that the expression below does not need a temporary.
+    b.noalias() = - Js * v;
+
     b =   r_s_ddot_des 
-        + tile(kd_s_pos, 4-nc).asDiagonal() * (r_s_dot_des - Js * v)
-        + tile(kp_s_pos, 4-nc).asDiagonal() * (r_s_des - r_s)
+        + constant_blocks.kd_s_pos.asDiagonal() * (r_s_dot_des + b)
+        + constant_blocks.kp_s_pos.asDiagonal() * (r_s_des - r_s)
         - Js_dot_times_v;
 }
 
@@ -263,32 +376,28 @@ void ControlTasks::task_contact_constraints_soft_kv(
     // b = [ - Kd d_k1 / dt ]                           soft contact constraint 
     //     [ - Jc_dot * v + 2 d_k1/dt^2 - d_k2/dt^2 ]   - deformation_ddot = contact_point_acceleration
 
-    MatrixXd Kp = tile(kp_terr, nc).asDiagonal();
-    MatrixXd Kd = tile(kd_terr, nc).asDiagonal();
-    MatrixXd Kc_v = tile(kc_v, nc).asDiagonal();
+    // Diagonals of Kp, Kd, and Kc_v.
+    const VectorXd& Kp = constant_blocks.kp_terr;
+    const VectorXd& Kd = constant_blocks.kd_terr;
+    const VectorXd& Kc_v = constant_blocks.kc_v;
 
     A.block( 0,    nv, nF, nF) = MatrixXd::Identity(nF, nF);
-    A.block( 0, nv+nF, nd, nd) = - Kp - Kd / dt;
+    A.block( 0, nv+nF, nd, nd) = (- Kp - Kd / dt).asDiagonal();
     A.bottomLeftCorner(nF, nv) = Jc;
     A.block(nF, nv+nF, nd, nd) = MatrixXd::Identity(nd, nd) / (dt*dt);
 
-    VectorXd Jc_dot_times_v = VectorXd::Zero(nF);
-    robot_model.get_Jc_dot_times_v(Jc_dot_times_v);
-
-    b.head(nF) = - Kd * d_k1 / dt;
-    b.tail(nF) = - Jc_dot_times_v + 2 * d_k1 / (dt*dt) - d_k2 / (dt*dt) - Kc_v * Jc * v;
+    b.head(nF) = - Kd.cwiseProduct(d_k1) / dt;
+    // The contact points velocities are stored in b first, so that the expression below does not need a temporary.
+    b.tail(nF).noalias() = Jc * v;
+    b.tail(nF) = - Jc_dot_times_v + 2 * d_k1 / (dt*dt) - d_k2 / (dt*dt) - Kc_v.cwiseProduct(b.tail(nF));
 
 
     // C = [ ... ]   ∈ 2*nc x (nv+nF+nd)
     // d = [ ... ]
 
-    MatrixXd C_temp = MatrixXd::Zero(nc, nd);
-    for (int i=0; i<nc; i++) {
-        C_temp(i, 2+3*i) = 1;
-    }
-
-    C.block( 0, nv+nF, nc, nd) = - C_temp;
-    C.block(nc,    nv, nc, nF) = - C_temp;
+    // S_n selects the normal components of the deformations and of the contact forces.
+    C.block( 0, nv+nF, nc, nd) = - constant_blocks.S_n;
+    C.block(nc,    nv, nc, nF) = - constant_blocks.S_n;
 }
 
 
@@ -323,30 +432,51 @@ void ControlTasks::task_joint_singularities(Eigen::Ref<Eigen::MatrixXd> C, Eigen
 
 /* ===================== task_contact_constraints_rigid ===================== */
 
-void ControlTasks::task_contact_constraints_rigid(Ref<MatrixXd> A, Ref<VectorXd> b)
+void ControlTasks::task_contact_constraints_rigid(Ref<MatrixXd> A, Ref<VectorXd> b) const
 {
     // A = [ Jc, 0 ]
     // b = [ - Jc_dot_times_v ]
 
-    MatrixXd Kc_v = tile(kc_v, nc).asDiagonal();
-
-    VectorXd Jc_dot_times_v = VectorXd::Zero(nF);
-    robot_model.get_Jc_dot_times_v(Jc_dot_times_v);
+    const VectorXd& Kc_v = constant_blocks.kc_v;   // Diagonal of Kc_v
 
     // In case of a singular jacobian, reduce the contact constraint and add a
     // null force constraint.
+    // Jc_a^T has a n_leg x 3 block for each leg in contact (n_leg actuated joints), hence
+    // the rank and the kernel are computed leg by leg, and each leg fills its three rows.
+
+    const std::vector<int>& contact_legs = robot_model.get_contact_feet();
+
+    for (int i = 0; i < nc; i++) {
+        const auto& columns = leg_columns[contact_legs[i]];
+
+        const int n_leg = static_cast<int>(columns.size());
+
+        Eigen::Matrix<double, Eigen::Dynamic, 3, 0, max_leg_joints, 3> Jc_leg_T(n_leg, 3);
+
+        for (int j = 0; j < n_leg; j++) {
+            Jc_leg_T.row(j) = Jc.block<3,1>(3*i, columns[j]).transpose();
+        }
+
+        Eigen::FullPivLU<decltype(Jc_leg_T)> lu_decomp(Jc_leg_T);
+        lu_decomp.setThreshold(1e-1);
+        const int rank = static_cast<int>(lu_decomp.rank());
 
-    Eigen::FullPivLU<Eigen::MatrixXd> lu_decomp(Jc.rightCols(nv-6).transpose());
-    lu_decomp.setThreshold(1e-1);
-    auto rank = lu_decomp.rank();
+        // Rows of Jc of the independent contact directions.
+        const auto& Q = lu_decomp.permutationQ().indices();
 
-    Eigen::MatrixXd P = lu_decomp.permutationP();
-    Eigen::MatrixXd Q = lu_decomp.permutationQ();
+        for (int k = 0; k < rank; k++) {
+            const int row = 3*i + Q(k);
 
-    A.topLeftCorner(rank, nv) = Q.leftCols(rank).transpose() * Jc;
-    A.block(rank, nv, Jc.rows() - rank, nF) = lu_decomp.kernel().transpose();
+            A.row(3*i + k).head(nv) = Jc.row(row);
+            b(3*i + k) = - Jc_dot_times_v(row) - Kc_v(row) * Jc.row(row).dot(v);
+        }
+
+        if (rank < 3) {
+            const Eigen::Matrix<double, 3, Eigen::Dynamic, 0, 3, 3> kernel = lu_decomp.kernel();
 
-    b.head(rank) = Q.leftCols(rank).transpose() * (- Jc_dot_times_v - Kc_v * Jc * v);
+            A.block(3*i + rank, nv + 3*i, 3 - rank, 3) = kernel.transpose();
+        }
+    }
 }
 
 
@@ -418,25 +548,24 @@ void ControlTasks::task_contact_constraints_soft_sim(
     // b = [ - Kd d_k1 / dt ]                           soft contact constraint 
     //     [ - Jc_dot * v + 2 d_k1/dt^2 - d_k2/dt^2 ]   - deformation_ddot = contact_point_acceleration
 
-    MatrixXd C_temp = MatrixXd::Zero(nd, nF);
-    for (int i=0; i<nc; i++) {
-        C_temp(i, 2+3*i) = 1;
-    }
+    // S_n selects the normal components of the contact forces (nd = nc).
+    const MatrixXd& C_temp = constant_blocks.S_n;
 
-    MatrixXd Kp = kp_terr(2) * MatrixXd::Identity(nc, nc);
-    MatrixXd Kd = kd_terr(2) * MatrixXd::Identity(nc, nc);
-    MatrixXd Kc_v = tile(kc_v, nc).asDiagonal();
+    // Kp and Kd are kp_terr(2) and kd_terr(2) times the identity, Kc_v is diagonal.
+    const double Kp = kp_terr(2);
+    const double Kd = kd_terr(2);
+    const VectorXd& Kc_v = constant_blocks.kc_v;
 
     A.block( 0,    nv, nd, nF) = C_temp;
-    A.block( 0, nv+nF, nd, nd) = - Kp - Kd / dt;
+    A.block( 0, nv+nF, nd, nd) = - (Kp + Kd / dt) * MatrixXd::Identity(nd, nd);
     A.bottomLeftCorner(nF, nv) = Jc;
     A.block(nd, nv+nF, nF, nd) = C_temp.transpose() / (dt*dt);
 
-    VectorXd Jc_dot_times_v = VectorXd::Zero(nF);
-    robot_model.get_Jc_dot_times_v(Jc_dot_times_v);
-
     b.head(nd) = - Kd * d_k1 / dt;
-    b.tail(nF) = - Jc_dot_times_v + C_temp.transpose() * (2 * d_k1 / (dt*dt) - d_k2 / (dt*dt)) - Kc_v * Jc * v;
+    b.tail(nF).noalias() = Jc * v;
+    b.tail(nF) = - Jc_dot_times_v - Kc_v.cwiseProduct(b.tail(nF));
+    b.tail(nF).noalias() += 2 / (dt*dt) * C_temp.transpose() * d_k1;
+    b.tail(nF).noalias() -= 1 / (dt*dt) * C_temp.transpose() * d_k2;
 
 
     // c = [ ... ]   ∈ 2*nc x (nv+nF+nd)
@@ -462,12 +591,11 @@ void ControlTasks::task_energy_forces_minimization(Ref<MatrixXd> A, Ref<VectorXd
     // b = [   0   ]
     //     [   0   ]
 
-    A.topLeftCorner(nv-6, nv) = M.bottomRows(nv-6);
-    A.block(0, nv, nv-6, nF) = - Jc.rightCols(nv-6).transpose();
+    A.topLeftCorner(nv-6, nv+nF) = torque_map.A;
     A.block(nv-6, nv, nF, nF) = MatrixXd::Identity(nF, nF);
     A.bottomRightCorner(nd, nd) = MatrixXd::Identity(nd, nd);
 
-    b.topRows(nv-6) = - h.bottomRows(nv-6);
+    b.topRows(nv-6) = - torque_map.h_a;
 }
 
 
@@ -1,13 +1,171 @@
 #include "whole_body_controller/prioritized_tasks.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
 
 
 namespace wbc {
 
+namespace {
+
+using Eigen::MatrixXd;
+using Eigen::Ref;
+using Eigen::VectorXd;
+
+/// @brief A built-in control task: its name used in the parameters, and the kinematics and dynamics quantities of ControlTasks that it uses.
+struct BuiltinTask {
+    const char* name;
+    robot_wrapper::ModelQuantities model_quantities;
+};
+
+/// @brief Static registration of the built-in control tasks, in the order of TasksNames.
+const BuiltinTask builtin_tasks[] = {
+    // name                              M      h      Jc     Jc_dot_v Jb     Jb_dot_v Js     Js_dot_v
+    {"floating_base_eom",               {true,  true,  true,  false,   false, false,   false, false}},
+    {"torque_limits",                   {true,  true,  true,  false,   false, false,   false, false}},
+    {"friction_and_fc_modulation",      {false, false, false, false,   false, false,   false, false}},
+    {"linear_base_motion_tracking",     {false, false, false, false,   true,  true,    false, false}},
+    {"angular_base_motion_tracking",    {false, false, false, false,   true,  true,    false, false}},
+    {"swing_feet_motion_tracking",      {false, false, false, false,   false, false,   true,  true }},
+    {"contact_constraints",             {false, false, true,  true,    false, false,   false, false}},
+    {"energy_and_forces_optimization",  {true,  true,  true,  false,   false, false,   false, false}},
+    {"joint_singularities",             {false, false, false, false,   false, false,   false, false}},
+};
+
+static_assert(
+    sizeof(builtin_tasks) / sizeof(builtin_tasks[0]) == static_cast<std::size_t>(TasksNames::SEPARATOR),
+    "builtin_tasks must contain every control task of TasksNames"
+);
+
+/// @brief Get the default priorities of the control tasks.
+std::vector<std::vector<int>> default_task_priorities()
+{
+    const std::vector<std::vector<TasksNames>> priorities = {
+        {TasksNames::FloatingBaseEOM, TasksNames::ContactConstraints},
+        {TasksNames::JointSingularities},
+        {TasksNames::TorqueLimits, TasksNames::FrictionAndFcModulation},
+        {TasksNames::LinearBaseMotionTracking, TasksNames::AngularBaseMotionTracking, TasksNames::SwingFeetMotionTracking},
+        {TasksNames::EnergyAndForcesOptimization},
+    };
+
+    std::vector<std::vector<int>> task_priorities;
+
+    for (const auto& priority : priorities) {
+        task_priorities.emplace_back();
+
+        for (TasksNames task_name : priority) {
+            task_priorities.back().push_back(static_cast<int>(task_name));
+        }
+    }
+
+    return task_priorities;
+}
+
+/* The functions of the dispatch table. They all have the signature of TaskFunction, and receive the rows of their control task. */
+
+void task_floating_base_eom(
+    ControlTasks& control_tasks, Ref<MatrixXd> A, Ref<VectorXd> b, Ref<MatrixXd> /*C*/, Ref<VectorXd> /*d*/,
+    const GeneralizedPose& /*gen_pose*/, const VectorXd& /*d_k1*/, const VectorXd& /*d_k2*/)
+{
+    control_tasks.task_floating_base_eom(A, b);
+}
+
+void task_torque_limits(
+    ControlTasks& control_tasks, Ref<MatrixXd> /*A*/, Ref<VectorXd> /*b*/, Ref<MatrixXd> C, Ref<VectorXd> d,
+    const GeneralizedPose& /*gen_pose*/, const VectorXd& /*d_k1*/, const VectorXd& /*d_k2*/)
+{
+    control_tasks.task_torque_limits(C, d);
+}
+
+void task_friction_Fc_modulation(
+    ControlTasks& control_tasks, Ref<MatrixXd> /*A*/, Ref<VectorXd> /*b*/, Ref<MatrixXd> C, Ref<VectorXd> d,
+    const GeneralizedPose& /*gen_pose*/, const VectorXd& /*d_k1*/, const VectorXd& /*d_k2*/)
+{
+    control_tasks.task_friction_Fc_modulation(C, d);
+}
+
+void task_linear_motion_tracking(
+    ControlTasks& control_tasks, Ref<MatrixXd> A, Ref<VectorXd> b, Ref<MatrixXd> /*C*/, Ref<VectorXd> /*d*/,
+    const GeneralizedPose& gen_pose, const VectorXd& /*d_k1*/, const VectorXd& /*d_k2*/)
+{
+    control_tasks.task_linear_motion_tracking(A, b, gen_pose.base_acc, gen_pose.base_vel, gen_pose.base_pos);
+}
+
+void task_angular_motion_tracking(
+    ControlTasks& control_tasks, Ref<MatrixXd> A, Ref<VectorXd> b, Ref<MatrixXd> /*C*/, Ref<VectorXd> /*d*/,
+    const GeneralizedPose& gen_pose, const VectorXd& /*d_k1*/, const VectorXd& /*d_k2*/)
+{
+    control_tasks.task_angular_motion_tracking(A, b, gen_pose.base_angvel, gen_pose.base_quat);
+}
+
+void task_swing_feet_tracking(
+    ControlTasks& control_tasks, Ref<MatrixXd> A, Ref<VectorXd> b, Ref<MatrixXd> /*C*/, Ref<VectorXd> /*d*/,
+    const GeneralizedPose& gen_pose, const VectorXd& /*d_k1*/, const VectorXd& /*d_k2*/)
+{
+    control_tasks.task_swing_feet_tracking(A, b, gen_pose.feet_acc, gen_pose.feet_vel, gen_pose.feet_pos);
+}
+
+void task_contact_constraints_soft_kv(
+    ControlTasks& control_tasks, Ref<MatrixXd> A, Ref<VectorXd> b, Ref<MatrixXd> C, Ref<VectorXd> d,
+    const GeneralizedPose& /*gen_pose*/, const VectorXd& d_k1, const VectorXd& d_k2)
+{
+    control_tasks.task_contact_constraints_soft_kv(A, b, C, d, d_k1, d_k2);
+}
+
+void task_contact_constraints_soft_sim(
+    ControlTasks& control_tasks, Ref<MatrixXd> A, Ref<VectorXd> b, Ref<MatrixXd> C, Ref<VectorXd> d,
+    const GeneralizedPose& /*gen_pose*/, const VectorXd& d_k1, const VectorXd& d_k2)
+{
+    control_tasks.task_contact_constraints_soft_sim(A, b, C, d, d_k1, d_k2);
+}
+
+void task_contact_constraints_rigid(
+    ControlTasks& control_tasks, Ref<MatrixXd> A, Ref<VectorXd> b, Ref<MatrixXd> /*C*/, Ref<VectorXd> /*d*/,
+    const GeneralizedPose& /*gen_pose*/, const VectorXd& /*d_k1*/, const VectorXd& /*d_k2*/)
+{
+    control_tasks.task_contact_constraints_rigid(A, b);
+}
+
+void task_joint_singularities(
+    ControlTasks& control_tasks, Ref<MatrixXd> /*A*/, Ref<VectorXd> /*b*/, Ref<MatrixXd> C, Ref<VectorXd> d,
+    const GeneralizedPose& /*gen_pose*/, const VectorXd& /*d_k1*/, const VectorXd& /*d_k2*/)
+{
+    control_tasks.task_joint_singularities(C, d);
+}
+
+void task_energy_forces_minimization(
+    ControlTasks& control_tasks, Ref<MatrixXd> A, Ref<VectorXd> b, Ref<MatrixXd> /*C*/, Ref<VectorXd> /*d*/,
+    const GeneralizedPose& /*gen_pose*/, const VectorXd& /*d_k1*/, const VectorXd& /*d_k2*/)
+{
+    control_tasks.task_energy_forces_minimization(A, b);
+}
+
+/// @brief Used for the control tasks without rows, e.g. the contact constraints with an invalid contact constraint type.
+void task_empty(
+    ControlTasks& /*control_tasks*/, Ref<MatrixXd> /*A*/, Ref<VectorXd> /*b*/, Ref<MatrixXd> /*C*/, Ref<VectorXd> /*d*/,
+    const GeneralizedPose& /*gen_pose*/, const VectorXd& /*d_k1*/, const VectorXd& /*d_k2*/)
+{
+}
+
+} // namespace
+
+
+
 PrioritizedTasks::PrioritizedTasks(const std::string& robot_name, float dt)
 : control_tasks(robot_name, dt)
 {
-    compute_prioritized_tasks_vector();
+    for (const BuiltinTask& builtin_task : builtin_tasks) {
+        tasks.push_back({builtin_task.name, builtin_task.model_quantities, nullptr});
+    }
+
+    task_priorities = default_task_priorities();
+    task_weights.assign(tasks.size(), 1.);
+    enabled_tasks.assign(tasks.size(), true);
+
+    compile_task_hierarchy();
 }
 
 void PrioritizedTasks::reset(
@@ -24,112 +182,83 @@ void PrioritizedTasks::compute_task_p(
     const GeneralizedPose& gen_pose,
     const Eigen::VectorXd& d_k1, const Eigen::VectorXd& d_k2
 ) {
-    std::pair<int,int> task_rows = get_prioritized_task_dimension(priority);
+    const TaskLayout& layout = get_task_layout();
+
+    A.resize(layout.eq_rows[priority], layout.cols);
+    b.resize(layout.eq_rows[priority]);
+
+    C.resize(layout.ineq_rows[priority], layout.cols);
+    d.resize(layout.ineq_rows[priority]);
 
-    int cols = control_tasks.get_nv() + control_tasks.get_nF() + control_tasks.get_nd();
+    compute_task_p(
+        priority,
+        Eigen::Ref<Eigen::MatrixXd>(A), Eigen::Ref<Eigen::VectorXd>(b),
+        Eigen::Ref<Eigen::MatrixXd>(C), Eigen::Ref<Eigen::VectorXd>(d),
+        gen_pose, d_k1, d_k2
+    );
+}
 
-    A.resize(task_rows.first, cols);
+void PrioritizedTasks::compute_task_p(
+    int priority,
+    Eigen::Ref<Eigen::MatrixXd> A, Eigen::Ref<Eigen::VectorXd> b,
+    Eigen::Ref<Eigen::MatrixXd> C, Eigen::Ref<Eigen::VectorXd> d,
+    const GeneralizedPose& gen_pose,
+    const Eigen::VectorXd& d_k1, const Eigen::VectorXd& d_k2
+) {
     A.setZero();
-    b.resize(task_rows.first);
     b.setZero();
-
-    C.resize(task_rows.second, cols);
     C.setZero();
-    d.resize(task_rows.second);
     d.setZero();
 
-    int ne = 0;
-    int ni = 0;
-
-    int ne_temp = 0;
-    int ni_temp = 0;
-
-    for (int i = 0; i < static_cast<int>(tasks_vector.size()); i++) {
-        if (tasks_vector[i] == priority) {
-                        auto n_temp = get_task_dimension(static_cast<TasksNames>(i));
-            ne_temp = n_temp.first;     // number of rows of the equality control task
-            ni_temp = n_temp.second;    // number of rows of the inequality control task
-
-            switch (static_cast<TasksNames>(i))
-            {
-            case TasksNames::FloatingBaseEOM:
-                                control_tasks.task_floating_base_eom(A.middleRows(ne, ne_temp), b.segment(ne, ne_temp));
-                break;
-            case TasksNames::TorqueLimits:
-                                control_tasks.task_torque_limits(C.middleRows(ni, ni_temp), d.segment(ni, ni_temp));
-                break;
-            case TasksNames::FrictionAndFcModulation:
-                                control_tasks.task_friction_Fc_modulation(C.middleRows(ni, ni_temp), d.segment(ni, ni_temp));
-                break;
-            case TasksNames::LinearBaseMotionTracking:
-                                control_tasks.task_linear_motion_tracking(
-                    A.middleRows(ne, ne_temp), b.segment(ne, ne_temp),
-                    gen_pose.base_acc, gen_pose.base_vel, gen_pose.base_pos
-                );
-                break;
-            case TasksNames::AngularBaseMotionTracking:
-                                control_tasks.task_angular_motion_tracking(
-                    A.middleRows(ne, ne_temp), b.segment(ne, ne_temp),
-                    gen_pose.base_angvel, gen_pose.base_quat
-                );
-                break;
-            case TasksNames::SwingFeetMotionTracking:
-                                control_tasks.task_swing_feet_tracking(
-                    A.middleRows(ne, ne_temp), b.segment(ne, ne_temp),
-                    gen_pose.feet_acc, gen_pose.feet_vel, gen_pose.feet_pos
-                );
-                break;
-            case TasksNames::ContactConstraints:
-                                if (contact_constraint_type == ContactConstraintType::soft_kv) {
-                    control_tasks.task_contact_constraints_soft_kv(
-                        A.middleRows(ne, ne_temp), b.segment(ne, ne_temp),
-                        C.middleRows(ni, ni_temp), d.segment(ni, ni_temp),
-                        d_k1, d_k2
-                    );
-                } else if (contact_constraint_type == ContactConstraintType::soft_sim) {
-                    control_tasks.task_contact_constraints_soft_sim(
-                        A.middleRows(ne, ne_temp), b.segment(ne, ne_temp),
-                        C.middleRows(ni, ni_temp), d.segment(ni, ni_temp),
-                        d_k1, d_k2
-                    );
-                } else if (contact_constraint_type == ContactConstraintType::rigid) {
-                    control_tasks.task_contact_constraints_rigid(
-                        A.middleRows(ne, ne_temp), b.segment(ne, ne_temp)
-                    );
-                }
-
-                break;
-            case TasksNames::JointSingularities:
-                                control_tasks.task_joint_singularities(C.middleRows(ni, ni_temp), d.segment(ni, ni_temp));
-                break;
-            case TasksNames::EnergyAndForcesOptimization:
-                                control_tasks.task_energy_forces_minimization(A.middleRows(ne, ne_temp), b.segment(ne, ne_temp));
-                break;
-            case TasksNames::SEPARATOR:
-                break;
-            }
-
-            ne += ne_temp;
-            ni += ni_temp;
+    // The built-in control tasks are called through a function pointer, and only the plugins through a virtual function.
+    for (const TaskLayout::Block& block : get_task_layout().blocks[priority]) {
+        if (block.function) {
+            block.function(
+                control_tasks,
+                A.middleRows(block.eq_offset, block.eq_rows), b.segment(block.eq_offset, block.eq_rows),
+                C.middleRows(block.ineq_offset, block.ineq_rows), d.segment(block.ineq_offset, block.ineq_rows),
+                gen_pose, d_k1, d_k2
+            );
+        } else {
+            block.plugin->compute(
+                control_tasks,
+                A.middleRows(block.eq_offset, block.eq_rows), b.segment(block.eq_offset, block.eq_rows),
+                C.middleRows(block.ineq_offset, block.ineq_rows), d.segment(block.ineq_offset, block.ineq_rows),
+                gen_pose, d_k1, d_k2
+            );
         }
     }
 }
 
-std::pair<int,int> PrioritizedTasks::get_task_dimension(TasksNames task_name)
+std::pair<int,int> PrioritizedTasks::get_task_dimension(int task, int nc)
 {
+    const int nv = control_tasks.get_nv();
+    const int nF = 3 * nc;
+
+    if (tasks[task].plugin) {
+        return tasks[task].plugin->get_dimension(nv, nc, contact_constraint_type);
+    }
+
+    int nd = 0;
+    if (contact_constraint_type == ContactConstraintType::soft_kv) {
+        nd = nF;
+    } else if (contact_constraint_type == ContactConstraintType::soft_sim) {
+        nd = nc;
+    }
+
     int ne = 0;
     int ni = 0;
 
-    switch (task_name)
+    switch (static_cast<TasksNames>(task))
     {
     case TasksNames::FloatingBaseEOM:
         ne = 6;
         break;
     case TasksNames::TorqueLimits:
-        ni = 2 * (control_tasks.get_nv() - 6);
+        ni = 2 * (nv - 6);
         break;
     case TasksNames::FrictionAndFcModulation:
-        ni = 6 * control_tasks.get_nc();
+        ni = 6 * nc;
         break;
     case TasksNames::LinearBaseMotionTracking:
         ne = 3;
@@ -138,24 +267,24 @@ std::pair<int,int> PrioritizedTasks::get_task_dimension(TasksNames task_name)
         ne = 3;
         break;
     case TasksNames::SwingFeetMotionTracking:
-        ne = 12 - 3 * control_tasks.get_nc();
+        ne = 12 - 3 * nc;
         break;
     case TasksNames::ContactConstraints:
         if (contact_constraint_type == ContactConstraintType::soft_kv) {
-            ne = 2 * control_tasks.get_nF();
-            ni = 2 * control_tasks.get_nF();
+            ne = 2 * nF;
+            ni = 2 * nF;
         } else if (contact_constraint_type == ContactConstraintType::soft_sim) {
-            ne = control_tasks.get_nc() + control_tasks.get_nF();
-            ni = 2 * control_tasks.get_nc();
+            ne = nc + nF;
+            ni = 2 * nc;
         } else if (contact_constraint_type == ContactConstraintType::rigid) {
-            ne = control_tasks.get_nF();
+            ne = nF;
         }
         break;
     case TasksNames::JointSingularities:
         ni = 4;
         break;
     case TasksNames::EnergyAndForcesOptimization:
-        ne = control_tasks.get_nv() - 6 + control_tasks.get_nF() + control_tasks.get_nd();
+        ne = nv - 6 + nF + nd;
         break;
     case TasksNames::SEPARATOR:
         break;
@@ -164,38 +293,301 @@ std::pair<int,int> PrioritizedTasks::get_task_dimension(TasksNames task_name)
     return std::make_pair(ne, ni);
 }
 
-std::pair<int,int> PrioritizedTasks::get_prioritized_task_dimension(int priority)
+std::tuple<int,int,int> PrioritizedTasks::get_max_problem_dimensions()
 {
-    int ne = 0;
-    int ni = 0;
+    int sol_dim = 0;
+    int eq_rows = 0;
+    int ineq_rows = 0;
+
+    for (const TaskLayout& layout : task_layouts) {
+        sol_dim = std::max(sol_dim, layout.cols);
 
-    for (int i = 0; i < static_cast<int>(tasks_vector.size()); i++) {
-        if (tasks_vector[i] == priority) {
-            std::pair<int,int> n_temp = get_task_dimension(static_cast<TasksNames>(i));
-            ne += n_temp.first;
-            ni += n_temp.second;
+        int ineq_rows_nc = 0;
+        for (int p = 0; p <= get_max_priority(); p++) {
+            eq_rows = std::max(eq_rows, layout.eq_rows[p]);
+            ineq_rows_nc += layout.ineq_rows[p];
         }
+
+        ineq_rows = std::max(ineq_rows, ineq_rows_nc);
     }
 
-    return std::make_pair(ne, ni);
+    return std::make_tuple(sol_dim, eq_rows, ineq_rows);
+}
+
+std::vector<std::string> PrioritizedTasks::get_task_names() const
+{
+    std::vector<std::string> task_names;
+
+    for (const RegisteredTask& task : tasks) {
+        task_names.push_back(task.name);
+    }
+
+    return task_names;
+}
+
+int PrioritizedTasks::get_task_index(const std::string& task_name) const
+{
+    for (int i = 0; i < static_cast<int>(tasks.size()); i++) {
+        if (tasks[i].name == task_name) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+std::vector<std::vector<int>> PrioritizedTasks::parse_task_priorities(const std::vector<std::string>& priorities) const
+{
+    std::vector<std::vector<int>> task_priorities;
+
+    for (std::string priority : priorities) {
+        std::replace(priority.begin(), priority.end(), ',', ' ');
+
+        std::istringstream stream(priority);
+        std::string name;
+
+        task_priorities.emplace_back();
+
+        while (stream >> name) {
+            const int task = get_task_index(name);
+
+            if (task < 0) {
+                throw std::invalid_argument("'" + name + "' is not the name of a control task.");
+            }
+
+            task_priorities.back().push_back(task);
+        }
+    }
+
+    return task_priorities;
+}
+
+int PrioritizedTasks::add_task_plugin(std::shared_ptr<TaskPlugin> plugin)
+{
+    if (!plugin) {
+        throw std::invalid_argument("The task plugin is null.");
+    }
+
+    const std::string name = plugin->get_name();
+
+    if (name.empty() || get_task_index(name) >= 0) {
+        throw std::invalid_argument("The name '" + name + "' of a task plugin is empty or already used.");
+    }
+
+    // The plugin is not used until it is added to the hierarchy.
+    tasks.push_back({name, plugin->get_model_quantities(), std::move(plugin)});
+    task_weights.push_back(1.);
+    enabled_tasks.push_back(true);
+    tasks_vector.push_back(-1);
+
+    return static_cast<int>(tasks.size()) - 1;
+}
+
+void PrioritizedTasks::set_task_hierarchy(
+    const std::vector<std::vector<int>>& task_priorities,
+    const std::vector<double>& task_weights,
+    const std::vector<bool>& enabled_tasks
+) {
+    const int n_tasks = static_cast<int>(tasks.size());
+
+    if (static_cast<int>(task_weights.size()) != n_tasks || static_cast<int>(enabled_tasks.size()) != n_tasks) {
+        throw std::invalid_argument("task_weights and enabled_tasks must have one element per control task.");
+    }
+
+    for (int i = 0; i < n_tasks; i++) {
+        if (!std::isfinite(task_weights[i]) || task_weights[i] <= 0) {
+            throw std::invalid_argument("The weight of " + tasks[i].name + " must be positive.");
+        }
+    }
+
+    std::vector<int> priorities = compute_prioritized_tasks_vector(task_priorities, enabled_tasks);
+
+    // The torques are computed assuming that the floating base equations of motion hold, hence they must be in the first priority, which is always solved.
+    const int floating_base_eom = static_cast<int>(TasksNames::FloatingBaseEOM);
+
+    if (priorities[floating_base_eom] != 0) {
+        throw std::invalid_argument(tasks[floating_base_eom].name + " must be enabled and have the highest priority.");
+    }
+
+    this->task_priorities = task_priorities;
+    this->task_weights = task_weights;
+    this->enabled_tasks = enabled_tasks;
+
+    compile_task_hierarchy();
+}
+
+void PrioritizedTasks::compile_task_hierarchy()
+{
+    // With the reduced formulation, the floating base equations of motion are satisfied by construction.
+    std::vector<bool> enabled_tasks = this->enabled_tasks;
+
+    if (formulation_type == FormulationType::reduced) {
+        enabled_tasks[static_cast<int>(TasksNames::FloatingBaseEOM)] = false;
+    }
+
+    tasks_vector = compute_prioritized_tasks_vector(task_priorities, enabled_tasks);
+
+    compute_task_layouts();
+    update_model_quantities();
 }
 
-void PrioritizedTasks::compute_prioritized_tasks_vector()
+void PrioritizedTasks::update_model_quantities()
 {
-    int count = static_cast<int>(TasksNames::SEPARATOR);
-    tasks_vector.assign(count, -1);
+    // M, h, and Jc are always used by the computation of the torques.
+    robot_wrapper::ModelQuantities model_quantities;
+    model_quantities.M = true;
+    model_quantities.h = true;
+    model_quantities.Jc = true;
+
+    for (int i = 0; i < static_cast<int>(tasks.size()); i++) {
+        if (tasks_vector[i] >= 0) {
+            model_quantities |= tasks[i].model_quantities;
+        }
+    }
+
+    control_tasks.set_model_quantities(model_quantities);
+}
+
+std::vector<int> PrioritizedTasks::compute_prioritized_tasks_vector(
+    const std::vector<std::vector<int>>& task_priorities,
+    const std::vector<bool>& enabled_tasks
+) const {
+    const int count = static_cast<int>(tasks.size());
+
+    std::vector<int> tasks_vector(count, -1);
+    std::vector<bool> listed(count, false);
+
+    // The priorities that are left without control tasks are skipped.
+    int priority = 0;
+
+    for (const auto& tasks_p : task_priorities) {
+        bool empty_priority = true;
+
+        for (int task : tasks_p) {
+            if (task < 0 || task >= count) {
+                throw std::invalid_argument("The control task " + std::to_string(task) + " is not registered.");
+            }
+
+            if (listed[task]) {
+                throw std::invalid_argument(tasks[task].name + " is listed more than once.");
+            }
+            listed[task] = true;
+
+            if (enabled_tasks[task]) {
+                tasks_vector[task] = priority;
+                empty_priority = false;
+            }
+        }
+
+        if (!empty_priority) {
+            priority++;
+        }
+    }
 
+    return tasks_vector;
+}
+
+TaskFunction PrioritizedTasks::get_task_function(TasksNames task_name) const
+{
+    switch (task_name)
     {
-        int priority = 0;
+    case TasksNames::FloatingBaseEOM:
+        return &task_floating_base_eom;
+    case TasksNames::TorqueLimits:
+        return &task_torque_limits;
+    case TasksNames::FrictionAndFcModulation:
+        return &task_friction_Fc_modulation;
+    case TasksNames::LinearBaseMotionTracking:
+        return &task_linear_motion_tracking;
+    case TasksNames::AngularBaseMotionTracking:
+        return &task_angular_motion_tracking;
+    case TasksNames::SwingFeetMotionTracking:
+        return &task_swing_feet_tracking;
+    case TasksNames::ContactConstraints:
+        if (contact_constraint_type == ContactConstraintType::soft_kv) {
+            return &task_contact_constraints_soft_kv;
+        } else if (contact_constraint_type == ContactConstraintType::soft_sim) {
+            return &task_contact_constraints_soft_sim;
+        } else if (contact_constraint_type == ContactConstraintType::rigid) {
+            return &task_contact_constraints_rigid;
+        }
+        break;
+    case TasksNames::JointSingularities:
+        return &task_joint_singularities;
+    case TasksNames::EnergyAndForcesOptimization:
+        return &task_energy_forces_minimization;
+    case TasksNames::SEPARATOR:
+        break;
+    }
+
+    return &task_empty;
+}
+
+void PrioritizedTasks::compute_task_layouts()
+{
+    const int n_feet = static_cast<int>(get_generic_feet_names().size());
+    const int n_priorities = get_max_priority() + 1;
+
+    task_layouts.assign(n_feet + 1, TaskLayout());
+
+    for (int nc = 0; nc <= n_feet; nc++) {
+        TaskLayout& layout = task_layouts[nc];
+
+        layout.blocks.assign(n_priorities, {});
+        layout.eq_rows.assign(n_priorities, 0);
+        layout.ineq_rows.assign(n_priorities, 0);
+
+        // The control tasks of a priority are stacked in the order of their indices: the built-in ones first, in the order of TasksNames, and then the plugins.
+        for (int i = 0; i < static_cast<int>(tasks_vector.size()); i++) {
+            const int priority = tasks_vector[i];
+            if (priority < 0) {
+                continue;
+            }
+
+            const auto task_rows = get_task_dimension(i, nc);
 
-        for (TasksNames name : prioritized_tasks_list) {
-            if (name == TasksNames::SEPARATOR) {
-                priority++;
+            TaskLayout::Block block;
+            block.task = i;
+            if (tasks[i].plugin) {
+                block.plugin = tasks[i].plugin.get();
             } else {
-                tasks_vector[static_cast<int>(name)] = priority;
+                block.function = get_task_function(static_cast<TasksNames>(i));
             }
+            block.eq_offset = layout.eq_rows[priority];
+            block.eq_rows = task_rows.first;
+            block.ineq_offset = layout.ineq_rows[priority];
+            block.ineq_rows = task_rows.second;
+
+            layout.blocks[priority].push_back(block);
+            layout.eq_rows[priority] += task_rows.first;
+            layout.ineq_rows[priority] += task_rows.second;
+        }
+
+        // The weights of the rows of each control task.
+        layout.we.resize(n_priorities);
+        layout.wi.resize(n_priorities);
+
+        for (int p = 0; p < n_priorities; p++) {
+            layout.we[p].resize(layout.eq_rows[p]);
+            layout.wi[p].resize(layout.ineq_rows[p]);
+
+            for (const TaskLayout::Block& block : layout.blocks[p]) {
+                const double weight = task_weights[block.task];
+
+                layout.we[p].segment(block.eq_offset, block.eq_rows).setConstant(weight);
+                layout.wi[p].segment(block.ineq_offset, block.ineq_rows).setConstant(weight);
+            }
+        }
+
+        int nd = 0;
+        if (contact_constraint_type == ContactConstraintType::soft_kv) {
+            nd = 3 * nc;
+        } else if (contact_constraint_type == ContactConstraintType::soft_sim) {
+            nd = nc;
         }
+
+        layout.cols = control_tasks.get_nv() + 3 * nc + nd;
     }
 }
 
-} // namespace wbc
\ No newline at end of file
+} // namespace wbc
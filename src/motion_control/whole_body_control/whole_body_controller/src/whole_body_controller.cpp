@@ -1,5 +1,8 @@
 #include "whole_body_controller/whole_body_controller.hpp"
 
+#include <chrono>
+#include <limits>
+
 
 
 namespace wbc {
@@ -16,84 +19,125 @@ WholeBodyController::WholeBodyController(const std::string& robot_name, float dt
   tau_opt(Eigen::VectorXd::Zero(12)),
   f_c_opt(Eigen::VectorXd::Zero(12)),
   d_des_opt(Eigen::VectorXd::Zero(0))
-{}
+{
+    reserve_hierarchical_qp();
+}
 
 
 /* ========================================================================== */
 /*                                    STEP                                    */
 /* ========================================================================== */
 
-void WholeBodyController::step(const Eigen::VectorXd& q, const Eigen::VectorXd& v, const GeneralizedPose& gen_pose)
+void WholeBodyController::step(const Eigen::VectorXd& q, const Eigen::VectorXd& v, const GeneralizedPose& gen_pose, double time_budget)
 {
-    std::pair<Eigen::VectorXd, Eigen::VectorXd> defs_pair;
+    const auto start = std::chrono::steady_clock::now();
 
-    if (prioritized_tasks.get_contact_constraint_type() != ContactConstraintType::rigid) {
-        deformations_history_manager.initialize_deformations_after_planning(gen_pose.contact_feet_names);
+    // The rigid contact constraints do not use the history of the deformations.
+    static const Eigen::VectorXd no_deformations;
 
-        defs_pair = deformations_history_manager.get_deformations_history();
-    } else {
-        defs_pair = std::make_pair(Eigen::VectorXd::Zero(0), Eigen::VectorXd::Zero(0));
+    const bool soft_contacts = prioritized_tasks.get_contact_constraint_type() != ContactConstraintType::rigid;
+
+    if (soft_contacts) {
+        deformations_history_manager.initialize_deformations_after_planning(gen_pose.contact_feet_names);
     }
 
-    Eigen::MatrixXd A;
-    Eigen::VectorXd b;
-    Eigen::MatrixXd C;
-    Eigen::VectorXd d;
-    Eigen::VectorXd we;
-    Eigen::VectorXd wi;
+    const Eigen::VectorXd& d_k1 = soft_contacts ? deformations_history_manager.get_d_k1() : no_deformations;
+    const Eigen::VectorXd& d_k2 = soft_contacts ? deformations_history_manager.get_d_k2() : no_deformations;
 
     prioritized_tasks.reset(q, v, gen_pose.contact_feet_names);
 
-    prioritized_tasks.compute_task_p(0, A, b, C, d, gen_pose, defs_pair.first, defs_pair.second);
+    // Rows of each priority with the current feet in contact.
+    const TaskLayout& layout = prioritized_tasks.get_task_layout();
+
+    // Indices (in the generic feet names) of the feet in contact, in the order of gen_pose.contact_feet_names.
+    const std::vector<int>& contact_feet = prioritized_tasks.get_contact_feet();
 
-    for (int i = 1; i <= prioritized_tasks.get_max_priority(); i++) {
-        we = Eigen::VectorXd::Ones(A.rows());
-        wi = Eigen::VectorXd::Ones(C.rows());
+    // The QPs are warm started only while the feet in contact do not change.
+    {
+        std::uint64_t contact_key = 0;
+
+        for (const int index : contact_feet) {
+            contact_key |= std::uint64_t(1) << index;
+        }
 
-        hierarchical_qp.solve_qp(i-1, A, b, C, d, we, wi);
+        hierarchical_qp.set_warm_start_key(contact_key);
+    }
 
-        prioritized_tasks.compute_task_p(i, A, b, C, d, gen_pose, defs_pair.first, defs_pair.second);
+    // The budget left after the computation of the kinematics and dynamics is given to the hierarchical QP. The task with priority 0 is always solved.
+    if (time_budget > 0) {
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        hierarchical_qp.set_time_budget(std::max(time_budget - elapsed, std::numeric_limits<double>::min()));
+    } else {
+        hierarchical_qp.set_time_budget(0);
     }
 
-    we = Eigen::VectorXd::Ones(A.rows());
-    wi = Eigen::VectorXd::Ones(C.rows());
+    for (int i = 0; i <= prioritized_tasks.get_max_priority(); i++) {
+        // The tasks that would not be solved within the time budget are not computed, but they are still counted as skipped.
+        if (!hierarchical_qp.fits_time_budget(i)) {
+            hierarchical_qp.skip_remaining(i);
+            break;
+        }
+
+        // The task is assembled in blocks of the preallocated buffers.
+        const int eq_rows = layout.eq_rows[i];
+        const int ineq_rows = layout.ineq_rows[i];
+
+        auto A = task_A.topLeftCorner(eq_rows, layout.cols);
+        auto b = task_b.head(eq_rows);
+        auto C = task_C.topLeftCorner(ineq_rows, layout.cols);
+        auto d = task_d.head(ineq_rows);
 
-    hierarchical_qp.solve_qp(prioritized_tasks.get_max_priority(), A, b, C, d, we, wi);
+        prioritized_tasks.compute_task_p(i, A, b, C, d, gen_pose, d_k1, d_k2);
 
-    x_opt = hierarchical_qp.get_sol();
+        if (prioritized_tasks.get_formulation_type() == FormulationType::reduced) {
+            // The columns of the base accelerations are eliminated.
+            prioritized_tasks.reduce_task(A, b);
+            prioritized_tasks.reduce_task(C, d);
+
+            hierarchical_qp.solve_qp(i, A.rightCols(layout.cols - 6), b, C.rightCols(layout.cols - 6), d, layout.we[i], layout.wi[i]);
+        } else {
+            hierarchical_qp.solve_qp(i, A, b, C, d, layout.we[i], layout.wi[i]);
+        }
+    }
+
+    if (prioritized_tasks.get_formulation_type() == FormulationType::reduced) {
+        // Recover the base accelerations from the reduced solution, u_dot_b = T_b * y + t_b.
+        const auto y = hierarchical_qp.get_sol();
+        const BaseElimination& base_elimination = prioritized_tasks.get_base_elimination();
+
+        x_opt.resize(6 + y.size());
+        x_opt.tail(y.size()) = y;
+        x_opt.head(6) = base_elimination.t_b;
+        x_opt.head(6).noalias() += base_elimination.T_b * y.head(base_elimination.T_b.cols());
+    } else {
+        x_opt = hierarchical_qp.get_sol();
+    }
 
     const int nv = prioritized_tasks.get_nv();
     const int nF = prioritized_tasks.get_nF();
     const int nd = prioritized_tasks.get_nd();
 
-    Eigen::VectorXd f_c_opt_var = x_opt.segment(nv, nF);
-    Eigen::VectorXd d_des_opt_var = x_opt.segment(nv + nF, nd);
+    const auto f_c_opt_var = x_opt.segment(nv, nF);
+    const auto d_des_opt_var = x_opt.segment(nv + nF, nd);
 
     {
-        auto generic_feet_names = get_generic_feet_names();
-        std::string generic_foot_name;
-
         f_c_opt.setZero();
         d_des_opt.setZero();
 
         const int def_size = deformations_history_manager.get_def_size();
 
-        for (int i=0; i<static_cast<int>(gen_pose.contact_feet_names.size()); i++) {
-            generic_foot_name = gen_pose.contact_feet_names[i];
-
-            auto it = std::find(generic_feet_names.begin(), generic_feet_names.end(), generic_foot_name);
-
-            const int index = std::distance(generic_feet_names.begin(), it);
+        for (int i=0; i<static_cast<int>(contact_feet.size()); i++) {
+            const int index = contact_feet[i];
 
             f_c_opt.segment(3*index,3) = f_c_opt_var.segment(3*i, 3);
             
-            if (prioritized_tasks.get_contact_constraint_type() != ContactConstraintType::rigid) {
+            if (soft_contacts) {
                 d_des_opt.segment(def_size*index, def_size) = d_des_opt_var.segment(def_size*i, def_size);
             }
         }
     }
 
-    if (prioritized_tasks.get_contact_constraint_type() != ContactConstraintType::rigid) {
+    if (soft_contacts) {
         deformations_history_manager.update_deformations_after_optimization(d_des_opt_var);
     }
 
@@ -101,18 +145,78 @@ void WholeBodyController::step(const Eigen::VectorXd& q, const Eigen::VectorXd&
 }
 
 
+/* ========================================================================== */
+/*                           RESERVE_HIERARCHICAL_QP                          */
+/* ========================================================================== */
+
+void WholeBodyController::reserve_hierarchical_qp()
+{
+    auto [sol_dim, eq_rows, ineq_rows] = prioritized_tasks.get_max_problem_dimensions();
+
+    // The tasks are assembled in the full optimization vector, the hierarchical QP sees the reduced one.
+    const int reduced_sol_dim = prioritized_tasks.get_formulation_type() == FormulationType::reduced ? sol_dim - 6 : sol_dim;
+
+    hierarchical_qp.reserve(reduced_sol_dim, eq_rows, ineq_rows);
+
+    // ineq_rows bounds the inequality constraints of all the priorities together, hence of each one of them.
+    task_A.resize(eq_rows, sol_dim);
+    task_b.resize(eq_rows);
+    task_C.resize(ineq_rows, sol_dim);
+    task_d.resize(ineq_rows);
+}
+
+
+/* ========================================================================== */
+/*                             SET_TASK_HIERARCHY                             */
+/* ========================================================================== */
+
+void WholeBodyController::set_task_hierarchy(
+    const std::vector<std::vector<int>>& task_priorities,
+    const std::vector<double>& task_weights,
+    const std::vector<bool>& enabled_tasks)
+{
+    prioritized_tasks.set_task_hierarchy(task_priorities, task_weights, enabled_tasks);
+
+    rebuild_hierarchical_qp();
+}
+
+
+/* ========================================================================== */
+/*                            SET_FORMULATION_TYPE                            */
+/* ========================================================================== */
+
+void WholeBodyController::set_formulation_type(FormulationType formulation_type)
+{
+    // The reduced formulation removes floating_base_eom, and possibly the first priority, from the hierarchy.
+    prioritized_tasks.set_formulation_type(formulation_type);
+
+    rebuild_hierarchical_qp();
+}
+
+
+/* ========================================================================== */
+/*                          REBUILD_HIERARCHICAL_QP                           */
+/* ========================================================================== */
+
+void WholeBodyController::rebuild_hierarchical_qp()
+{
+    // Resized in place, so that its settings (backend, null space mode, warm start, diagnostics, ...) are kept.
+    hierarchical_qp.set_n_tasks(prioritized_tasks.get_max_priority());
+
+    reserve_hierarchical_qp();
+}
+
+
 /* ========================================================================== */
 /*                               COMPUTE_TORQUES                              */
 /* ========================================================================== */
 
 void WholeBodyController::compute_torques()
 {
-    const int nv = prioritized_tasks.get_nv();
-    const int nF = prioritized_tasks.get_nF();
+    const TorqueMap& torque_map = prioritized_tasks.get_torque_map();
 
-    tau_opt =   prioritized_tasks.get_M().bottomRows(nv-6) * x_opt.head(nv)
-              + prioritized_tasks.get_h().tail(nv-6)
-              - prioritized_tasks.get_Jc().rightCols(nv-6).transpose() * x_opt.segment(nv, nF);
+    tau_opt.noalias() = torque_map.A * x_opt.head(torque_map.A.cols());
+    tau_opt += torque_map.h_a;
 }
 
 } // namespace wbc
\ No newline at end of file
@@ -0,0 +1,212 @@
+#include "whole_body_controller/whole_body_controller.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+
+
+/// @brief Hierarchical QP with fixed maximum dimensions, large enough for the tasks of ANYmal C (nv = 18) with any feet in contact and any contact constraint type.
+using AnymalHierarchicalQP = hopt::FixedHierarchicalQP<
+    18 + 12 + 12,           // optimization vector
+    18 + 3 * 12 + 12 + 6,   // all the equality tasks together
+    2 * 18 + 4 * 12 - 8     // all the inequality tasks together
+>;
+
+
+/// @brief Matrices of the tasks of all the priorities of a hierarchical problem.
+struct HierarchicalProblem {
+    std::vector<Eigen::MatrixXd> A;
+    std::vector<Eigen::VectorXd> b;
+    std::vector<Eigen::MatrixXd> C;
+    std::vector<Eigen::VectorXd> d;
+};
+
+
+/// @brief Solve all the priorities of the problem.
+template<typename HQP>
+void solve(HQP& hqp, const HierarchicalProblem& problem)
+{
+    for (int p = 0; p < static_cast<int>(problem.A.size()); p++) {
+        hqp.solve_qp(p, problem.A[p], problem.b[p], problem.C[p], problem.d[p]);
+    }
+}
+
+
+/// @brief Return the average time [us] needed to solve all the problems.
+template<typename HQP>
+double benchmark(HQP& hqp, const std::vector<HierarchicalProblem>& problems, int n_repetitions)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < n_repetitions; i++) {
+        for (const auto& problem : problems) {
+            solve(hqp, problem);
+        }
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::micro>(end - start).count() / (n_repetitions * problems.size());
+}
+
+
+
+int main()
+{
+    using namespace wbc;
+    using namespace Eigen;
+    using namespace std;
+
+    std::string robot_name = "anymal_c";
+    float dt = 1./400.;
+
+    PrioritizedTasks prioritized_tasks(robot_name, dt);
+
+    GeneralizedPose gen_pose;
+    gen_pose.base_pos = {0, 0, 0.55};
+
+
+    /* ============================ Recorded States ========================= */
+
+    // States recorded in simulation with ANYmal C (the same used in test_whole_body_controller.cpp).
+
+    std::vector<VectorXd> q_rec(3, VectorXd::Zero(19));
+    std::vector<VectorXd> v_rec(3, VectorXd::Zero(18));
+
+    q_rec[0] << -4.00332046e-06,  6.52628557e-06,  6.31907932e-01, -3.91157384e-05,
+                 1.05449352e-04, -4.40777218e-07,  9.99999994e-01, -1.32374422e-02,
+                 3.69140336e-02, -6.10268612e-02, -1.37317625e-02, -3.94673767e-02,
+                 6.48098113e-02,  1.32987136e-02,  3.70337976e-02, -6.11880500e-02,
+                 1.38186318e-02, -3.96016448e-02,  6.50032111e-02;
+    v_rec[0] << -2.02562655e-04,  2.61344500e-04,  1.00147370e-01, -5.18886597e-03,
+                 1.85864755e-02,  4.94709400e-04, -1.03050612e+00,  1.14787118e+00,
+                -1.60779492e+00, -1.07193201e+00, -1.29660846e+00,  1.77220742e+00,
+                 1.03693607e+00,  1.15892654e+00, -1.62150350e+00,  1.08674935e+00,
+                -1.30117959e+00,  1.77660008e+00;
+
+    q_rec[1] << -4.00332046e-06,  6.52628557e-06,  6.31907932e-01, -3.91157384e-05,
+                 1.05449352e-04, -4.40777218e-07,  9.99999994e-01, -2.35676782e-02,
+                 4.83720489e-02, -7.69445160e-02, -2.44840524e-02, -5.24114312e-02,
+                 8.23529430e-02,  2.37027173e-02,  4.86005011e-02, -7.72404283e-02,
+                 2.46973234e-02, -5.25854122e-02,  8.25873295e-02;
+    v_rec[1] << -2.02562655e-04,  2.61344500e-04,  1.00147370e-01, -5.18886597e-03,
+                 1.85864755e-02,  4.94709400e-04, -1.03479344e+00,  1.14478042e+00,
+                -1.58170516e+00, -1.07751682e+00, -1.29324105e+00,  1.74302129e+00,
+                 1.04254360e+00,  1.15557588e+00, -1.59507147e+00,  1.08930535e+00,
+                -1.29698431e+00,  1.74699197e+00;
+
+    q_rec[2] << -7.30421128e-06,  4.25434169e-06,  6.32317004e-01, -4.29902655e-05,
+                 2.48132853e-04, -1.43107451e-06,  9.99999968e-01, -2.35676782e-02,
+                 4.83720489e-02, -7.69445160e-02, -2.44840524e-02, -5.24114312e-02,
+                 8.23529430e-02,  2.37027173e-02,  4.86005011e-02, -7.72404283e-02,
+                 2.46973234e-02, -5.25854122e-02,  8.25873295e-02;
+    v_rec[2] << -6.32633000e-05, -1.26162398e-04, -3.15400257e-02, -5.78185701e-03,
+                 1.69523028e-02,  9.11627853e-04, -1.03479344e+00,  1.14478042e+00,
+                -1.58170516e+00, -1.07751682e+00, -1.29324105e+00,  1.74302129e+00,
+                 1.04254360e+00,  1.15557588e+00, -1.59507147e+00,  1.08930535e+00,
+                -1.29698431e+00,  1.74699197e+00;
+
+
+    /* ========================== Build The Problems ======================== */
+
+    // Each recorded state with all the feet in contact, and with two feet in swing phase.
+
+    std::vector<HierarchicalProblem> problems;
+
+    for (const auto& contact_feet_names : std::vector<std::vector<std::string>>{
+        {"LF", "RF", "LH", "RH"}, {"LF", "LH"}
+    }) {
+        const int n_swing = 4 - static_cast<int>(contact_feet_names.size());
+
+        gen_pose.feet_acc = VectorXd::Zero(3 * n_swing);
+        gen_pose.feet_vel = VectorXd::Zero(3 * n_swing);
+        gen_pose.feet_pos = VectorXd::Zero(3 * n_swing);
+        gen_pose.contact_feet_names = contact_feet_names;
+
+        for (int i = 0; i < static_cast<int>(q_rec.size()); i++) {
+            prioritized_tasks.reset(q_rec[i], v_rec[i], contact_feet_names);
+
+            HierarchicalProblem problem;
+
+            for (int p = 0; p <= prioritized_tasks.get_max_priority(); p++) {
+                MatrixXd A, C;
+                VectorXd b, d;
+
+                prioritized_tasks.compute_task_p(p, A, b, C, d, gen_pose, VectorXd::Zero(0), VectorXd::Zero(0));
+
+                problem.A.push_back(A);
+                problem.b.push_back(b);
+                problem.C.push_back(C);
+                problem.d.push_back(d);
+            }
+
+            problems.push_back(problem);
+        }
+    }
+
+
+    /* ============================== Benchmark ============================= */
+
+    const int n_tasks = prioritized_tasks.get_max_priority();
+
+    hopt::HierarchicalQP hqp_dynamic(n_tasks);
+    auto [sol_dim, eq_rows, ineq_rows] = prioritized_tasks.get_max_problem_dimensions();
+    hqp_dynamic.reserve(sol_dim, eq_rows, ineq_rows);
+
+    // The fixed size object is large, hence it is not allocated on the stack of main.
+    auto hqp_fixed = std::make_unique<AnymalHierarchicalQP>(n_tasks);
+
+    double max_diff = 0;
+    for (const auto& problem : problems) {
+        solve(hqp_dynamic, problem);
+        solve(*hqp_fixed, problem);
+
+        max_diff = std::max(max_diff, (hqp_dynamic.get_sol() - hqp_fixed->get_sol()).lpNorm<Infinity>());
+    }
+
+    cout << "Maximum difference between the solutions: " << max_diff << endl;
+
+    const int n_repetitions = 1000;
+
+    // Warm-up, then measure.
+    benchmark(hqp_dynamic, problems, 10);
+    benchmark(*hqp_fixed, problems, 10);
+
+    cout << "HierarchicalQP (dynamic):     " << benchmark(hqp_dynamic, problems, n_repetitions) << " us per problem" << endl;
+    cout << "AnymalHierarchicalQP (fixed): " << benchmark(*hqp_fixed, problems, n_repetitions) << " us per problem" << endl;
+
+
+    /* ======================= Mixed Precision Report ======================= */
+
+    // Accuracy and time of the mixed precision solve, for each choice of the first priority solved in mixed precision.
+
+    cout << endl << "Mixed precision (the higher priorities in double precision):" << endl;
+
+    const double time_double = benchmark(hqp_dynamic, problems, n_repetitions);
+
+    for (int first_priority = 1; first_priority <= n_tasks; first_priority++) {
+        hopt::HierarchicalQP hqp_mixed(n_tasks);
+        hqp_mixed.reserve(sol_dim, eq_rows, ineq_rows);
+        hqp_mixed.set_mixed_precision(first_priority);
+
+        double max_rel_diff = 0;
+        for (const auto& problem : problems) {
+            solve(hqp_dynamic, problem);
+            solve(hqp_mixed, problem);
+
+            const double scale = 1 + hqp_dynamic.get_sol().lpNorm<Infinity>();
+            max_rel_diff = std::max(max_rel_diff, (hqp_dynamic.get_sol() - hqp_mixed.get_sol()).lpNorm<Infinity>() / scale);
+        }
+
+        benchmark(hqp_mixed, problems, 10);
+        const double time_mixed = benchmark(hqp_mixed, problems, n_repetitions);
+
+        cout << "From priority " << first_priority << ": " << time_mixed << " us per problem ("
+             << time_double / time_mixed << "x), maximum relative difference " << max_rel_diff << endl;
+    }
+
+    return 0;
+}
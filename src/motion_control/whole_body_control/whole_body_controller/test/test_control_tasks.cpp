@@ -92,4 +92,39 @@ int main()
         A, b
     );
     std::cout << "Energy and forces minimization successfull" << std::endl;
+
+    // A robot with 2 DoF legs: the contact jacobian of each leg has rank at most 2, hence each leg in contact has at least a null force row.
+    {
+        wbc::ControlTasks control_tasks_2dof("mulinex", dt);
+
+        const Eigen::VectorXd q_2dof = pinocchio::neutral(control_tasks_2dof.get_model());
+        const Eigen::VectorXd v_2dof = Eigen::VectorXd::Zero(q_2dof.size() - 1);
+
+        control_tasks_2dof.reset(q_2dof, v_2dof, {"LF", "RF", "LH", "RH"}, wbc::ContactConstraintType::rigid);
+
+        const int nv_2dof = control_tasks_2dof.get_nv();
+        const int nF_2dof = control_tasks_2dof.get_nF();
+
+        Eigen::MatrixXd A_rigid = Eigen::MatrixXd::Zero(nF_2dof, nv_2dof + nF_2dof);
+        Eigen::VectorXd b_rigid = Eigen::VectorXd::Zero(nF_2dof);
+
+        control_tasks_2dof.task_contact_constraints_rigid(A_rigid, b_rigid);
+
+        for (int i = 0; i < nF_2dof / 3; i++) {
+            int null_force_rows = 0;
+
+            for (int k = 3*i; k < 3*i + 3; k++) {
+                if (A_rigid.row(k).head(nv_2dof).isZero() && !A_rigid.row(k).tail(nF_2dof).isZero()) {
+                    null_force_rows++;
+                }
+            }
+
+            if (null_force_rows == 0) {
+                std::cerr << "Rigid contact constraints with 2 DoF legs: no null force row for the foot " << i << std::endl;
+                return 1;
+            }
+        }
+
+        std::cout << "Rigid contact constraints with 2 DoF legs successfull" << std::endl;
+    }
 }
\ No newline at end of file
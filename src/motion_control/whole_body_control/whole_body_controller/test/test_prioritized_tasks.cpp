@@ -1,6 +1,28 @@
 #include <whole_body_controller/prioritized_tasks.hpp>
 
 #include <iostream>
+#include <memory>
+
+
+
+/// @brief Control task of a plugin, which asks for a zero base vertical acceleration.
+class BaseVerticalAccelerationTask : public wbc::TaskPlugin {
+public:
+    std::string get_name() const override {return "base_vertical_acceleration";}
+
+    std::pair<int,int> get_dimension(int /*nv*/, int /*nc*/, wbc::ContactConstraintType /*contact_constraint_type*/) const override {return {1, 0};}
+
+    void compute(
+        wbc::ControlTasks& /*control_tasks*/,
+        Eigen::Ref<Eigen::MatrixXd> A, Eigen::Ref<Eigen::VectorXd> /*b*/,
+        Eigen::Ref<Eigen::MatrixXd> /*C*/, Eigen::Ref<Eigen::VectorXd> /*d*/,
+        const wbc::GeneralizedPose& /*gen_pose*/,
+        const Eigen::VectorXd& /*d_k1*/, const Eigen::VectorXd& /*d_k2*/
+    ) override
+    {
+        A(0, 2) = 1;
+    }
+};
 
 
 
@@ -36,7 +58,7 @@ int main()
     gen_pose.feet_acc = VectorXd::Zero(0);
     gen_pose.feet_vel = VectorXd::Zero(0);
     gen_pose.feet_pos = VectorXd::Zero(0);
-    gen_pose.contact_feet_names = {"LF_FOOT", "RF_FOOT", "LH_FOOT", "RH_FOOT"};
+    gen_pose.contact_feet_names = {"LF", "RF", "LH", "RH"};
 
     // VectorXd d_k1 = VectorXd::Ones(6);
     // VectorXd d_k2 = VectorXd::Ones(6);
@@ -75,5 +97,16 @@ int main()
 
     cout << "get_max_priority successfull\n";
 
+    const int task = prio_tasks.add_task_plugin(make_shared<BaseVerticalAccelerationTask>());
+    auto task_priorities = prio_tasks.get_task_priorities();
+    task_priorities.back().push_back(task);
+
+    const int n_tasks = static_cast<int>(prio_tasks.get_task_names().size());
+    prio_tasks.set_task_hierarchy(task_priorities, vector<double>(n_tasks, 1.), vector<bool>(n_tasks, true));
+
+    prio_tasks.compute_task_p(4, A, b, C, d, gen_pose, d_k1, d_k2);
+
+    cout << "Task plugin successfull\n";
+
     return 0;
 }
\ No newline at end of file
@@ -1,6 +1,53 @@
 #include "whole_body_controller/whole_body_controller.hpp"
 
+#include <cstddef>
+#include <filesystem>
 #include <iostream>
+#include <memory>
+#include <string>
+
+
+
+#if defined(__GLIBC__)
+// The heap allocations of the process are counted while count_allocations is set, by wrapping the allocation functions of glibc.
+extern "C" void* __libc_malloc(std::size_t size);
+extern "C" void* __libc_calloc(std::size_t n, std::size_t size);
+extern "C" void* __libc_realloc(void* ptr, std::size_t size);
+
+static bool count_allocations = false;
+static long allocations = 0;
+
+extern "C" void* malloc(std::size_t size)
+{
+    if (count_allocations) {allocations++;}
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(std::size_t n, std::size_t size)
+{
+    if (count_allocations) {allocations++;}
+    return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void* ptr, std::size_t size)
+{
+    if (count_allocations) {allocations++;}
+    return __libc_realloc(ptr, size);
+}
+#endif
+
+
+
+/// @brief Print a message if the condition does not hold.
+/// @return true if the condition holds
+bool check(bool condition, const std::string& message)
+{
+    if (!condition) {
+        std::cerr << "check failed: " << message << std::endl;
+    }
+
+    return condition;
+}
 
 
 
@@ -32,7 +79,7 @@ int main()
     gen_pose.feet_acc = VectorXd::Zero(0);
     gen_pose.feet_vel = VectorXd::Zero(0);
     gen_pose.feet_pos = VectorXd::Zero(0);
-    gen_pose.contact_feet_names = {"LF_FOOT", "RF_FOOT", "LH_FOOT", "RH_FOOT"};
+    gen_pose.contact_feet_names = {"LF", "RF", "LH", "RH"};
 
     // wbc.step(q, v, gen_pose);
 
@@ -45,7 +92,7 @@ int main()
     // cout << "get_torques completed successfully" << std::endl;
 
     gen_pose.base_pos = {0, 0, 0.55};
-    gen_pose.contact_feet_names = {"LF_FOOT", "RF_FOOT", "LH_FOOT", "RH_FOOT"};
+    gen_pose.contact_feet_names = {"LF", "RF", "LH", "RH"};
 
     wbc.set_kp_b_pos(100 * Eigen::Vector3d(1,1,1));
     wbc.set_kd_b_pos( 10 * Eigen::Vector3d(1,1,1));
@@ -121,7 +168,7 @@ int main()
     gen_pose.feet_acc = VectorXd::Zero(6);
     gen_pose.feet_vel = VectorXd::Zero(6);
     gen_pose.feet_pos = VectorXd::Zero(6);
-    gen_pose.contact_feet_names = {"LF_FOOT", "LH_FOOT"};
+    gen_pose.contact_feet_names = {"LF", "LH"};
     
     wbc.step(q, v, gen_pose);
 
@@ -129,5 +176,132 @@ int main()
 
     cout << tau << "\n" << endl;
 
+    // The same step, with the base accelerations eliminated from the hierarchical problem.
+    wbc.set_formulation_type(FormulationType::reduced);
+
+    wbc.step(q, v, gen_pose);
+
+    tau = wbc.get_tau_opt();
+
+    cout << tau << "\n" << endl;
+
+    bool success = true;
+
+    // The recovered base accelerations satisfy the floating base equations of motion, M_b u_dot + h_b - Jc_b^T F = 0.
+    {
+        const int nv = wbc.get_nv();
+        const int nF = wbc.get_nF();
+        const VectorXd& x_opt = wbc.get_x_opt();
+
+        const VectorXd residual = wbc.get_M().topRows(6) * x_opt.head(nv) + wbc.get_h().head(6) - wbc.get_Jc().leftCols(6).transpose() * x_opt.segment(nv, nF);
+
+        success &= check(residual.norm() < 1e-6 * (1 + wbc.get_h().head(6).norm()), "floating base equations of motion residual " + to_string(residual.norm()));
+    }
+
+    // With all the feet in contact, the two formulations solve the same problem, hence they give the same torques.
+    {
+        auto make_wbc = [&](FormulationType formulation_type) {
+            auto controller = std::make_unique<WholeBodyController>(robot_name, dt);
+
+            controller->set_kp_b_pos(100 * Eigen::Vector3d(1,1,1));
+            controller->set_kd_b_pos( 10 * Eigen::Vector3d(1,1,1));
+            controller->set_kp_b_ang(150 * Eigen::Vector3d(1,1,1));
+            controller->set_kd_b_ang( 35 * Eigen::Vector3d(1,1,1));
+            controller->set_kp_s_pos(150 * Eigen::Vector3d(1,1,1));
+            controller->set_kd_s_pos( 30 * Eigen::Vector3d(1,1,1));
+            controller->set_kp_terr(1000 * Eigen::Vector3d(1,1,1));
+            controller->set_kd_terr(1000 * Eigen::Vector3d(1,1,1));
+
+            controller->set_formulation_type(formulation_type);
+
+            return controller;
+        };
+
+        auto wbc_full = make_wbc(FormulationType::full);
+        auto wbc_reduced = make_wbc(FormulationType::reduced);
+
+        gen_pose.feet_acc = VectorXd::Zero(0);
+        gen_pose.feet_vel = VectorXd::Zero(0);
+        gen_pose.feet_pos = VectorXd::Zero(0);
+        gen_pose.contact_feet_names = {"LF", "RF", "LH", "RH"};
+
+        wbc_full->step(q, v, gen_pose);
+        wbc_reduced->step(q, v, gen_pose);
+
+        const VectorXd& tau_full = wbc_full->get_tau_opt();
+        const VectorXd& tau_reduced = wbc_reduced->get_tau_opt();
+
+        success &= check((tau_full - tau_reduced).norm() < 1e-3 * (1 + tau_full.norm()), "torques of the reduced formulation differ by " + to_string((tau_full - tau_reduced).norm()));
+    }
+
+    if (!success) {
+        return 1;
+    }
+
+    cout << "reduced formulation successfull\n";
+
+    // The tasks that do not fit in the time budget are counted as skipped, and the problem is captured as an overrun.
+    {
+        const auto directory = std::filesystem::temp_directory_path() / "wbc_time_budget_test";
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+
+        WholeBodyController wbc_budget(robot_name, dt);
+
+        auto capture = std::make_shared<hopt::ProblemCapture>(directory.string());
+        wbc_budget.set_problem_capture(capture);
+
+        wbc_budget.step(q, v, gen_pose, 1e-12);
+
+        wbc_budget.set_problem_capture(nullptr);
+        capture.reset();
+
+        int n_files = 0;
+        for ([[maybe_unused]] const auto& entry : std::filesystem::directory_iterator(directory)) {
+            n_files++;
+        }
+
+        success &= check(wbc_budget.get_solver_stats().budget_skips > 0, "no task skipped for the time budget");
+        success &= check(n_files == 1, "the problem that exhausted the time budget has not been captured");
+
+        std::filesystem::remove_all(directory);
+    }
+
+    if (!success) {
+        return 1;
+    }
+
+    cout << "time budget successfull\n";
+
+#if defined(__GLIBC__)
+    // While the feet in contact do not change, a step does not allocate on the heap, with both formulations.
+    for (const FormulationType formulation_type : {FormulationType::full, FormulationType::reduced}) {
+        WholeBodyController wbc_alloc(robot_name, dt);
+        wbc_alloc.set_formulation_type(formulation_type);
+
+        // The first steps size the buffers that depend on the feet in contact.
+        for (int k = 0; k < 3; k++) {
+            wbc_alloc.step(q, v, gen_pose);
+        }
+
+        allocations = 0;
+        count_allocations = true;
+
+        for (int k = 0; k < 10; k++) {
+            wbc_alloc.step(q, v, gen_pose);
+        }
+
+        count_allocations = false;
+
+        success &= check(allocations == 0, to_string(allocations) + " heap allocations in the steps of the formulation " + to_string(static_cast<int>(formulation_type)));
+    }
+
+    if (!success) {
+        return 1;
+    }
+
+    cout << "no heap allocations successfull\n";
+#endif
+
     return 0;
 }
\ No newline at end of file
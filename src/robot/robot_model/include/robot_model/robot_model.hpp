@@ -6,6 +6,7 @@
 #include <Eigen/Core>
 
 #include <algorithm>
+#include <array>
 #include <string>
 #include <vector>
 
@@ -13,6 +14,32 @@
 
 namespace robot_wrapper {
 
+/// @brief Kinematics and dynamics quantities that RobotModel::compute() must compute.
+struct ModelQuantities {
+    bool M = false;                 ///< @brief Joint space inertia matrix
+    bool h = false;                 ///< @brief Nonlinear effects vector
+    bool Jc = false;                ///< @brief Stack of the contact feet jacobians
+    bool Jc_dot_times_v = false;    ///< @brief Stack of the Jc_dot * v of the contact feet
+    bool Jb = false;                ///< @brief Base jacobian
+    bool Jb_dot_times_v = false;    ///< @brief Jb_dot * v of the base
+    bool Js = false;                ///< @brief Stack of the swing feet jacobians
+    bool Js_dot_times_v = false;    ///< @brief Stack of the Js_dot * v of the swing feet
+
+    /// @brief Add the quantities of another set to this one.
+    ModelQuantities& operator|=(const ModelQuantities& other)
+    {
+        M = M || other.M;
+        h = h || other.h;
+        Jc = Jc || other.Jc;
+        Jc_dot_times_v = Jc_dot_times_v || other.Jc_dot_times_v;
+        Jb = Jb || other.Jb;
+        Jb_dot_times_v = Jb_dot_times_v || other.Jb_dot_times_v;
+        Js = Js || other.Js;
+        Js_dot_times_v = Js_dot_times_v || other.Js_dot_times_v;
+        return *this;
+    }
+};
+
 
 /// @class @brief Creates the robot model from an urdf file and performs dynamics and kinematics computations.
 /// 
@@ -37,37 +64,44 @@ public:
     /// @attention This function must be called before calling the various J_i_dot_times_v.
     void compute_second_order_FK(const Eigen::VectorXd& q, const Eigen::VectorXd& v);
 
+    /// @brief Update the joints and frame placements, and compute only the requested quantities, each one once and sharing the Pinocchio passes between them.
+    /// @param[in] q
+    /// @param[in] v
+    /// @param[in] quantities quantities that can be read with the getters afterwards
+    /// @details It replaces compute_EOM() and compute_second_order_FK(): the joint velocities and accelerations required by the J_dot * v terms are computed in the same pass as the joint placements, and the joint jacobians time variation (which no getter uses) is not computed.
+    void compute(const Eigen::VectorXd& q, const Eigen::VectorXd& v, const ModelQuantities& quantities);
+
 
     /* =============================== Getters ============================== */
     
     /// @brief Get the stack of the contact jacobians Jc.
     /// @param[out] Jc [3*nc, nv]
-    /// @warning Compute_EOM must have been previously called.
+    /// @warning Compute_EOM, or compute() with quantities.Jc, must have been previously called.
     void get_Jc(Eigen::MatrixXd& Jc);
 
     /// @brief Get the jacobian of the base of the robot.
     /// @param[out] Jb [3, nv]
-    /// @warning Compute_EOM must have been previously called.
+    /// @warning Compute_EOM, or compute() with quantities.Jb, must have been previously called.
     void get_Jb(Eigen::MatrixXd& Jb);
 
     /// @brief Get the stack of the jacobian of the feet in swing phase.
     /// @param[out] Js [3*(n_feet-nc), nv]
-    /// @warning Compute_EOM must have been previously called.
+    /// @warning Compute_EOM, or compute() with quantities.Js, must have been previously called.
     void get_Js(Eigen::MatrixXd& Js);
 
     /// @brief Get the Jc_dot * v vector.
     /// @param Jc_dot_times_v [3*nc]
-    /// @warning Compute_second_order_FK must have been previously called.
+    /// @warning Compute_second_order_FK, or compute() with quantities.Jc_dot_times_v, must have been previously called.
     void get_Jc_dot_times_v(Eigen::VectorXd& Jc_dot_times_v);
 
     /// @brief Get the Jb_dot * v vector.
     /// @param Jb_dot_times_v [6]
-    /// @warning Compute_second_order_FK must have been previously called.
+    /// @warning Compute_second_order_FK, or compute() with quantities.Jb_dot_times_v, must have been previously called.
     void get_Jb_dot_times_v(Eigen::VectorXd& Jb_dot_times_v);
 
     /// @brief Get the Js_dot * v vector.
     /// @param Js_dot_times_v [3*(n_feet-nc)]
-    /// @warning Compute_second_order_FK must have been previously called.
+    /// @warning Compute_second_order_FK, or compute() with quantities.Js_dot_times_v, must have been previously called.
     void get_Js_dot_times_v(Eigen::VectorXd& Js_dot_times_v);
 
     /// @brief Get the rotation matrix oRb.
@@ -78,7 +112,7 @@ public:
     /// @brief Get the positions of the feet in swing phase.
     /// @param[out] r_s [3*(n_feet-nc)]
     /// @warning Compute_EOM must have been previously called.
-    void get_r_s(Eigen::VectorXd& r_s) const;
+    void get_r_s(Eigen::Ref<Eigen::VectorXd> r_s) const;
 
     /// @brief
     /// @warning Compute_EOM must have been previously called.
@@ -101,19 +135,24 @@ public:
     /// @brief Return the link names of all the robot's feet in the URDF.
     [[nodiscard]] const std::vector<std::string>& get_all_feet_names() const {return feet_names;}
 
+    /// @brief Return the frame indices of all the robot's feet, in the order of the generic feet names.
+    [[nodiscard]] const std::array<pinocchio::FrameIndex, 4>& get_feet_ids() const {return feet_ids;}
+
+    /// @brief Return the indices (in the generic feet names) of the feet in contact with the terrain, in the order in which they have been set.
+    [[nodiscard]] const std::vector<int>& get_contact_feet() const {return contact_feet;}
+
 
     /* =============================== Setters ============================== */
 
     /// @brief Compute the names of the feet in contact and swing phase.
     /// @param[in] generic_contact_feet_names Generic (i.e. LF, RF, etc.) names of the feet in contact with the terrain.
-    /// @details The feet in swing phase are all and only the feet not in contact with the terrain.
+    /// @details The feet in swing phase are all and only the feet not in contact with the terrain. The names are converted in the frame indices used by the getters.
+    /// @throws std::invalid_argument if a name is not a generic foot name
     void set_feet_names(const std::vector<std::string>& generic_contact_feet_names);
 
 
 
 private:
-    std::vector<std::string> generic_to_specific_feet_names(std::vector<std::string> generic_names);
-
     pinocchio::Model model;
     
     pinocchio::Data data;
@@ -126,11 +165,23 @@ private:
     /// @brief The link names of all the robot's feet in the URDF.
     std::vector<std::string> feet_names;
 
-    /// @brief The link names of the robot's feet in contact with the terrain.
-    std::vector<std::string> contact_feet_names;
+    /// @brief The frame indices of all the robot's feet, in the order of the generic feet names. They are resolved once, at construction.
+    std::array<pinocchio::FrameIndex, 4> feet_ids;
+
+    /// @brief The indices (in the generic feet names) of the robot's feet in contact with the terrain.
+    std::vector<int> contact_feet;
+
+    /// @brief The frame indices of the robot's feet in contact with the terrain.
+    std::vector<pinocchio::FrameIndex> contact_feet_ids;
     
-    /// @brief The link names of the robot's feet in swing phase.
-    std::vector<std::string> swing_feet_names;
+    /// @brief The frame indices of the robot's feet in swing phase.
+    std::vector<pinocchio::FrameIndex> swing_feet_ids;
+
+    /// @brief Zero generalized acceleration, used to compute the J_dot * v terms.
+    Eigen::VectorXd zero_acceleration;
+
+    /// @brief Jacobian of a single foot, used to stack the contact and swing feet Jacobians without allocating at every call.
+    Eigen::MatrixXd J_temp;
 
     /// @brief The position of the feet contact point with the terrain relative to the position of the feet frame, in inertial frame. 
     /// @details The position of the foot link computed from the robot model is not necessarly equal to the expected position of the point of contact with the terrain.
@@ -6,11 +6,14 @@
 #include "pinocchio/algorithm/crba.hpp"
 #include "pinocchio/algorithm/rnea.hpp"
 #include "pinocchio/algorithm/frames.hpp"
+#include "pinocchio/algorithm/jacobian.hpp"
 
 #include <ryml_std.hpp> // optional header. BUT when used, needs to be included BEFORE ryml.hpp
 #include <ryml.hpp>
 #include <c4/format.hpp>
 
+#include <stdexcept>
+
 
 
 namespace robot_wrapper {
@@ -113,6 +116,18 @@ RobotModel::RobotModel(const std::string& robot_name)
     // Create the data required by the algorithms
     const pinocchio::Data data(model);
     this->data = data;
+
+    zero_acceleration = Eigen::VectorXd::Zero(model.nv);
+    J_temp = Eigen::MatrixXd::Zero(6, model.nv);
+
+    // Resolve the frame indices of the feet, which are searched by name among all the frames of the model.
+    for (int i=0; i<4; i++) {
+        feet_ids[i] = model.getFrameId(feet_names[i]);
+    }
+
+    contact_feet.reserve(4);
+    contact_feet_ids.reserve(4);
+    swing_feet_ids.reserve(4);
 }
 
 
@@ -143,24 +158,57 @@ void RobotModel::compute_EOM(const Eigen::VectorXd& q, const Eigen::VectorXd& v)
 void RobotModel::compute_second_order_FK(const Eigen::VectorXd& q, const Eigen::VectorXd& v)
 {
     // Update the joint accelerations
-    pinocchio::forwardKinematics(model, data, q, v, Eigen::VectorXd::Zero(model.nv));
+    pinocchio::forwardKinematics(model, data, q, v, zero_acceleration);
 
     // Computes the full model Jacobian variations with respect to time
     pinocchio::computeJointJacobiansTimeVariation(model, data, q, v);
 }
 
 
+/* ================================= compute ================================ */
+
+void RobotModel::compute(const Eigen::VectorXd& q, const Eigen::VectorXd& v, const ModelQuantities& quantities)
+{
+    const bool jacobians = quantities.Jc || quantities.Jb || quantities.Js;
+    const bool accelerations = quantities.Jc_dot_times_v || quantities.Jb_dot_times_v || quantities.Js_dot_times_v;
+
+    // Update the joint placements and, when the J_dot * v terms are needed, the joint velocities and the joint accelerations with zero generalized acceleration
+    if (accelerations) {
+        pinocchio::forwardKinematics(model, data, q, v, zero_acceleration);
+    } else {
+        pinocchio::forwardKinematics(model, data, q);
+    }
+
+    // Computes the full model Jacobian from the joint placements just updated
+    if (jacobians) {
+        pinocchio::computeJointJacobians(model, data);
+    }
+
+    // Update the frame placements
+    pinocchio::updateFramePlacements(model, data);
+
+    // Compute the upper part of the joint space inertia matrix
+    if (quantities.M) {
+        pinocchio::crba(model, data, q);
+        data.M.triangularView<Eigen::StrictlyLower>() = data.M.transpose().triangularView<Eigen::StrictlyLower>();
+    }
+
+    // Compute the nonlinear effects vector (Coriolis, centrifugal and gravitational effects). It does not change the joint accelerations.
+    if (quantities.h) {
+        pinocchio::nonLinearEffects(model, data, q, v);
+    }
+}
+
+
 /* =============================== compute_Jc =============================== */
 
 void RobotModel::get_Jc(Eigen::MatrixXd& Jc)
 {
-    // Initialize a temp Jacobian that must be used to store the contact jacobian of a contact foot.
     // Jc is the stack of J_temp of all the contact feet.
-    Eigen::MatrixXd J_temp(6, model.nv);
 
     // Compute the stack of the contact Jacobians
-    for (size_t i = 0; i < contact_feet_names.size(); i++) {
-        pinocchio::FrameIndex frame_id = model.getFrameId(contact_feet_names[i]);
+    for (size_t i = 0; i < contact_feet_ids.size(); i++) {
+        const pinocchio::FrameIndex frame_id = contact_feet_ids[i];
 
         J_temp.setZero();
         
@@ -187,13 +235,11 @@ void RobotModel::get_Jb(Eigen::MatrixXd& Jb)
 
 void RobotModel::get_Js(Eigen::MatrixXd& Js)
 {
-    // Initialize a temp Jacobian that must be used to store the swing feet jacobian.
     // Js is the stack of J_temp of all the swing feet.
-    Eigen::MatrixXd J_temp(6, model.nv);
 
     // Compute the stack of the swing jacobians.
-    for (size_t i = 0; i < swing_feet_names.size(); i++) {
-        pinocchio::FrameIndex frame_id = model.getFrameId(swing_feet_names[i]);
+    for (size_t i = 0; i < swing_feet_ids.size(); i++) {
+        const pinocchio::FrameIndex frame_id = swing_feet_ids[i];
 
         J_temp.setZero();
         
@@ -208,8 +254,8 @@ void RobotModel::get_Js(Eigen::MatrixXd& Js)
 
 void RobotModel::get_Jc_dot_times_v(Eigen::VectorXd& Jc_dot_times_v)
 {
-    for (size_t i = 0; i < contact_feet_names.size(); i++) {
-        pinocchio::FrameIndex frame_id = model.getFrameId(contact_feet_names[i]);
+    for (size_t i = 0; i < contact_feet_ids.size(); i++) {
+        const pinocchio::FrameIndex frame_id = contact_feet_ids[i];
 
         Jc_dot_times_v.segment(0+3*i, 3) = pinocchio::getFrameClassicalAcceleration(model, data, frame_id, pinocchio::LOCAL_WORLD_ALIGNED).linear();
     }
@@ -230,8 +276,8 @@ void RobotModel::get_Jb_dot_times_v(Eigen::VectorXd& Jb_dot_times_v)
 
 void RobotModel::get_Js_dot_times_v(Eigen::VectorXd& Js_dot_times_v)
 {
-    for (size_t i = 0; i < swing_feet_names.size(); i++) {
-        pinocchio::FrameIndex frame_id = model.getFrameId(swing_feet_names[i]);
+    for (size_t i = 0; i < swing_feet_ids.size(); i++) {
+        const pinocchio::FrameIndex frame_id = swing_feet_ids[i];
 
         Js_dot_times_v.segment(0+3*i, 3) = pinocchio::getFrameClassicalAcceleration(model, data, frame_id, pinocchio::LOCAL_WORLD_ALIGNED).linear();
     }
@@ -250,10 +296,10 @@ void RobotModel::get_oRb(Eigen::Matrix3d& oRb) const
 
 /* ================================= get_r_s ================================ */
 
-void RobotModel::get_r_s(Eigen::VectorXd& r_s) const
+void RobotModel::get_r_s(Eigen::Ref<Eigen::VectorXd> r_s) const
 {
-    for (size_t i = 0; i < swing_feet_names.size(); i++) {
-        pinocchio::FrameIndex frame_id = model.getFrameId(swing_feet_names[i]);
+    for (size_t i = 0; i < swing_feet_ids.size(); i++) {
+        const pinocchio::FrameIndex frame_id = swing_feet_ids[i];
 
         r_s.segment(3*i, 3) = data.oMf[frame_id].translation() + feet_displacements;
     }
@@ -267,7 +313,7 @@ Eigen::VectorXd RobotModel::get_feet_positions() const
     Eigen::VectorXd feet_position(12);
 
     for (size_t i = 0; i < feet_names.size(); i++) {
-        pinocchio::FrameIndex frame_id = model.getFrameId(feet_names[i]);
+        const pinocchio::FrameIndex frame_id = feet_ids[i];
 
         feet_position.segment(3*i, 3) = data.oMf[frame_id].translation() + feet_displacements;
     }
@@ -284,7 +330,7 @@ Eigen::VectorXd RobotModel::get_feet_velocities(const Eigen::VectorXd& v)
     Eigen::MatrixXd J_temp(6, model.nv);
 
     for (int i=0; i<4; i++) {
-        pinocchio::FrameIndex frame_id = model.getFrameId(this->feet_names[i]);
+        const pinocchio::FrameIndex frame_id = feet_ids[i];
 
         J_temp.setZero();
 
@@ -301,32 +347,33 @@ Eigen::VectorXd RobotModel::get_feet_velocities(const Eigen::VectorXd& v)
 
 void RobotModel::set_feet_names(const std::vector<std::string>& generic_contact_feet_names)
 {
-    this->contact_feet_names = generic_to_specific_feet_names(generic_contact_feet_names);
+    contact_feet.clear();
+    contact_feet_ids.clear();
+    swing_feet_ids.clear();
 
-    swing_feet_names = {};
+    // Bitmask of the feet in contact, in the order of the generic feet names.
+    unsigned int contact_mask = 0;
 
-    for (size_t i = 0; i < 4; i++) {
-        if ( std::find(this->contact_feet_names.begin(), this->contact_feet_names.end(), feet_names[i]) == this->contact_feet_names.end() ) {
-            // The foot name is NOT a member of the contact_feet_names vector, hence it is a swing foot.
-            swing_feet_names.push_back(feet_names[i]);
-        }
-    }
-}
-
-
-/* ===================== Generic_to_specific_feet_names ===================== */
-
-std::vector<std::string> RobotModel::generic_to_specific_feet_names(std::vector<std::string> generic_names)
-{
-    for (auto & foot_name : generic_names) {
+    for (const auto& foot_name : generic_contact_feet_names) {
         auto it = std::find(this->generic_feet_names.begin(), this->generic_feet_names.end(), foot_name);
 
-        int index = std::distance(this->generic_feet_names.begin(), it);
+        if (it == this->generic_feet_names.end()) {
+            throw std::invalid_argument("'" + foot_name + "' is not a generic foot name.");
+        }
+
+        const int index = static_cast<int>(std::distance(this->generic_feet_names.begin(), it));
 
-        foot_name = this->feet_names[index];
+        contact_feet.push_back(index);
+        contact_feet_ids.push_back(feet_ids[index]);
+        contact_mask |= 1u << index;
     }
 
-    return generic_names;
+    for (int i = 0; i < 4; i++) {
+        if ((contact_mask & (1u << i)) == 0) {
+            // The foot is not in contact with the terrain, hence it is a swing foot.
+            swing_feet_ids.push_back(feet_ids[i]);
+        }
+    }
 }
 
 } // robot_wrapper
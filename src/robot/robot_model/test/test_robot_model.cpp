@@ -34,7 +34,7 @@ int main()
                   << data.oMi[joint_id].translation().transpose()
                   << std::endl;
 
-    std::vector<std::string> contact_feet_names{"LF_FOOT", "RF_FOOT", "RH_FOOT"};
+    std::vector<std::string> contact_feet_names{"LF", "RF", "RH"};
     int nc = contact_feet_names.size();
     int nv = model.nv;
     
@@ -46,6 +46,11 @@ int main()
     rob.compute_EOM(q, v);
     cout << "compute_EOM successfull\n";
 
+    robot_wrapper::ModelQuantities quantities;
+    quantities.M = quantities.h = quantities.Jc = quantities.Jc_dot_times_v = true;
+    rob.compute(q, v, quantities);
+    cout << "compute successfull\n";
+
     Eigen::MatrixXd Jc(3*nc, nv);
     rob.get_Jc(Jc);
     cout << "compute_Jc successfull\n";